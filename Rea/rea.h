@@ -26,10 +26,29 @@ SOFTWARE.
 
 
 #include <vector>
-#include <deque>
 #include <utility>
 #include <memory>
 #include <algorithm>
+#include <iterator>
+#include <limits>
+#include <new>
+#include <type_traits>
+#include <cstdint>
+#include <functional>
+#include <tuple>
+#include <cstddef>
+#include <stdexcept>
+
+#if defined(__has_include)
+#if __has_include(<memory_resource>) && (__cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L))
+#include <memory_resource>
+#define REA_HAS_PMR 1
+#endif
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
 
 namespace rea {
@@ -62,6 +81,9 @@ using IteratorReferenceType = typename std::iterator_traits<T>::reference;
 template<typename T>
 using IteratorValueType = ValueType<std::iterator_traits<T>>;
 
+template<typename T>
+using IteratorCategory = typename std::iterator_traits<T>::iterator_category;
+
 template<typename A, typename O>
 using AllocatorRebindType = typename std::allocator_traits<A>::template rebind_alloc<O>;
 
@@ -85,6 +107,62 @@ constexpr I max_type_value() {
 return (std::numeric_limits<I>::max)();
 }
 
+// Hints the processor to fetch the cache line at "p", it has no other effect.
+inline
+void prefetch(const void *p) {
+#if defined(__GNUC__) || defined(__clang__)
+	__builtin_prefetch(p);
+#elif defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+	_mm_prefetch(static_cast<const char*>(p), _MM_HINT_T0);
+#else
+	(void)p;
+#endif
+}
+
+// Number of trailing zero bits of "x", which must not be 0.
+inline
+unsigned count_trailing_zeros(std::uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+	return static_cast<unsigned>(__builtin_ctzll(x));
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+	unsigned long i;
+	_BitScanForward64(&i, x);
+	return static_cast<unsigned>(i);
+#else
+	unsigned n = 0;
+	for (; (x & 1u) == 0; x >>= 1) ++n;
+	return n;
+#endif
+}
+
+// Position of the highest set bit of "x", which must not be 0.
+inline
+unsigned highest_set_bit(std::uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+	return 63u - static_cast<unsigned>(__builtin_clzll(x));
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+	unsigned long i;
+	_BitScanReverse64(&i, x);
+	return static_cast<unsigned>(i);
+#else
+	unsigned n = 0;
+	for (; x > 1; x >>= 1) ++n;
+	return n;
+#endif
+}
+
+// Number of set bits of "x".
+inline
+unsigned population_count(std::uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+	return static_cast<unsigned>(__builtin_popcountll(x));
+#else
+	unsigned n = 0;
+	for (; x != 0; x &= x - 1) ++n;
+	return n;
+#endif
+}
+
 template<typename S>
 // S models Integral
 struct trivial_slot {
@@ -150,6 +228,35 @@ struct versioned_bidirectional_slot {
 };
 
 
+// Links of a slot whose value is stored in a separate container. 
+// It has no "value", so only algorithms which touch links can be applied to it.
+template<typename S>
+// S models Integral
+struct bidirectional_link {
+	using size_type = S;
+
+	size_type prev;
+	size_type next;
+
+	bidirectional_link() : prev(size_type(0)), next(size_type(0)) {}
+};
+
+
+template<typename S, typename V>
+// S models Integral
+// V models Integral
+struct versioned_bidirectional_link {
+	using size_type = S;
+	using version_type = V;
+
+	size_type prev;
+	size_type next;
+	version_type version;
+
+	versioned_bidirectional_link() : prev(size_type(0)), next(size_type(0)), version(min_type_value<version_type>()) {}
+};
+
+
 using default_size_type = std::size_t;
 
 using default_version_type = std::size_t;
@@ -158,6 +265,86 @@ template<typename T>
 using default_allocator_type = std::allocator<T>;
 
 
+
+//**************************************************************************************************
+// Id traits tell versioned containers how to make an id out of a slot index and a version,
+// and how to take it apart.
+//**************************************************************************************************
+
+// Default id traits. Id is a pair of a slot index and a version.
+template<typename S, typename V>
+// S models Integral
+// V models Integral
+struct pair_id_traits {
+	using size_type = S;
+	using version_type = V;
+	using id_type = std::pair<size_type, version_type>;
+
+	static id_type make(size_type index, version_type version) { return id_type{ index, version }; }
+	static size_type index(const id_type &id) { return id.first; }
+	static version_type version(const id_type &id) { return id.second; }
+	static bool has_version(const id_type &id, version_type version) { return id.second == version; }
+	static id_type end() { return id_type{ max_type_value<size_type>(), max_type_value<version_type>() }; }
+	static bool is_end(const id_type &id) { return id.first == max_type_value<size_type>(); }
+	// Number of slots ids can address. Index with all bits set is reserved for the end id.
+	static constexpr size_type max_size() { return max_type_value<size_type>(); }
+};
+
+// When used as the version type of a versioned container, ids become single unsigned integers of type "U",
+// which can be compared and hashed as such. Lower "IndexBits" bits of an id hold the slot index, and the upper bits
+// hold the version. Index with all "IndexBits" bits set is reserved for the end id, so the container can hold
+// at most 2^IndexBits - 1 slots. Versions wrap around after 2^(digits(U) - IndexBits) erasures from the same slot.
+// E.g. rea::versioned_slot_map<T, std::size_t, rea::packed_id<std::uint32_t, 20>> has 4 byte ids, room for about
+// a million values, and 4096 versions per slot.
+template<typename U, unsigned IndexBits>
+// U models UnsignedIntegral
+struct packed_id {
+	static_assert(std::is_unsigned<U>::value, "packed id has to be an unsigned integral type");
+	static_assert(IndexBits > 0 && IndexBits < static_cast<unsigned>(std::numeric_limits<U>::digits), "packed id has to have both index and version bits");
+
+	using value_type = U;
+};
+
+template<typename S, typename U, unsigned IndexBits>
+// S models Integral
+// U models UnsignedIntegral
+struct packed_id_traits {
+	using size_type = S;
+	using version_type = U;
+	using id_type = U;
+
+	static constexpr id_type index_mask() { return static_cast<id_type>((id_type(1) << IndexBits) - id_type(1)); }
+
+	static id_type make(size_type index, version_type version) {
+		return static_cast<id_type>(static_cast<id_type>(version << IndexBits) | static_cast<id_type>(index));
+	}
+	static size_type index(id_type id) { return static_cast<size_type>(id & index_mask()); }
+	static version_type version(id_type id) { return static_cast<version_type>(id >> IndexBits); }
+	static bool has_version(id_type id, version_type version) { return id == make(index(id), version); }
+	static id_type end() { return index_mask(); }
+	static bool is_end(id_type id) { return (id & index_mask()) == index_mask(); }
+	// Number of slots ids can address. Index with all "IndexBits" bits set is reserved for the end id.
+	static constexpr size_type max_size() {
+		return static_cast<typename std::make_unsigned<size_type>::type>(max_type_value<size_type>()) < index_mask() ?
+			max_type_value<size_type>() : static_cast<size_type>(index_mask());
+	}
+};
+
+template<typename S, typename V>
+struct id_traits_of {
+	using type = pair_id_traits<S, V>;
+};
+
+template<typename S, typename U, unsigned IndexBits>
+struct id_traits_of<S, packed_id<U, IndexBits>> {
+	using type = packed_id_traits<S, U, IndexBits>;
+};
+
+// Id traits of a versioned container with "S" as its size type and "V" as its version type.
+template<typename S, typename V>
+using IdTraits = typename id_traits_of<S, V>::type;
+
+
 //**************************************************************************************************
 // In case the user wishes to use his own allocators, 
 // these type functions tell him what should be their "value_type".
@@ -189,6 +376,17 @@ template<typename T, typename S, typename V>
 // V models Integral
 using sl_regulated_slot_type = sl_versioned_slot_type<T, S, V>;
 
+// "value_type" of "split_slot_list::link_container_type"
+template<typename S>
+// S models Integral
+using sl_link_type = bidirectional_link<S>;
+
+// "value_type" of "versioned_split_slot_list::link_container_type"
+template<typename S, typename V>
+// S models Integral
+// V models Integral
+using sl_versioned_link_type = versioned_bidirectional_link<S, V>;
+
 // "value_type" of "slot_map::id_slot_container_type"
 template<typename S>
 // S models Integral
@@ -206,6 +404,7 @@ using sm_versioned_slot_type = versioned_trivial_slot<S, V>;
 // Concept : SlotContainer 
 // - Models RandomAccesSequenceContainer
 // - Has void resize(size_type) method defined
+// - Has iterator erase(const_iterator, const_iterator) and void shrink_to_fit() methods defined
 // - Has iterator begin(), iterator end(), const_iterator cbegin(), const_iterator cend() methods defined   
 //**************************************************************************************************
 
@@ -213,23 +412,564 @@ using sm_versioned_slot_type = versioned_trivial_slot<S, V>;
 // Concept : DenseContainer 
 // - Models RandomAccesSequenceContainer
 // - Has void resize(size_type) method defined
-// - Has void reserve(size_type) method defined
+// - Has void reserve(size_type) and void shrink_to_fit() methods defined
 // - Has iterator begin(), iterator end(), const_iterator cbegin(), const_iterator cend(),
 //   reverse_iterator rbegin(), reverse_iterator rend(), const_reverse_iterator crbegin(),
 //   const_reverse_iterator crend() methods defined
 //**************************************************************************************************
 
+//**************************************************************************************************
+// chunked_slot_container stores its objects in fixed size chunks of 2^ChunkBits objects each.
+// Position of an object is found with a shift and a mask, and objects are never moved once
+// they're constructed, so pointers and references to them stay valid when the container grows.
+// Iterators are invalidated by resize.
+//**************************************************************************************************
+
+template<typename T, typename A, unsigned ChunkBits>
+// T models SemiRegular
+// A models Allocator
+// chunked_slot_container models SlotContainer
+class chunked_slot_container {
+public:
+	using value_type = T;
+	using allocator_type = AllocatorRebindType<A, T>;
+	using size_type = std::size_t;
+	using difference_type = std::ptrdiff_t;
+	using reference = value_type&;
+	using const_reference = const value_type&;
+	using pointer = value_type*;
+	using const_pointer = const value_type*;
+
+	static constexpr unsigned chunk_bits = ChunkBits;
+	static constexpr size_type chunk_size = size_type(1) << ChunkBits;
+
+	template<typename U>
+	// U models value_type or const value_type
+	class chunk_iterator {
+	public:
+		using iterator_category = std::random_access_iterator_tag;
+		using value_type = typename std::remove_const<U>::type;
+		using difference_type = std::ptrdiff_t;
+		using pointer = U*;
+		using reference = U&;
+
+		chunk_iterator() : chunks(nullptr), index(0) {}
+		chunk_iterator(value_type *const *chunks, size_type index) : chunks(chunks), index(index) {}
+		template<typename O, 
+			typename = typename std::enable_if<std::is_convertible<O*, U*>::value>::type>
+		chunk_iterator(const chunk_iterator<O> &other) : chunks(other.chunks), index(other.index) {}
+
+		reference operator*() const { return chunks[index >> ChunkBits][index & chunk_mask]; }
+		pointer operator->() const { return std::addressof(**this); }
+		reference operator[](difference_type n) const { return *(*this + n); }
+
+		chunk_iterator& operator++() { ++index; return *this; }
+		chunk_iterator operator++(int) { auto tmp = *this; ++index; return tmp; }
+		chunk_iterator& operator--() { --index; return *this; }
+		chunk_iterator operator--(int) { auto tmp = *this; --index; return tmp; }
+		chunk_iterator& operator+=(difference_type n) { index += n; return *this; }
+		chunk_iterator& operator-=(difference_type n) { index -= n; return *this; }
+		chunk_iterator operator+(difference_type n) const { return chunk_iterator(chunks, index + n); }
+		chunk_iterator operator-(difference_type n) const { return chunk_iterator(chunks, index - n); }
+		friend chunk_iterator operator+(difference_type n, const chunk_iterator &it) { return it + n; }
+
+		template<typename O>
+		difference_type operator-(const chunk_iterator<O> &other) const { 
+			return static_cast<difference_type>(index) - static_cast<difference_type>(other.index); 
+		}
+		template<typename O>
+		bool operator==(const chunk_iterator<O> &other) const { return index == other.index; }
+		template<typename O>
+		bool operator!=(const chunk_iterator<O> &other) const { return index != other.index; }
+		template<typename O>
+		bool operator<(const chunk_iterator<O> &other) const { return index < other.index; }
+		template<typename O>
+		bool operator>(const chunk_iterator<O> &other) const { return index > other.index; }
+		template<typename O>
+		bool operator<=(const chunk_iterator<O> &other) const { return index <= other.index; }
+		template<typename O>
+		bool operator>=(const chunk_iterator<O> &other) const { return index >= other.index; }
+
+	private:
+		template<typename O>
+		friend class chunk_iterator;
+
+		value_type *const *chunks;
+		size_type index;
+	};
+
+	using iterator = chunk_iterator<value_type>;
+	using const_iterator = chunk_iterator<const value_type>;
+	using reverse_iterator = std::reverse_iterator<iterator>;
+	using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+private:
+	static constexpr size_type chunk_mask = chunk_size - 1;
+	using alloc_traits = std::allocator_traits<allocator_type>;
+	using chunk_table_type = std::vector<pointer, AllocatorRebindType<A, pointer>>;
+
+	allocator_type alloc;
+	chunk_table_type chunks;
+	size_type count;
+
+	static size_type _chunk_count(size_type n) {
+		return (n >> ChunkBits) + ((n & chunk_mask) != 0);
+	}
+
+	void _reserve_chunks(size_type n) {
+		const size_type needed = _chunk_count(n);
+		chunks.reserve(needed);
+		while (chunks.size() < needed) chunks.push_back(alloc_traits::allocate(alloc, chunk_size));
+	}
+
+	void _release_chunks(size_type n) {
+		const size_type needed = _chunk_count(n);
+		while (chunks.size() > needed) {
+			alloc_traits::deallocate(alloc, chunks.back(), chunk_size);
+			chunks.pop_back();
+		}
+	}
+
+	template<typename... Args>
+	void _grow(size_type n, const Args&... args) {
+		_reserve_chunks(n);
+		for (; count != n; ++count) alloc_traits::construct(alloc, std::addressof((*this)[count]), args...);
+	}
+
+	void _shrink(size_type n) {
+		for (; count != n; --count) alloc_traits::destroy(alloc, std::addressof((*this)[count - 1]));
+		_release_chunks(n);
+	}
+
+	// Copies or moves the objects of "other" over the existing ones, and constructs or destroys the rest.
+	template<typename C>
+	// C models chunked_slot_container& or chunked_slot_container&&
+	void _assign(C &&other) {
+		using source_type = typename std::conditional<std::is_lvalue_reference<C>::value, const value_type&, value_type&&>::type;
+		const auto common = (std::min)(count, other.count);
+		for (size_type i = 0; i != common; ++i)
+			(*this)[i] = static_cast<source_type>(other[i]);
+		if (other.count > count) {
+			_reserve_chunks(other.count);
+			for (; count != other.count; ++count)
+				alloc_traits::construct(alloc, std::addressof((*this)[count]), static_cast<source_type>(other[count]));
+		}
+		else {
+			_shrink(other.count);
+		}
+	}
+
+	template<typename U>
+	void _assign_allocator(U &&other_alloc, std::true_type) {
+		alloc = std::forward<U>(other_alloc);
+	}
+
+	template<typename U>
+	void _assign_allocator(U&&, std::false_type) {}
+
+	void _swap_allocator(allocator_type &other_alloc, std::true_type) {
+		using std::swap;
+		swap(alloc, other_alloc);
+	}
+
+	void _swap_allocator(allocator_type&, std::false_type) {}
+
+public:
+	chunked_slot_container() : chunked_slot_container(allocator_type{}) {}
+
+	explicit chunked_slot_container(const allocator_type &alloc) : 
+		alloc(alloc), chunks(AllocatorRebindType<A, pointer>(alloc)), count(0) {}
+
+	chunked_slot_container(const chunked_slot_container &other) : 
+		chunked_slot_container(alloc_traits::select_on_container_copy_construction(other.alloc)) {
+		_reserve_chunks(other.count);
+		for (; count != other.count; ++count) 
+			alloc_traits::construct(alloc, std::addressof((*this)[count]), other[count]);
+	}
+
+	chunked_slot_container(chunked_slot_container &&other) : 
+		alloc(std::move(other.alloc)), chunks(std::move(other.chunks)), count(other.count) {
+		other.chunks.clear();
+		other.count = 0;
+	}
+
+	// Allocators follow the propagate_on_container_* traits, like they do with standard containers.
+	// If the allocator isn't propagated and the two aren't equal, objects are copied or moved one by one.
+	chunked_slot_container& operator=(const chunked_slot_container &other) {
+		if (this == &other) return *this;
+		using propagate = typename alloc_traits::propagate_on_container_copy_assignment;
+		if (propagate::value && alloc != other.alloc) {
+			_shrink(0);
+			chunks = chunk_table_type(AllocatorRebindType<A, pointer>(other.alloc));
+		}
+		_assign_allocator(other.alloc, propagate{});
+		_assign(other);
+		return *this;
+	}
+
+	chunked_slot_container& operator=(chunked_slot_container &&other) {
+		if (this == &other) return *this;
+		using propagate = typename alloc_traits::propagate_on_container_move_assignment;
+		if (propagate::value || alloc == other.alloc) {
+			_shrink(0);
+			_assign_allocator(std::move(other.alloc), propagate{});
+			chunks = std::move(other.chunks);
+			count = other.count;
+			other.chunks.clear();
+			other.count = 0;
+		}
+		else {
+			_assign(std::move(other));
+			other.clear();
+		}
+		return *this;
+	}
+
+	~chunked_slot_container() {
+		_shrink(0);
+	}
+
+	// Allocators which don't propagate on swap have to be equal.
+	void swap(chunked_slot_container &other) {
+		using std::swap;
+		_swap_allocator(other.alloc, typename alloc_traits::propagate_on_container_swap{});
+		chunks.swap(other.chunks);
+		swap(count, other.count);
+	}
+
+	void resize(size_type n) {
+		if (n > count) _grow(n);
+		else _shrink(n);
+	}
+
+	void resize(size_type n, const value_type &value) {
+		if (n > count) _grow(n, value);
+		else _shrink(n);
+	}
+
+	void clear() {
+		_shrink(0);
+	}
+
+	// Objects after the erased ones are moved down, so pointers to them are invalidated.
+	iterator erase(const_iterator first, const_iterator last) {
+		const auto from = static_cast<size_type>(first - cbegin());
+		const auto to = static_cast<size_type>(last - cbegin());
+		if (from != to) {
+			std::move(iterator(chunks.data(), to), end(), iterator(chunks.data(), from));
+			_shrink(count - (to - from));
+		}
+		return iterator(chunks.data(), from);
+	}
+
+	// Releases spare room of the chunk table. Unused chunks are already released by resize.
+	void shrink_to_fit() {
+		chunks.shrink_to_fit();
+	}
+
+	reference operator[](size_type index) {
+		return chunks[index >> ChunkBits][index & chunk_mask];
+	}
+
+	const_reference operator[](size_type index) const {
+		return chunks[index >> ChunkBits][index & chunk_mask];
+	}
+
+	reference front() { return (*this)[0]; }
+	const_reference front() const { return (*this)[0]; }
+	reference back() { return (*this)[count - 1]; }
+	const_reference back() const { return (*this)[count - 1]; }
+
+	iterator begin() { return iterator(chunks.data(), 0); }
+	iterator end() { return iterator(chunks.data(), count); }
+	const_iterator begin() const { return const_iterator(chunks.data(), 0); }
+	const_iterator end() const { return const_iterator(chunks.data(), count); }
+	const_iterator cbegin() const { return begin(); }
+	const_iterator cend() const { return end(); }
+	reverse_iterator rbegin() { return reverse_iterator(end()); }
+	reverse_iterator rend() { return reverse_iterator(begin()); }
+	const_reverse_iterator crbegin() const { return const_reverse_iterator(cend()); }
+	const_reverse_iterator crend() const { return const_reverse_iterator(cbegin()); }
+
+	size_type size() const { return count; }
+	size_type capacity() const { return chunks.size() << ChunkBits; }
+	bool empty() const { return count == 0; }
+	size_type max_size() const { return (std::min)(alloc_traits::max_size(alloc), chunks.max_size()) ; }
+	allocator_type get_allocator() const { return alloc; }
+};
+
+template<typename T, typename A, unsigned ChunkBits>
+constexpr unsigned chunked_slot_container<T, A, ChunkBits>::chunk_bits;
+template<typename T, typename A, unsigned ChunkBits>
+constexpr typename chunked_slot_container<T, A, ChunkBits>::size_type chunked_slot_container<T, A, ChunkBits>::chunk_size;
+template<typename T, typename A, unsigned ChunkBits>
+constexpr typename chunked_slot_container<T, A, ChunkBits>::size_type chunked_slot_container<T, A, ChunkBits>::chunk_mask;
+
+template<typename T, typename A, unsigned ChunkBits>
+void swap(chunked_slot_container<T, A, ChunkBits> &x, chunked_slot_container<T, A, ChunkBits> &y) {
+	x.swap(y);
+}
+
+constexpr unsigned floor_log2(std::size_t n) {
+	return n <= 1 ? 0u : 1u + floor_log2(n >> 1);
+}
+
+// Size of a single chunk of "sl_container_type" in bytes, unless "sl_chunk_bits" is specialized.
+constexpr std::size_t sl_default_chunk_bytes = 16384;
+
+// Number of slots in a single chunk of "sl_container_type" is 2^sl_chunk_bits<N>::value.
+// By default a chunk takes up about "sl_default_chunk_bytes" bytes. It may be specialized for 
+// a particular slot type, E.g:
+// template<> struct rea::sl_chunk_bits<rea::sl_slot_type<T, S>> : std::integral_constant<unsigned, 6> {};
+template<typename N>
+// N models Slot
+struct sl_chunk_bits : std::integral_constant<unsigned, 
+	floor_log2(sizeof(N) < sl_default_chunk_bytes ? sl_default_chunk_bytes / sizeof(N) : 1)> {};
+
+//**************************************************************************************************
+// arena_resource hands out memory from a few large blocks, so that the containers of a whole subsystem
+// share contiguous regions of memory, and all of it is freed at once by "release".
+// Small requests, E.g. chunks of a "slot_list" or the bitmaps, are rounded up to a power of two and
+// carved from the current block. Deallocated ones are kept on a free list of their size, so growing
+// containers reuse the memory they give back. Requests larger than "large_size" get a block of their
+// own, which is freed by "deallocate", so the arrays of a large "slot_map" don't waste memory.
+// It's not thread safe. Containers which allocate from it must be destroyed before "release" is called.
+// If <memory_resource> is available it's a std::pmr::memory_resource, so it also backs
+// std::pmr::polymorphic_allocator.
+//**************************************************************************************************
+
+class arena_resource
+#ifdef REA_HAS_PMR
+	: public std::pmr::memory_resource
+#endif
+{
+	struct block_header {
+		block_header *prev;
+		block_header *next;
+		char *raw;
+	};
+
+	struct free_node {
+		free_node *next;
+	};
+
+	static constexpr std::size_t base_alignment = alignof(std::max_align_t);
+	static constexpr unsigned min_class = 4;
+	static constexpr unsigned class_count = 64;
+
+	free_node *free_lists[class_count];
+	block_header *blocks;
+	block_header *large_blocks;
+	char *initial;
+	std::size_t initial_size;
+	char *cur;
+	char *last;
+	std::size_t block_size;
+	std::size_t next_block_size;
+
+	static unsigned _size_class(std::size_t bytes) {
+		return bytes <= (std::size_t(1) << min_class) ? min_class : highest_set_bit(static_cast<std::uint64_t>(bytes - 1)) + 1;
+	}
+
+	static char* _align_up(char *p, std::size_t alignment) {
+		const auto a = reinterpret_cast<std::uintptr_t>(p);
+		return p + ((alignment - a % alignment) % alignment);
+	}
+
+	static std::size_t _header_size(std::size_t alignment) {
+		return (sizeof(block_header) + alignment - 1) / alignment * alignment;
+	}
+
+	static void _unlink(block_header *&list, block_header *b) {
+		if (b->prev != nullptr) b->prev->next = b->next;
+		else list = b->next;
+		if (b->next != nullptr) b->next->prev = b->prev;
+	}
+
+	static void _free_list(block_header *list) {
+		while (list != nullptr) {
+			const auto next = list->next;
+			::operator delete(list->raw);
+			list = next;
+		}
+	}
+
+	// Allocates a block which will hold at least "bytes" bytes aligned to "alignment", after its header.
+	static block_header* _new_block(block_header *&list, std::size_t bytes, std::size_t alignment, char *&first) {
+		const auto header = _header_size(alignment);
+		char *raw = static_cast<char*>(::operator new(header + bytes + alignment));
+		first = _align_up(raw + header, alignment);
+		auto b = reinterpret_cast<block_header*>(first - sizeof(block_header));
+		b->raw = raw;
+		b->prev = nullptr;
+		b->next = list;
+		if (list != nullptr) list->prev = b;
+		list = b;
+		return b;
+	}
+
+	void* _carve(std::size_t bytes, std::size_t alignment) {
+		char *p = cur != nullptr ? _align_up(cur, alignment) : nullptr;
+		if (p == nullptr || p > last || static_cast<std::size_t>(last - p) < bytes) {
+			const auto size = (std::max)(next_block_size, bytes + alignment);
+			char *first = nullptr;
+			_new_block(blocks, size, base_alignment, first);
+			cur = first;
+			last = first + size;
+			next_block_size = next_block_size * 2 < max_block_size ? next_block_size * 2 : max_block_size;
+			p = _align_up(cur, alignment);
+		}
+		cur = p + bytes;
+		return p;
+	}
+
+	void* _allocate(std::size_t bytes, std::size_t alignment) {
+		if (alignment < base_alignment) alignment = base_alignment;
+		if (bytes > large_size) {
+			char *first = nullptr;
+			_new_block(large_blocks, bytes, alignment, first);
+			return first;
+		}
+		const auto k = _size_class(bytes);
+		auto &list = free_lists[k];
+		if (list != nullptr && alignment == base_alignment) {
+			const auto node = list;
+			list = node->next;
+			return node;
+		}
+		return _carve(std::size_t(1) << k, alignment);
+	}
+
+	void _deallocate(void *p, std::size_t bytes) {
+		if (p == nullptr) return;
+		if (bytes > large_size) {
+			auto b = reinterpret_cast<block_header*>(static_cast<char*>(p) - sizeof(block_header));
+			_unlink(large_blocks, b);
+			::operator delete(b->raw);
+			return;
+		}
+		auto node = static_cast<free_node*>(p);
+		auto &list = free_lists[_size_class(bytes)];
+		node->next = list;
+		list = node;
+	}
+
+#ifdef REA_HAS_PMR
+	void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+		return _allocate(bytes, alignment);
+	}
+
+	void do_deallocate(void *p, std::size_t bytes, std::size_t) override {
+		_deallocate(p, bytes);
+	}
+
+	bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+		return this == &other;
+	}
+#endif
+
+public:
+	// Requests larger than this get a block of their own.
+	static constexpr std::size_t large_size = std::size_t(1) << 20;
+	// Blocks double in size, up to this size.
+	static constexpr std::size_t max_block_size = std::size_t(1) << 26;
+	static constexpr std::size_t default_block_size = std::size_t(1) << 16;
+
+	explicit arena_resource(std::size_t block_size = default_block_size) : arena_resource(nullptr, 0, block_size) {}
+
+	// Memory is carved from "buffer" first, which stays owned by the caller.
+	arena_resource(void *buffer, std::size_t size, std::size_t block_size = default_block_size) :
+		blocks(nullptr),
+		large_blocks(nullptr),
+		initial(static_cast<char*>(buffer)),
+		initial_size(size),
+		cur(initial),
+		last(initial + size),
+		block_size(block_size),
+		next_block_size(block_size)
+	{
+		std::fill(std::begin(free_lists), std::end(free_lists), nullptr);
+	}
+
+	arena_resource(const arena_resource&) = delete;
+	arena_resource& operator=(const arena_resource&) = delete;
+
+	~arena_resource() {
+		release();
+	}
+
+#ifndef REA_HAS_PMR
+	void* allocate(std::size_t bytes, std::size_t alignment = base_alignment) {
+		return _allocate(bytes, alignment);
+	}
+
+	void deallocate(void *p, std::size_t bytes, std::size_t = base_alignment) {
+		_deallocate(p, bytes);
+	}
+#endif
+
+	// Frees all blocks at once, after which the arena starts over from the caller's buffer.
+	void release() {
+		_free_list(blocks);
+		_free_list(large_blocks);
+		blocks = nullptr;
+		large_blocks = nullptr;
+		std::fill(std::begin(free_lists), std::end(free_lists), nullptr);
+		cur = initial;
+		last = initial + initial_size;
+		next_block_size = block_size;
+	}
+};
+
+// Allocator which takes memory from an "arena_resource". Copies, including rebound ones, share the arena.
+template<typename T>
+class arena_allocator {
+	template<typename U>
+	friend class arena_allocator;
+
+	arena_resource *arena;
+
+public:
+	using value_type = T;
+
+	explicit arena_allocator(arena_resource &arena) noexcept : arena(std::addressof(arena)) {}
+
+	template<typename U>
+	arena_allocator(const arena_allocator<U> &other) noexcept : arena(other.arena) {}
+
+	T* allocate(std::size_t n) {
+		if (n > (std::numeric_limits<std::size_t>::max)() / sizeof(T)) throw std::bad_alloc();
+		return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T)));
+	}
+
+	void deallocate(T *p, std::size_t n) {
+		arena->deallocate(p, n * sizeof(T), alignof(T));
+	}
+
+	arena_resource* resource() const noexcept {
+		return arena;
+	}
+
+	template<typename U>
+	bool operator==(const arena_allocator<U> &other) const noexcept { return arena == other.arena; }
+	template<typename U>
+	bool operator!=(const arena_allocator<U> &other) const noexcept { return arena != other.arena; }
+};
+
+
+
 //**************************************************************************************************
 // These are the global types of the underlying containers which are used in the library.
 // They may be changed to some other containers only if they model given concepts.
 //**************************************************************************************************
 
-// Container which will be used to store slots of "slot_list"
-template<typename N, typename A>
+// Container which will be used to store slots of "slot_list". It has 2^ChunkBits slots per chunk,
+// or 2^sl_chunk_bits<N>::value if "ChunkBits" is 0.
+template<typename N, typename A, unsigned ChunkBits = 0>
 // N models Slot
 // A models Allocator
 // sl_container_type models SlotContainer
-using sl_container_type = std::deque<N, AllocatorRebindType<A, N>>;
+using sl_container_type = chunked_slot_container<N, A, ChunkBits != 0 ? ChunkBits : sl_chunk_bits<N>::value>;
 
 // Container which will be used to store values of "slot_map" 
 template<typename T, typename A>
@@ -252,6 +992,29 @@ template<typename N, typename A>
 // sm_id_slot_container_type models SlotContainer
 using sm_id_slot_container_type = std::vector<N, AllocatorRebindType<A, N>>;
 
+// All three containers of "versioned_slot_map", chosen at once by its "Containers" parameter. Each alias template takes 
+// the type of the objects, and the allocator of the map.
+// Some other set of containers, E.g. "mapped_containers", plugs in with a struct of the same three aliases.
+struct default_sm_containers {
+	template<typename T, typename A>
+	using value_container = sm_value_container_type<T, A>;
+
+	template<typename S, typename A>
+	using id_pos_container = sm_id_pos_container_type<S, A>;
+
+	template<typename N, typename A>
+	using id_slot_container = sm_id_slot_container_type<N, A>;
+};
+
+// "versioned_slot_map" calls this whenever its list of empty id slots or its version floor changes, so containers
+// which outlive the map, E.g. files, can keep them. Other containers have nothing to keep.
+template<typename C, typename S, typename V>
+void sm_store_state(C&, const std::pair<S, S>&, const V&) {}
+
+// "versioned_slot_map" calls this once it's made out of existing containers, to restore what "sm_store_state" kept.
+template<typename C, typename S, typename V>
+void sm_restore_state(const C&, std::pair<S, S>&, V&) {}
+
 
 
 // Global succesor and predecessor functions and functions objects 
@@ -470,29 +1233,198 @@ struct get_empty {
 	T operator()() { return T{}; }
 };
 
-template<typename I>
-// I models integral
-constexpr bool is_over_breakoff(I capacity, I size) {
-	return size > static_cast<I>(capacity * (5.f / 9.f));
-}
-
-template<typename I>
-// I models integral
-constexpr I grow_size(I size) {
-	return static_cast<I>(size * 1.5f) + I{ 2 };
-}
+template<typename T>
+// T models DefaultConstructible
+struct default_construct_obj {
+	void operator()(T *p) const {
+		::new (static_cast<void*>(p)) T();
+	}
+};
 
+template<typename T, typename E>
+// E models Generator : T operator()();
+struct controlled_construct_obj {
+	E *get_empty;
 
+	controlled_construct_obj(E &get_empty) : get_empty(std::addressof(get_empty)) {}
 
+	void operator()(T *p) const {
+		::new (static_cast<void*>(p)) T((*get_empty)());
+	}
+};
 
+template<typename T, typename F, typename... Args>
+// T models Destructible
+// F models UnaryProcedure : void operator()(T *);
+inline
+void reconstruct_value_basis(std::true_type, T &value, F, Args&&... args) {
+	value.~T();
+	::new (static_cast<void*>(std::addressof(value))) T(std::forward<Args>(args)...);
+}
 
-// Links the slot with "pos.empty" index to doubly linked list of filled slots, and removes it from the singly linked list of empty slots.
-// That slot becomes the tail of the filled list. This has to be a different function from bidirectional_link_to_filled because it also needs
-// to set "pos.empty.second", in case the "pos.empty.first == pos.empty.second".
-template<typename I>
-// I models BidirectionalSlot_Iterator
+template<typename T, typename F, typename... Args>
+// T models Destructible
+// F models UnaryProcedure : void operator()(T *);
 inline
-bidirectional_slot_meta_positions<SlotSizeType<I>> bidirectional_link_to_filled(I first, const bidirectional_slot_meta_positions<SlotSizeType<I>> &pos, 
+void reconstruct_value_basis(std::false_type, T &value, F refill, Args&&... args) {
+	value.~T();
+	try {
+		::new (static_cast<void*>(std::addressof(value))) T(std::forward<Args>(args)...);
+	}
+	catch (...) {
+		refill(std::addressof(value));
+		throw;
+	}
+}
+
+// Destroys the object stored in an empty slot, and constructs a new one in its place from "args".
+// No temporary is created, so the value type doesn't have to be movable.
+// If construction throws, the slot is refilled with a default constructed object, so that
+// every slot always holds a live object.
+template<typename T, typename... Args>
+// T models Destructible
+inline
+void reconstruct_value(T &value, Args&&... args) {
+	reconstruct_value_basis(std::integral_constant<bool, std::is_nothrow_constructible<T, Args&&...>::value>{},
+		value, default_construct_obj<T>{}, std::forward<Args>(args)...);
+}
+
+// Same as "reconstruct_value", only the slot is refilled with the value returned by "get_empty".
+template<typename T, typename E, typename... Args>
+// T models Destructible
+// E models Generator : T operator()();
+inline
+void controlled_reconstruct_value(T &value, E &get_empty, Args&&... args) {
+	reconstruct_value_basis(std::integral_constant<bool, std::is_nothrow_constructible<T, Args&&...>::value>{},
+		value, controlled_construct_obj<T, E>{ get_empty }, std::forward<Args>(args)...);
+}
+
+template<typename I>
+// I models integral
+constexpr bool is_over_breakoff(I capacity, I size) {
+	return size > static_cast<I>(capacity / 9 * 5 + capacity % 9 * 5 / 9);
+}
+
+template<typename I>
+// I models integral
+constexpr I grow_size(I size) {
+	return static_cast<I>(size + size / 2 + I{ 2 });
+}
+
+
+
+
+//**************************************************************************************************
+// Growth policies tell containers how much capacity to add once they are full, and which strategy
+// "clear" should use.
+// G models GrowthPolicy :
+// - static I grow_size(I size, I n, std::size_t value_bytes) returns the capacity which fits "n" more 
+//   values next to "size" ones, where a value (or a slot) takes "value_bytes" bytes
+// - static bool is_over_breakoff(I capacity, I size) returns true if "clear" should relink all slots 
+//   in one sweep, instead of walking the filled ones
+//**************************************************************************************************
+
+// Grows by Num / Den of the size plus Add, but by at most MaxStepBytes bytes, unless MaxStepBytes is zero.
+// Capacity is then rounded up to take a whole number of AlignBytes bytes, unless AlignBytes is zero,
+// e.g. 4096 for pages or 2MB for huge pages. "clear" relinks all slots once more than BreakoffNum / BreakoffDen 
+// of the capacity is filled. Only integer math is used, so it stays exact for large 64 bit sizes.
+template<std::size_t Num,
+	std::size_t Den,
+	std::size_t Add,
+	std::size_t MaxStepBytes = 0,
+	std::size_t AlignBytes = 0,
+	std::size_t BreakoffNum = 5,
+	std::size_t BreakoffDen = 9>
+struct growth_policy {
+	static_assert(Den != 0 && Num >= Den && BreakoffDen != 0, "rea::growth_policy needs Num >= Den > 0 and BreakoffDen > 0");
+
+	template<typename I>
+	// I models integral
+	static I grow_size(I size, I n, std::size_t value_bytes) {
+		constexpr auto max = max_type_value<std::size_t>();
+		const auto s = static_cast<std::size_t>(size);
+		std::size_t step = s / Den * (Num - Den) + s % Den * (Num - Den) / Den + Add;
+		if (MaxStepBytes != 0) 
+			step = (std::min)(step, (std::max)(MaxStepBytes / value_bytes, std::size_t(1)));
+		step = (std::max)(step, static_cast<std::size_t>(n));
+		std::size_t target = step < max - s ? s + step : max;
+		if (AlignBytes != 0 && target < max / value_bytes) {
+			const auto bytes = target * value_bytes;
+			if (bytes < max - AlignBytes)
+				target = (bytes + AlignBytes - 1) / AlignBytes * AlignBytes / value_bytes;
+		}
+		return static_cast<I>((std::min)(target, static_cast<std::size_t>(max_type_value<I>())));
+	}
+
+	template<typename I>
+	// I models integral
+	static constexpr bool is_over_breakoff(I capacity, I size) {
+		return size > static_cast<I>(capacity / BreakoffDen * BreakoffNum + capacity % BreakoffDen * BreakoffNum / BreakoffDen);
+	}
+};
+
+// Grows by half of the size plus 2, which is what all containers did before growth policies.
+using default_growth_policy = growth_policy<3, 2, 2>;
+
+// Doubles the capacity, which halves the number of reallocations at the cost of memory.
+using doubling_growth_policy = growth_policy<2, 1, 2>;
+
+// For containers of hundreds of millions of values. Grows by a quarter, by at most 256MB at a time,
+// and in whole 4KB pages.
+using large_growth_policy = growth_policy<5, 4, 2, (std::size_t(1) << 28), 4096>;
+
+// Like "large_growth_policy", but in whole 2MB huge pages, and by at most 1GB at a time.
+using huge_page_growth_policy = growth_policy<5, 4, 2, (std::size_t(1) << 30), (std::size_t(1) << 21)>;
+
+// Throws std::length_error if a versioned container would need more than "max_size" slots, 
+// which is all its ids can address.
+template<typename I>
+// I models Integral
+void check_id_max_size(I s, I max_size) {
+	if (s > max_size) throw std::length_error("rea: container would have more slots than its ids can address");
+}
+
+// Like G::grow_size, but never more than "max_size" slots. Throws std::length_error if "n" more values 
+// don't fit in "max_size" slots.
+template<typename G, typename I>
+// G models GrowthPolicy
+// I models Integral
+I grow_size_within(I max_size, I size, I n, std::size_t value_bytes) {
+	check_id_max_size(n, static_cast<I>(max_size - size));
+	const auto s = G::grow_size(size, n, value_bytes);
+	return s < max_size ? s : max_size;
+}
+
+
+
+// Output iterator which ignores all values assigned to it.
+// Used when the ids of inserted values aren't needed.
+struct discard_iterator {
+	using iterator_category = std::output_iterator_tag;
+	using value_type = void;
+	using difference_type = std::ptrdiff_t;
+	using pointer = void;
+	using reference = void;
+
+	template<typename T>
+	discard_iterator& operator=(const T&) { return *this; }
+
+	discard_iterator& operator*() { return *this; }
+	discard_iterator& operator++() { return *this; }
+	discard_iterator& operator++(int) { return *this; }
+};
+
+
+
+
+
+// Links the slot with "pos.empty" index to doubly linked list of filled slots, and removes it from the singly linked list of empty slots.
+// That slot becomes the tail of the filled list. This has to be a different function from bidirectional_link_to_filled because it also needs
+// to set "pos.empty.second", in case the "pos.empty.first == pos.empty.second".
+template<typename I>
+// I models BidirectionalSlot_Iterator
+inline
+bidirectional_slot_meta_positions<SlotSizeType<I>> bidirectional_link_to_filled(I first, const bidirectional_slot_meta_positions<SlotSizeType<I>> &pos, 
 	SlotSizeType<I> npos) {
 
 	auto new_pos = pos;
@@ -520,6 +1452,55 @@ bidirectional_slot_meta_positions<SlotSizeType<I>> bidirectional_link_to_filled(
 
 
 
+// Stores the values of [first, last) into the slots at the head of the singly linked list of empty slots, which has to hold at least 
+// as many of them, and appends those slots to the doubly linked list of filled slots as a single chain. The empty list is walked once, 
+// in the order of its slots: "fill" stores a value into its slot and returns its id, which is written to "out". If "fill" throws, 
+// the slots which were filled before it are still appended, and the exception is rethrown.
+template<typename L, typename I, typename O, typename F>
+// L models BidirectionalSlot_Iterator
+// I models InputIterator
+// O models OutputIterator
+// F models Function : id operator()(SlotSizeType<L> index, I it)
+inline
+O bidirectional_link_range_to_filled(L links, bidirectional_slot_meta_positions<SlotSizeType<L>> &pos, SlotSizeType<L> npos, 
+	I first, I last, O out, F fill) {
+
+	const auto head = pos.empty.first;
+	auto tail = npos;
+	auto index = head;
+
+	const auto splice = [&]() {
+		if (tail == npos) return;
+		if (pos.filled.first == npos) pos.filled.first = head;
+		else set_successor(iterator_slot(links, pos.filled.second), head);
+
+		if (tail == pos.empty.second) pos.empty = { npos, npos };
+		else pos.empty.first = index;
+
+		set_successor(iterator_slot(links, tail), npos);
+		pos.filled.second = tail;
+	};
+
+	try {
+		for (; first != last; ++first) {
+			auto &slot = iterator_slot(links, index);
+			*out = fill(index, first);
+			++out;
+			set_predecessor(slot, tail == npos ? pos.filled.second : tail);
+			tail = index;
+			index = get_successor(slot);
+		}
+	}
+	catch (...) {
+		splice();
+		throw;
+	}
+	splice();
+	return out;
+}
+
+
+
 // Links the slot with "filled_pos" index to singly linked list of empty slots. and removes it from the doubly linked list of filled slots.
 // That slot becomes the head of the empty list. If no other erasures follow this one, it will be used for next insertion.
 template<typename I>
@@ -540,7 +1521,7 @@ bidirectional_slot_meta_positions<SlotSizeType<I>> bidirectional_link_to_empty(I
 	}
 	else if (filled_pos == pos.filled.second) {
 		new_pos.filled.second = get_predecessor(slot);
-		set_successor(iterator_slot(first, new_pos.filled.first), npos);
+		set_successor(iterator_slot(first, new_pos.filled.second), npos);
 	}
 	else {
 		set_predecessor(iterator_slot(first, get_successor(slot)), get_predecessor(slot));
@@ -548,6 +1529,8 @@ bidirectional_slot_meta_positions<SlotSizeType<I>> bidirectional_link_to_empty(I
 	}
 
 	set_successor(slot, pos.empty.first);
+	if (pos.empty.first == npos)
+		new_pos.empty.second = filled_pos;
 	new_pos.empty.first = filled_pos;
 
 	return new_pos;
@@ -579,7 +1562,7 @@ bidirectional_slot_meta_positions<SlotSizeType<I>> versioned_bidirectional_link_
 	}
 	else if (filled_pos == pos.filled.second) {
 		new_pos.filled.second = get_predecessor(slot);
-		set_successor(iterator_slot(first, new_pos.filled.first), npos);
+		set_successor(iterator_slot(first, new_pos.filled.second), npos);
 	}
 	else {
 		set_predecessor(iterator_slot(first, get_successor(slot)), get_predecessor(slot));
@@ -600,6 +1583,132 @@ bidirectional_slot_meta_positions<SlotSizeType<I>> versioned_bidirectional_link_
 
 
 
+// Moves the slot with "index" index right after the slot with "after" index in the doubly linked list of filled slots.
+// If "after" is "npos" the slot becomes the head of the filled list. Returns the new head and tail of the filled list.
+template<typename I>
+// I models BidirectionalSlot_Iterator
+inline
+std::pair<SlotSizeType<I>, SlotSizeType<I>> bidirectional_relink_filled_after(I first, const std::pair<SlotSizeType<I>, SlotSizeType<I>> &filled,
+	SlotSizeType<I> npos, SlotSizeType<I> index, SlotSizeType<I> after) {
+
+	auto new_filled = filled;
+	auto &slot = iterator_slot(first, index);
+	const auto prev = get_predecessor(slot);
+	const auto next = get_successor(slot);
+
+	if (prev == after) return new_filled;
+
+	if (prev != npos) set_successor(iterator_slot(first, prev), next);
+	else new_filled.first = next;
+	if (next != npos) set_predecessor(iterator_slot(first, next), prev);
+	else new_filled.second = prev;
+
+	const auto after_next = after != npos ? get_successor(iterator_slot(first, after)) : new_filled.first;
+	set_predecessor(slot, after);
+	set_successor(slot, after_next);
+	if (after != npos) set_successor(iterator_slot(first, after), index);
+	else new_filled.first = index;
+	if (after_next != npos) set_predecessor(iterator_slot(first, after_next), index);
+	else new_filled.second = index;
+
+	return new_filled;
+}
+
+
+
+// Moves the filled slot with "index" index right after the closest filled slot before it, according to "occupancy".
+// If there is none, the slot becomes the head of the filled list. Returns the new head and tail of the filled list.
+template<typename I, typename B>
+// I models BidirectionalSlot_Iterator
+// B models OccupancyBitmap
+inline
+std::pair<SlotSizeType<I>, SlotSizeType<I>> bidirectional_relink_filled_in_order(I first, const std::pair<SlotSizeType<I>, SlotSizeType<I>> &filled,
+	SlotSizeType<I> npos, SlotSizeType<I> index, const B &occupancy) {
+
+	const auto after = occupancy.find_prev_set(index);
+	return bidirectional_relink_filled_after(first, filled, npos, index, after == B::npos ? npos : static_cast<SlotSizeType<I>>(after));
+}
+
+
+
+// Appends the slot with "index" index to the singly linked list of empty slots. Returns the new head and tail of the empty list.
+template<typename I>
+// I models ForwardSlot_Iterator
+inline
+std::pair<SlotSizeType<I>, SlotSizeType<I>> forward_link_empty_to_tail(I first, const std::pair<SlotSizeType<I>, SlotSizeType<I>> &empty,
+	SlotSizeType<I> npos, SlotSizeType<I> index) {
+
+	auto new_empty = empty;
+	set_successor(iterator_slot(first, index), npos);
+	if (empty.second != npos) set_successor(iterator_slot(first, empty.second), index);
+	else new_empty.first = index;
+	new_empty.second = index;
+	return new_empty;
+}
+
+
+
+// Links the slot with "filled_pos" index to the singly linked list of empty slots, and removes it from the doubly linked list of filled slots,
+// while a defragmenting pass relinks empty slots. The empty list then holds all empty slots before "end", in ascending order.
+// A slot before "end" is linked right after the closest empty slot before it, according to "occupancy". A slot from "end" onward 
+// isn't linked, as the pass links it once it gets there.
+template<typename I, typename B>
+// I models BidirectionalSlot_Iterator
+// B models OccupancyBitmap
+inline
+bidirectional_slot_meta_positions<SlotSizeType<I>> bidirectional_link_to_empty_in_order(I first, const bidirectional_slot_meta_positions<SlotSizeType<I>> &pos,
+	SlotSizeType<I> npos, SlotSizeType<I> filled_pos, SlotSizeType<I> end, const B &occupancy) {
+
+	auto new_pos = pos;
+	auto &slot = iterator_slot(first, filled_pos);
+	const auto prev = get_predecessor(slot);
+	const auto next = get_successor(slot);
+
+	if (prev != npos) set_successor(iterator_slot(first, prev), next);
+	else new_pos.filled.first = next;
+	if (next != npos) set_predecessor(iterator_slot(first, next), prev);
+	else new_pos.filled.second = prev;
+
+	if (filled_pos >= end) return new_pos;
+
+	const auto before = occupancy.find_prev_clear(filled_pos);
+	if (before == B::npos) {
+		set_successor(slot, pos.empty.first);
+		if (pos.empty.first == npos) new_pos.empty.second = filled_pos;
+		new_pos.empty.first = filled_pos;
+	}
+	else {
+		const auto before_pos = static_cast<SlotSizeType<I>>(before);
+		auto &before_slot = iterator_slot(first, before_pos);
+		set_successor(slot, get_successor(before_slot));
+		set_successor(before_slot, filled_pos);
+		if (pos.empty.second == before_pos) new_pos.empty.second = filled_pos;
+	}
+	return new_pos;
+}
+
+
+
+// Links all of the first "size" slots whose bits in "occupancy" are clear into the singly linked list of empty slots, 
+// in ascending order. Returns the head and the tail of the empty list.
+template<typename I, typename B>
+// I models ForwardSlot_Iterator
+// B models OccupancyBitmap
+inline
+std::pair<SlotSizeType<I>, SlotSizeType<I>> forward_empty_unoccupied_slots(I first, SlotSizeType<I> size, const B &occupancy, SlotSizeType<I> npos) {
+	using size_type = SlotSizeType<I>;
+	std::pair<size_type, size_type> empty{ npos, npos };
+	occupancy.for_each_clear(size, [&](std::size_t i) {
+		if (empty.second != npos) set_successor(iterator_slot(first, empty.second), static_cast<size_type>(i));
+		else empty.first = static_cast<size_type>(i);
+		empty.second = static_cast<size_type>(i);
+	});
+	if (empty.second != npos) set_successor(iterator_slot(first, empty.second), npos);
+	return empty;
+}
+
+
+
 // Empties all slots in memory successive order.
 // Does array traversal.
 // Word empty is intentonally used instead of link, because in the "set_successor" function object, next to seetting the successor,
@@ -611,7 +1720,7 @@ bidirectional_slot_meta_positions<SlotSizeType<I>> versioned_bidirectional_link_
 template<typename I, typename S, typename P>
 // I models RandomAccessIterator
 // S models Integral
-// P models BinaryPredicate : void operator()(ValueType<I> &, S);
+// P models BinaryPredicate : void operator()(IteratorValueType<I> &, S);
 inline
 void forward_empty_all_slots_basis(I first, I last, S start_index, S npos, P set_successor) {
 	if (first == last) return;
@@ -627,28 +1736,28 @@ template<typename I>
 // I models ForwardSlot_Iterator
 inline
 void forward_empty_all_slots(I first, I last, SlotSizeType<I> start_index, SlotSizeType<I> npos) {
-	forward_empty_all_slots_basis(first, last, start_index, npos, set_successor_obj<ValueType<I>>{});
+	forward_empty_all_slots_basis(first, last, start_index, npos, set_successor_obj<IteratorValueType<I>>{});
 }
 
 template<typename I>
 // I models ForwardSlot_Iterator
 inline
 void trivial_forward_empty_all_slots(I first, I last, SlotSizeType<I> start_index, SlotSizeType<I> npos) {
-	forward_empty_all_slots_basis(first, last, start_index, npos, trivial_set_successor_obj<ValueType<I>>{});
+	forward_empty_all_slots_basis(first, last, start_index, npos, trivial_set_successor_obj<IteratorValueType<I>>{});
 }
 
 template<typename I>
 // I models ForwardSlot_Iterator
 inline
 void versioned_trivial_forward_empty_all_slots(I first, I last, SlotSizeType<I> start_index, SlotSizeType<I> npos) {
-	forward_empty_all_slots_basis(first, last, start_index, npos, versioned_trivial_set_successor_obj<ValueType<I>>{});
+	forward_empty_all_slots_basis(first, last, start_index, npos, versioned_trivial_set_successor_obj<IteratorValueType<I>>{});
 }
 
 template<typename I>
 // I models ForwardSlot_Iterator
 inline
 void versioned_trivial_forward_empty_and_reset_all_slots(I first, I last, SlotSizeType<I> start_index, SlotSizeType<I> npos) {
-	forward_empty_all_slots_basis(first, last, start_index, npos, versioned_trivial_set_successor_resetter_obj<ValueType<I>>{});
+	forward_empty_all_slots_basis(first, last, start_index, npos, versioned_trivial_set_successor_resetter_obj<IteratorValueType<I>>{});
 }
 
 
@@ -656,35 +1765,35 @@ template<typename I>
 // I models ForwardSlot_Iterator
 inline
 void controlled_forward_empty_all_slots(I first, I last, SlotSizeType<I> start_index, SlotSizeType<I> npos, const SlotValueType<I> &value) {
-	forward_empty_all_slots_basis(first, last, start_index, npos, controlled_set_successor_obj<ValueType<I>>{ value });
+	forward_empty_all_slots_basis(first, last, start_index, npos, controlled_set_successor_obj<IteratorValueType<I>>{ value });
 }
 
 template<typename I>
 // I models VersionedForwardSlot_Iterator
 inline
 void versioned_forward_empty_all_slots(I first, I last, SlotSizeType<I> start_index, SlotSizeType<I> npos) {
-	forward_empty_all_slots_basis(first, last, start_index, npos, versioned_set_successor_obj<ValueType<I>>{});
+	forward_empty_all_slots_basis(first, last, start_index, npos, versioned_set_successor_obj<IteratorValueType<I>>{});
 }
 
 template<typename I>
 // I models VersionedForwardSlot_Iterator
 inline
 void versioned_forward_empty_and_reset_all_slots(I first, I last, SlotSizeType<I> start_index, SlotSizeType<I> npos) {
-	forward_empty_all_slots_basis(first, last, start_index, npos, versioned_set_successor_resetter_obj<ValueType<I>>{});
+	forward_empty_all_slots_basis(first, last, start_index, npos, versioned_set_successor_resetter_obj<IteratorValueType<I>>{});
 }
 
 template<typename I>
 // I models VersionedForwardSlot_Iterator
 inline
 void regulated_forward_empty_all_slots(I first, I last, SlotSizeType<I> start_index, SlotSizeType<I> npos, const SlotValueType<I> &value) {
-	forward_empty_all_slots_basis(first, last, start_index, npos, regulated_set_successor_obj<ValueType<I>>{ value });
+	forward_empty_all_slots_basis(first, last, start_index, npos, regulated_set_successor_obj<IteratorValueType<I>>{ value });
 }
 
 template<typename I>
 // I models VersionedForwardSlot_Iterator
 inline
 void regulated_forward_empty_and_reset_all_slots(I first, I last, SlotSizeType<I> start_index, SlotSizeType<I> npos, const SlotValueType<I> &value) {
-	forward_empty_all_slots_basis(first, last, start_index, npos, regulated_set_successor_resetter_obj<ValueType<I>>{ value });
+	forward_empty_all_slots_basis(first, last, start_index, npos, regulated_set_successor_resetter_obj<IteratorValueType<I>>{ value });
 }
 
 
@@ -692,20 +1801,82 @@ template<typename I>
 // I models VersionedSlot_Iterator
 inline
 void versioned_reset(I first, I last) {
-	std::for_each(first, last, resetter_obj<ValueType<I>>{});
+	std::for_each(first, last, resetter_obj<IteratorValueType<I>>{});
+}
+
+// Sets versions of all slots in the range to "version".
+template<typename I>
+// I models VersionedSlot_Iterator
+inline
+void versioned_set_version(I first, I last, VersionType<IteratorValueType<I>> version) {
+	for (; first != last; ++first) (*first).version = version;
+}
+
+// Largest version of all slots in the range, or "version" if none is larger.
+template<typename I>
+// I models VersionedSlot_Iterator
+inline
+VersionType<IteratorValueType<I>> versioned_max_version(I first, I last, VersionType<IteratorValueType<I>> version) {
+	for (; first != last; ++first) version = (std::max)(version, (*first).version);
+	return version;
+}
+
+
+// Removes all slots with index "size" or higher from the singly linked list of empty slots, which goes from "empty.first"
+// to "empty.second". Order of other slots is kept. Returns the new head and tail of the empty list.
+template<typename I, typename G, typename P>
+// I models ForwardSlot_Iterator
+// G models UnaryFunction : SlotSizeType<I> operator()(IteratorValueType<I>&);
+// P models BinaryProcedure : void operator()(IteratorValueType<I>&, SlotSizeType<I>);
+inline
+std::pair<SlotSizeType<I>, SlotSizeType<I>> forward_unlink_slots_from_basis(I first, const std::pair<SlotSizeType<I>, SlotSizeType<I>> &empty,
+	SlotSizeType<I> size, SlotSizeType<I> npos, G get_successor, P set_successor) {
+
+	std::pair<SlotSizeType<I>, SlotSizeType<I>> kept{ npos, npos };
+	if (empty.first == npos) return kept;
+
+	for (auto index = empty.first; ; ) {
+		auto &slot = iterator_slot(first, index);
+		const auto next = get_successor(slot);
+		if (index < size) {
+			if (kept.second != npos) set_successor(iterator_slot(first, kept.second), index);
+			else kept.first = index;
+			kept.second = index;
+		}
+		if (index == empty.second) break;
+		index = next;
+	}
+	if (kept.second != npos) set_successor(iterator_slot(first, kept.second), npos);
+	return kept;
+}
+
+template<typename I>
+// I models ForwardSlot_Iterator
+inline
+std::pair<SlotSizeType<I>, SlotSizeType<I>> forward_unlink_slots_from(I first, const std::pair<SlotSizeType<I>, SlotSizeType<I>> &empty,
+	SlotSizeType<I> size, SlotSizeType<I> npos) {
+	return forward_unlink_slots_from_basis(first, empty, size, npos, get_successor_obj<IteratorValueType<I>>{}, set_successor_obj<IteratorValueType<I>>{});
+}
+
+template<typename I>
+// I models TrivialSlot_Iterator
+inline
+std::pair<SlotSizeType<I>, SlotSizeType<I>> trivial_forward_unlink_slots_from(I first, const std::pair<SlotSizeType<I>, SlotSizeType<I>> &empty,
+	SlotSizeType<I> size, SlotSizeType<I> npos) {
+	return forward_unlink_slots_from_basis(first, empty, size, npos, trivial_get_successor_obj<IteratorValueType<I>>{}, trivial_set_successor_obj<IteratorValueType<I>>{});
 }
 
 
 template<typename I, typename P>
 // I models ForwardSlot_Iterator
-// P models BinaryPredicate : void operator()(ValueType<I> &, S);
+// P models BinaryPredicate : void operator()(IteratorValueType<I> &, S);
 inline
 std::pair<SlotSizeType<I>, SlotSizeType<I>> forward_empty_all_slots_with_meta_basis(I first, SlotSizeType<I> new_empty, I last,
 	const std::pair<SlotSizeType<I>, SlotSizeType<I>> &empty, SlotSizeType<I> npos, P set_successor) {
 	if (empty.second != npos)
 		set_successor(iterator_slot(first, empty.second), new_empty);
 
-	forward_empty_all_slots_basis(first + static_cast<DifferenceType<I>>(new_empty), last, new_empty, npos, set_successor);
+	forward_empty_all_slots_basis(first + static_cast<IteratorDifferenceType<I>>(new_empty), last, new_empty, npos, set_successor);
 
 	const auto last_empty = static_cast<SlotSizeType<I>>(last - first - 1);
 	return empty.first != npos ? std::pair<SlotSizeType<I>, SlotSizeType<I>>{ empty.first, last_empty } :
@@ -717,7 +1888,7 @@ template<typename I>
 inline
 std::pair<SlotSizeType<I>, SlotSizeType<I>> forward_empty_all_slots_with_meta(I first, SlotSizeType<I> new_empty, I last,
 	const std::pair<SlotSizeType<I>, SlotSizeType<I>> &empty, SlotSizeType<I> npos) {
-	return forward_empty_all_slots_with_meta_basis(first, new_empty, last, empty, npos, set_successor_obj<ValueType<I>>{});
+	return forward_empty_all_slots_with_meta_basis(first, new_empty, last, empty, npos, set_successor_obj<IteratorValueType<I>>{});
 }
 
 template<typename I>
@@ -725,7 +1896,7 @@ template<typename I>
 inline
 std::pair<SlotSizeType<I>, SlotSizeType<I>> trivial_forward_empty_all_slots_with_meta(I first, SlotSizeType<I> new_empty, I last,
 	const std::pair<SlotSizeType<I>, SlotSizeType<I>> &empty, SlotSizeType<I> npos) {
-	return forward_empty_all_slots_with_meta_basis(first, new_empty, last, empty, npos, trivial_set_successor_obj<ValueType<I>>{});
+	return forward_empty_all_slots_with_meta_basis(first, new_empty, last, empty, npos, trivial_set_successor_obj<IteratorValueType<I>>{});
 }
 
 
@@ -741,8 +1912,8 @@ std::pair<SlotSizeType<I>, SlotSizeType<I>> trivial_forward_empty_all_slots_with
 template<typename I, typename S, typename P1, typename P2>
 // I models RandomAccessIterator
 // S models Integral
-// P1 models BinaryPredicate : void operator()(ValueType<I> &, S);
-// P2 models UnaryPredicate : S operator()(ValueType<I> &);
+// P1 models BinaryPredicate : void operator()(IteratorValueType<I> &, S);
+// P2 models UnaryPredicate : S operator()(IteratorValueType<I> &);
 inline
 S forward_empty_filled_slots_basis(I first, S empty, S filled, S npos, P1 set_successor, P2 get_successor) {
 	if (filled == npos) return empty;
@@ -763,28 +1934,28 @@ template<typename I>
 // I models ForwardSlot_Iterator
 inline
 SlotSizeType<I> forward_empty_filled_slots(I first, SlotSizeType<I> empty, SlotSizeType<I> filled, SlotSizeType<I> npos) {
-	return forward_empty_filled_slots_basis(first, empty, filled, npos, set_successor_obj<ValueType<I>>{}, get_successor_obj<ValueType<I>>{});
+	return forward_empty_filled_slots_basis(first, empty, filled, npos, set_successor_obj<IteratorValueType<I>>{}, get_successor_obj<IteratorValueType<I>>{});
 }
 
 template<typename I>
 // I models ForwardSlot_Iterator
 inline
 SlotSizeType<I> controlled_forward_empty_filled_slots(I first, SlotSizeType<I> empty, SlotSizeType<I> filled, SlotSizeType<I> npos, const SlotValueType<I> &value) {
-	return forward_empty_filled_slots_basis(first, empty, filled, npos, controlled_set_successor_obj<ValueType<I>>{value}, get_successor_obj<ValueType<I>>{});
+	return forward_empty_filled_slots_basis(first, empty, filled, npos, controlled_set_successor_obj<IteratorValueType<I>>{value}, get_successor_obj<IteratorValueType<I>>{});
 }
 
 template<typename I>
 // I models VersionedForwardSlot_Iterator
 inline
 SlotSizeType<I> versioned_forward_empty_filled_slots(I first, SlotSizeType<I> empty, SlotSizeType<I> filled, SlotSizeType<I> npos) {
-	return forward_empty_filled_slots_basis(first, empty, filled, npos, versioned_set_successor_obj<ValueType<I>>{}, get_successor_obj<ValueType<I>>{});
+	return forward_empty_filled_slots_basis(first, empty, filled, npos, versioned_set_successor_obj<IteratorValueType<I>>{}, get_successor_obj<IteratorValueType<I>>{});
 }
 
 template<typename I>
 // I models VersionedForwardSlot_Iterator
 inline
 SlotSizeType<I> regulated_forward_empty_filled_slots(I first, SlotSizeType<I> empty, SlotSizeType<I> filled, SlotSizeType<I> npos, const SlotValueType<I> &value) {
-	return forward_empty_filled_slots_basis(first, empty, filled, npos, regulated_set_successor_obj<ValueType<I>>{value}, get_successor_obj<ValueType<I>>{});
+	return forward_empty_filled_slots_basis(first, empty, filled, npos, regulated_set_successor_obj<IteratorValueType<I>>{value}, get_successor_obj<IteratorValueType<I>>{});
 }
 
 
@@ -795,14 +1966,15 @@ SlotSizeType<I> regulated_forward_empty_filled_slots(I first, SlotSizeType<I> em
 template<typename I1, typename I2, typename P>
 // I1 models RandomAccessIterator
 // I2 models RandomAccessIterator
-// P1 models BinaryPredicate : void operator()(ValueType<I> &, S);
+// P1 models BinaryPredicate : void operator()(IteratorValueType<I> &, S);
 inline
-SlotSizeType<I1> forward_empty_filled_dense_slots_basis(I1 &first_position, I1 last_position, I2 &first_slot, SlotSizeType<I1> empty, P p) {
+SlotSizeType<I2> forward_empty_filled_dense_slots_basis(I1 first_position, I1 last_position, I2 first_slot, SlotSizeType<I2> empty, P p) {
 	while (first_position != last_position) {
 		const auto filled = *first_position;
 		auto &slot = iterator_slot(first_slot, filled);
 		p(slot, empty);
 		empty = filled;
+		++first_position;
 	}
 	return empty;
 }
@@ -812,423 +1984,766 @@ template<typename I1, typename I2>
 // I1 models ForwardSlotPos_Iterator
 // I2 models TrivialSlot_Iterator
 inline
-SlotSizeType<I1> forward_empty_filled_dense_slots(I1 &first_position, I1 last_position, I2 &first_slot, SlotSizeType<I1> empty) {
-	return forward_empty_filled_dense_slots_basis(first_position, last_position, first_slot, empty, trivial_set_successor_obj<ValueType<I2>>{});
+SlotSizeType<I2> forward_empty_filled_dense_slots(I1 first_position, I1 last_position, I2 first_slot, SlotSizeType<I2> empty) {
+	return forward_empty_filled_dense_slots_basis(first_position, last_position, first_slot, empty, trivial_set_successor_obj<IteratorValueType<I2>>{});
 }
 
 template<typename I1, typename I2>
 // I1 models ForwardSlotPos_Iterator
 // I2 models TrivialSlot_Iterator
 inline
-SlotSizeType<I1> versioned_forward_empty_filled_dense_slots(I1 &first_position, I1 last_position, I2 &first_slot, SlotSizeType<I1> empty) {
-	return forward_empty_filled_dense_slots_basis(first_position, last_position, first_slot, empty, versioned_trivial_set_successor_obj<ValueType<I2>>{});
+SlotSizeType<I2> versioned_forward_empty_filled_dense_slots(I1 first_position, I1 last_position, I2 first_slot, SlotSizeType<I2> empty) {
+	return forward_empty_filled_dense_slots_basis(first_position, last_position, first_slot, empty, versioned_trivial_set_successor_obj<IteratorValueType<I2>>{});
 }
 
 
 
-template<typename T,
-	typename S = default_size_type,
-	typename A = default_allocator_type<T>>
-class slot_list {
-public:
-	using value_type = T;
-	using size_type = S;
-	using id_type = size_type;
-	using slot_type = sl_slot_type<value_type, size_type>;
-	using container_type = sl_container_type<slot_type, A>;
+//**************************************************************************************************
+// Binary snapshots. "save" writes the whole state of a container, including the lists of empty slots
+// and the versions, so "load" restores it exactly and ids stay valid across restarts.
+// Values go through "snapshot_traits", which copies the bytes of trivially copyable types. Arrays of
+// such values are written and read in a few large blocks, one per chunk or one per vector.
+// A snapshot is meant to be loaded by the same build on the same platform. Type sizes and byte order are
+// checked by the header, but not converted.
+//
+// O models BinaryOutputStream : void write(const char*, n)
+// I models BinaryInputStream : void read(char*, n), and is contextually convertible to bool
+// E.g. std::ofstream and std::ifstream opened with std::ios::binary.
+//**************************************************************************************************
 
-private:
-	static constexpr auto npos = max_type_value<size_type>();
-	using meta_positions_type = bidirectional_slot_meta_positions<S>;
+// Tells how a value is written to and read from a snapshot. It may be specialized for types which
+// aren't trivially copyable, E.g :
+// template<> struct rea::snapshot_traits<std::string> {
+//    static constexpr bool is_bitwise = false;
+//    template<typename O> static void write(O &os, const std::string &v) { ... }
+//    template<typename I> static void read(I &is, std::string &v) { ... }
+// };
+// "is_bitwise" must be false unless the value is just a copy of its bytes.
+template<typename T, typename = void>
+struct snapshot_traits {
+	static constexpr bool is_bitwise = false;
+};
 
-	container_type slots;
-	meta_positions_type pos;
-	size_type filled_size;
+template<typename T>
+struct snapshot_traits<T, typename std::enable_if<std::is_trivially_copyable<T>::value>::type> {
+	static constexpr bool is_bitwise = true;
 
-	void _reserve(size_type s) {
-		size_type prev_size = slots.size();
-		slots.resize(s);
-		pos.empty = forward_empty_all_slots_with_meta(slots.begin(), prev_size, slots.end(), pos.empty, npos);
-	}
+	template<typename O>
+	static void write(O &os, const T &v) { os.write(reinterpret_cast<const char*>(std::addressof(v)), sizeof(T)); }
 
-	template<typename U>
-	id_type _insert(U&& v) {
-		pos = bidirectional_link_to_filled(slots.begin(), pos, npos);
-		iterator_slot(slots.begin(), pos.filled.second).value = std::forward<U>(v);
-		++filled_size;
-		return pos.filled.second;
-	}
+	template<typename I>
+	static void read(I &is, T &v) { is.read(reinterpret_cast<char*>(std::addressof(v)), sizeof(T)); }
+};
 
-	id_type _erase(size_type index) {
-		id_type next = id_next(index);
-		pos = bidirectional_link_to_empty(slots.begin(), pos, npos, index);
-		--filled_size;
-		return next;
-	}
+template<typename T1, typename T2>
+struct snapshot_traits<std::pair<T1, T2>, typename std::enable_if<!std::is_trivially_copyable<std::pair<T1, T2>>::value>::type> {
+	static constexpr bool is_bitwise = false;
 
-	void _clear() {
-		if (is_over_breakoff(capacity(), size())) {
-			forward_empty_all_slots(slots.begin(), slots.end(), size_type(0), npos);
-			pos = meta_positions_type{ { 0, slots.size() - 1 },{ npos, npos } };
-		}
-		else {
-			const auto empty_pos = forward_empty_filled_slots(slots.begin(), pos.empty.first, pos.filled.first, npos);
-			pos = meta_positions_type{ { empty_pos, pos.empty.second },{ npos, npos } };
-		}
-		filled_size = size_type(0);
+	template<typename O>
+	static void write(O &os, const std::pair<T1, T2> &v) {
+		snapshot_traits<T1>::write(os, v.first);
+		snapshot_traits<T2>::write(os, v.second);
 	}
 
+	template<typename I>
+	static void read(I &is, std::pair<T1, T2> &v) {
+		snapshot_traits<T1>::read(is, v.first);
+		snapshot_traits<T2>::read(is, v.second);
+	}
+};
 
-public:
-	slot_list(AllocatorType<container_type> &&alloc = AllocatorType<container_type>{}) :
-		slots(std::move(alloc)),
-		filled_size(size_type(0)),
-		pos({ { npos, npos },{ npos, npos } })
-	{}
-
-	slot_list(const AllocatorType<container_type> &alloc) :
-		slots(alloc),
-		filled_size(size_type(0)),
-		pos({ { npos, npos },{ npos, npos } })
-	{}
+template<typename S>
+struct snapshot_traits<bidirectional_slot_meta_positions<S>> {
+	static constexpr bool is_bitwise = false;
 
-	value_type& id_value(id_type id) {
-		return iterator_slot(slots.begin(), id).value;
+	template<typename O>
+	static void write(O &os, const bidirectional_slot_meta_positions<S> &v) {
+		snapshot_traits<std::pair<S, S>>::write(os, v.filled);
+		snapshot_traits<std::pair<S, S>>::write(os, v.empty);
 	}
 
-	const value_type& id_value(id_type id) const {
-		return iterator_slot(slots.cbegin(), id).value;
+	template<typename I>
+	static void read(I &is, bidirectional_slot_meta_positions<S> &v) {
+		snapshot_traits<std::pair<S, S>>::read(is, v.filled);
+		snapshot_traits<std::pair<S, S>>::read(is, v.empty);
 	}
+};
 
-	id_type id_next(id_type id) const {
-		return iterator_slot(slots.cbegin(), id).next;
-	}
+template<typename O, typename T>
+// O models BinaryOutputStream
+inline
+void snapshot_write(O &os, const T &v) {
+	snapshot_traits<T>::write(os, v);
+}
 
-	bool id_is_end(id_type id) const {
-		return id == npos;
-	}
+template<typename I, typename T>
+// I models BinaryInputStream
+inline
+bool snapshot_read(I &is, T &v) {
+	snapshot_traits<T>::read(is, v);
+	return static_cast<bool>(is);
+}
 
-	constexpr static void reset_version_counts() {
+// Slots which hold a value are written field by field, unless both the slot and the value are bitwise.
+template<typename T>
+constexpr bool snapshot_is_bitwise(const T*) {
+	return snapshot_traits<T>::is_bitwise;
+}
 
-	}
+template<typename T, typename S>
+constexpr bool snapshot_is_bitwise(const bidirectional_slot<T, S>*) {
+	return std::is_trivially_copyable<bidirectional_slot<T, S>>::value && snapshot_traits<T>::is_bitwise;
+}
 
-	void clear_and_reset_version_counts() {
-		clear();
-	}
+template<typename T, typename S, typename V>
+constexpr bool snapshot_is_bitwise(const versioned_bidirectional_slot<T, S, V>*) {
+	return std::is_trivially_copyable<versioned_bidirectional_slot<T, S, V>>::value && snapshot_traits<T>::is_bitwise;
+}
 
-	constexpr static bool id_is_valid(id_type id){
-		return true;
-	}
+template<typename O, typename T>
+inline
+void snapshot_write_element(O &os, const T &v) {
+	snapshot_write(os, v);
+}
 
-	id_type id_begin() const {
-		return pos.filled.first;
-	}
+template<typename O, typename T, typename S>
+inline
+void snapshot_write_element(O &os, const bidirectional_slot<T, S> &slot) {
+	snapshot_write(os, slot.prev);
+	snapshot_write(os, slot.next);
+	snapshot_write(os, slot.value);
+}
 
-	size_type size() const {
-		return filled_size;
-	}
+template<typename O, typename T, typename S, typename V>
+inline
+void snapshot_write_element(O &os, const versioned_bidirectional_slot<T, S, V> &slot) {
+	snapshot_write(os, slot.prev);
+	snapshot_write(os, slot.next);
+	snapshot_write(os, slot.version);
+	snapshot_write(os, slot.value);
+}
 
-	size_type capacity() const {
-		return slots.size();
-	}
+template<typename I, typename T>
+inline
+void snapshot_read_element(I &is, T &v) {
+	snapshot_read(is, v);
+}
 
-	void reserve(size_type s) {
-		if (s > capacity()) _reserve(s);
-	}
+template<typename I, typename T, typename S>
+inline
+void snapshot_read_element(I &is, bidirectional_slot<T, S> &slot) {
+	snapshot_read(is, slot.prev);
+	snapshot_read(is, slot.next);
+	snapshot_read(is, slot.value);
+}
 
-	id_type insert(const value_type &v) {
-		if (capacity() == size())
-			_reserve(grow_size(size()));
-		return _insert(v);
-	}
+template<typename I, typename T, typename S, typename V>
+inline
+void snapshot_read_element(I &is, versioned_bidirectional_slot<T, S, V> &slot) {
+	snapshot_read(is, slot.prev);
+	snapshot_read(is, slot.next);
+	snapshot_read(is, slot.version);
+	snapshot_read(is, slot.value);
+}
 
-	id_type insert(value_type &&v) {
-		if (capacity() == size())
-			_reserve(grow_size(size()));
-		return _insert(std::move(v));
-	}
+template<typename O, typename T>
+inline
+void snapshot_write_elements(O &os, const T *first, std::size_t n, std::true_type) {
+	os.write(reinterpret_cast<const char*>(first), n * sizeof(T));
+}
 
-	id_type erase(id_type id) {
-		return _erase(static_cast<size_type>(id));
-	}
+template<typename O, typename T>
+inline
+void snapshot_write_elements(O &os, const T *first, std::size_t n, std::false_type) {
+	for (const auto last = first + n; first != last; ++first)
+		snapshot_write_element(os, *first);
+}
 
-	void clear() {
-		_clear();
-	}
+template<typename I, typename T>
+inline
+void snapshot_read_elements(I &is, T *first, std::size_t n, std::true_type) {
+	is.read(reinterpret_cast<char*>(first), n * sizeof(T));
+}
 
-	bool empty() const {
-		return slots.empty();
-	}
-};
+template<typename I, typename T>
+inline
+void snapshot_read_elements(I &is, T *first, std::size_t n, std::false_type) {
+	for (const auto last = first + n; first != last && is; ++first)
+		snapshot_read_element(is, *first);
+}
 
+template<typename T>
+using snapshot_bitwise_tag = std::integral_constant<bool, snapshot_is_bitwise(static_cast<const T*>(nullptr))>;
+
+// Containers are written as their size, followed by their elements.
+template<typename O, typename T, typename A>
+// O models BinaryOutputStream
+void snapshot_write_container(O &os, const std::vector<T, A> &c) {
+	snapshot_write(os, static_cast<std::uint64_t>(c.size()));
+	snapshot_write_elements(os, c.data(), c.size(), snapshot_bitwise_tag<T>{});
+}
 
+template<typename O, typename T, typename A, unsigned ChunkBits>
+// O models BinaryOutputStream
+void snapshot_write_container(O &os, const chunked_slot_container<T, A, ChunkBits> &c) {
+	using container_type = chunked_slot_container<T, A, ChunkBits>;
+	snapshot_write(os, static_cast<std::uint64_t>(c.size()));
+	for (std::size_t i = 0; i < c.size(); i += container_type::chunk_size)
+		snapshot_write_elements(os, std::addressof(c[i]), (std::min)(container_type::chunk_size, c.size() - i), snapshot_bitwise_tag<T>{});
+}
 
+template<typename I, typename C>
+// I models BinaryInputStream
+// C models DenseContainer or SlotContainer
+bool snapshot_read_container_size(I &is, const C &c, std::size_t &n) {
+	std::uint64_t size = 0;
+	if (!snapshot_read(is, size) || size > c.max_size()) return false;
+	n = static_cast<std::size_t>(size);
+	return true;
+}
 
-template<typename T,
-	typename E = get_empty<T>,
-	typename S = default_size_type,
-	typename A = default_allocator_type<T>>
-class controlled_slot_list {
-public:
-	using value_type = T;
-	using get_empty_type = E;
-	using size_type = S;
-	using id_type = size_type;
-	using slot_type = sl_controlled_slot_type<value_type, size_type>;
-	using container_type = sl_container_type<slot_type, A>;
+template<typename I, typename T, typename A>
+// I models BinaryInputStream
+bool snapshot_read_container(I &is, std::vector<T, A> &c) {
+	std::size_t n = 0;
+	if (!snapshot_read_container_size(is, c, n)) return false;
+	c.clear();
+	c.resize(n);
+	snapshot_read_elements(is, c.data(), n, snapshot_bitwise_tag<T>{});
+	return static_cast<bool>(is);
+}
 
+template<typename I, typename T, typename A, unsigned ChunkBits>
+// I models BinaryInputStream
+bool snapshot_read_container(I &is, chunked_slot_container<T, A, ChunkBits> &c) {
+	using container_type = chunked_slot_container<T, A, ChunkBits>;
+	std::size_t n = 0;
+	if (!snapshot_read_container_size(is, c, n)) return false;
+	c.resize(n);
+	for (std::size_t i = 0; i < n && is; i += container_type::chunk_size)
+		snapshot_read_elements(is, std::addressof(c[i]), (std::min)(container_type::chunk_size, n - i), snapshot_bitwise_tag<T>{});
+	return static_cast<bool>(is);
+}
 
-private:
-	static constexpr auto npos = max_type_value<size_type>();
-	using meta_positions_type = bidirectional_slot_meta_positions<S>;
+// Kind of the container which wrote a snapshot. 
+enum class snapshot_kind : std::uint32_t {
+	slot_list = 1,
+	controlled_slot_list,
+	versioned_slot_list,
+	regulated_slot_list,
+	split_slot_list,
+	versioned_split_slot_list,
+	slot_map,
+	versioned_slot_map
+};
 
-	container_type slots;
-	meta_positions_type pos;
-	size_type filled_size;
-	get_empty_type get_empty_obj;
+// "REA1" in little endian, so a snapshot of the other byte order fails the check.
+constexpr std::uint32_t snapshot_magic = 0x31414552;
 
-	void _reserve(size_type s) {
-		slot_type empty_slot{ get_empty_obj() };
-		size_type prev_size = slots.size();
-		slots.resize(s, empty_slot);
-		pos.empty = forward_empty_all_slots_with_meta(slots.begin(), prev_size, slots.end(), pos.empty, npos);
-	}
+// Every snapshot starts with the magic number, the kind of the container, and the sizes of its types.
+template<typename O>
+// O models BinaryOutputStream
+void snapshot_write_header(O &os, snapshot_kind kind, std::size_t size_bytes, std::size_t version_bytes, std::size_t value_bytes) {
+	const std::uint32_t header[] = { snapshot_magic, static_cast<std::uint32_t>(kind), 
+		static_cast<std::uint32_t>(size_bytes), static_cast<std::uint32_t>(version_bytes), static_cast<std::uint32_t>(value_bytes) };
+	snapshot_write(os, header);
+}
 
-	template<typename U>
-	id_type _insert(U&& v) {
-		pos = bidirectional_link_to_filled(slots.begin(), pos, npos);
-		iterator_slot(slots.begin(), pos.filled.second).value = std::forward<U>(v);
-		++filled_size;
-		return pos.filled.second;
-	}
+template<typename I>
+// I models BinaryInputStream
+bool snapshot_read_header(I &is, snapshot_kind kind, std::size_t size_bytes, std::size_t version_bytes, std::size_t value_bytes) {
+	const std::uint32_t expected[] = { snapshot_magic, static_cast<std::uint32_t>(kind),
+		static_cast<std::uint32_t>(size_bytes), static_cast<std::uint32_t>(version_bytes), static_cast<std::uint32_t>(value_bytes) };
+	std::uint32_t header[5] = {};
+	return snapshot_read(is, header) && std::equal(std::begin(header), std::end(header), std::begin(expected));
+}
 
-	id_type _erase(size_type index) {
-		id_type next = id_next(index);
-		pos = bidirectional_link_to_empty(slots.begin(), pos, npos, index);
-		iterator_slot(slots.begin(), index).value = get_empty_obj();
-		--filled_size;
-		return next;
-	}
 
-	void _clear() {
-		if (is_over_breakoff(capacity(), size())) {
-			controlled_forward_empty_all_slots(slots.begin(), slots.end(), size_type(0), npos, get_empty_obj());
-			pos = meta_positions_type{ { 0, slots.size() - 1 },{ npos, npos } };
-		}
-		else {
-			const auto empty_pos = controlled_forward_empty_filled_slots(slots.begin(), pos.empty.first, pos.filled.first, npos, get_empty_obj());
-			pos = meta_positions_type{ { empty_pos, pos.empty.second },{ npos, npos } };
-		}
-		filled_size = size_type(0);
-	}
 
+//**************************************************************************************************
+// occupancy_bitmap keeps one bit per slot of a "slot_list", which is set while the slot is filled.
+// It's disabled by default, in which case all of its modifying methods do nothing.
+// When enabled, filled slots can be visited in the order of their indices, which is the order of
+// their addresses within each chunk, instead of
+// following the filled list around memory.
+//**************************************************************************************************
 
+template<typename A>
+// A models Allocator
+class occupancy_bitmap {
 public:
-	controlled_slot_list(get_empty_type &&get_empty_obj = get_empty<value_type>{}, AllocatorType<container_type> &&alloc = AllocatorType<container_type>{}) :
-		slots(std::move(alloc)),
-		filled_size(size_type(0)),
-		get_empty_obj(std::move(get_empty_obj)),
-		pos({ { npos, npos },{ npos, npos } })
-	{}
+	using word_type = std::uint64_t;
+	using size_type = std::size_t;
+	using allocator_type = AllocatorRebindType<A, word_type>;
 
-	controlled_slot_list(const get_empty_type &get_empty_obj, AllocatorType<container_type> &&alloc = AllocatorType<container_type>{}) :
-		slots(std::move(alloc)),
-		filled_size(size_type(0)),
-		get_empty_obj(get_empty_obj),
-		pos({ { npos, npos },{ npos, npos } })
-	{}
+	static constexpr size_type npos = max_type_value<size_type>();
 
-	controlled_slot_list(const get_empty_type &get_empty_obj, const AllocatorType<container_type> &alloc) :
-		slots(alloc),
-		filled_size(size_type(0)),
-		get_empty_obj(get_empty_obj),
-		pos({ { npos, npos },{ npos, npos } })
-	{}
+private:
+	static constexpr unsigned word_bits = 64;
 
+	std::vector<word_type, allocator_type> words;
+	bool enabled;
 
-	value_type& id_value(id_type id) {
-		return iterator_slot(slots.begin(), id).value;
+	static size_type _word_count(size_type bits) {
+		return (bits + word_bits - 1) / word_bits;
 	}
 
-	const value_type& id_value(id_type id) const {
-		return iterator_slot(slots.cbegin(), id).value;
+public:
+	explicit occupancy_bitmap(const allocator_type &alloc = allocator_type{}) : words(alloc), enabled(false) {}
+
+	bool is_enabled() const {
+		return enabled;
 	}
 
-	id_type id_next(id_type id) const {
-		return iterator_slot(slots.cbegin(), id).next;
+	// Enables the bitmap with "bits" cleared bits.
+	void enable(size_type bits) {
+		words.assign(_word_count(bits), word_type(0));
+		enabled = true;
 	}
 
-	bool id_is_end(id_type id) const {
-		return id == npos;
+	void disable() {
+		std::vector<word_type, allocator_type>(words.get_allocator()).swap(words);
+		enabled = false;
 	}
 
-	constexpr static void reset_version_counts() {
+	void resize(size_type bits) {
+		if (enabled) words.resize(_word_count(bits), word_type(0));
+	}
 
+	void set(size_type i) {
+		if (enabled) words[i / word_bits] |= word_type(1) << (i % word_bits);
 	}
 
-	void clear_and_reset_version_counts() {
-		clear();
+	void reset(size_type i) {
+		if (enabled) words[i / word_bits] &= ~(word_type(1) << (i % word_bits));
 	}
 
-	constexpr static bool id_is_valid(id_type id) {
-		return true;
+	void reset_all() {
+		if (enabled) std::fill(words.begin(), words.end(), word_type(0));
 	}
 
-	id_type id_begin() const {
-		return pos.filled.first;
+	bool test(size_type i) const {
+		return (words[i / word_bits] >> (i % word_bits)) & word_type(1);
 	}
 
-	size_type size() const {
-		return filled_size;
+	size_type count() const {
+		size_type n = 0;
+		for (auto w : words) n += population_count(w);
+		return n;
 	}
 
-	size_type capacity() const {
-		return slots.size();
+	// Position of the first set bit at or after "i", or "npos" if there is none.
+	size_type find_next_set(size_type i) const {
+		size_type k = i / word_bits;
+		if (k >= words.size()) return npos;
+		word_type w = words[k] & (~word_type(0) << (i % word_bits));
+		while (w == word_type(0)) {
+			if (++k == words.size()) return npos;
+			w = words[k];
+		}
+		return k * word_bits + count_trailing_zeros(w);
 	}
 
-	void reserve(size_type s) {
-		if (s > capacity()) _reserve(s);
+	// Position of the last set bit before "i", or "npos" if there is none.
+	size_type find_prev_set(size_type i) const {
+		if (i == size_type(0)) return npos;
+		size_type k = (i - 1) / word_bits;
+		word_type w = words[k] & (~word_type(0) >> (word_bits - 1 - (i - 1) % word_bits));
+		while (w == word_type(0)) {
+			if (k == size_type(0)) return npos;
+			w = words[--k];
+		}
+		return k * word_bits + highest_set_bit(w);
 	}
 
-	id_type insert(const value_type &v) {
-		if (capacity() == size())
-			_reserve(grow_size(size()));
-		return _insert(v);
+	// Position of the first clear bit at or after "i" and below "bits", or "npos" if there is none.
+	size_type find_next_clear(size_type i, size_type bits) const {
+		if (i >= bits) return npos;
+		size_type k = i / word_bits;
+		word_type w = ~words[k] & (~word_type(0) << (i % word_bits));
+		while (w == word_type(0)) {
+			if (++k == _word_count(bits)) return npos;
+			w = ~words[k];
+		}
+		const auto found = k * word_bits + count_trailing_zeros(w);
+		return found < bits ? found : npos;
+	}
+
+	// Position of the last clear bit before "i", or "npos" if there is none.
+	size_type find_prev_clear(size_type i) const {
+		if (i == size_type(0)) return npos;
+		size_type k = (i - 1) / word_bits;
+		word_type w = ~words[k] & (~word_type(0) >> (word_bits - 1 - (i - 1) % word_bits));
+		while (w == word_type(0)) {
+			if (k == size_type(0)) return npos;
+			w = ~words[--k];
+		}
+		return k * word_bits + highest_set_bit(w);
+	}
+
+	// Calls "f" with the position of each clear bit below "bits", in ascending order.
+	template<typename F>
+	// F models UnaryProcedure : void operator()(size_type)
+	void for_each_clear(size_type bits, F f) const {
+		for (size_type k = 0; k != _word_count(bits); ++k) {
+			word_type w = ~words[k];
+			const size_type rest = bits - k * word_bits;
+			if (rest < word_bits) w &= (word_type(1) << rest) - word_type(1);
+			for (; w != word_type(0); w &= w - word_type(1))
+				f(k * word_bits + count_trailing_zeros(w));
+		}
 	}
 
-	id_type insert(value_type &&v) {
-		if (capacity() == size())
-			_reserve(grow_size(size()));
-		return _insert(std::move(v));
+	// Calls "f" with the position of each set bit, in ascending order.
+	template<typename F>
+	// F models UnaryProcedure : void operator()(size_type)
+	void for_each_set(F f) const {
+		for (size_type k = 0; k != words.size(); ++k) {
+			for (word_type w = words[k]; w != word_type(0); w &= w - word_type(1))
+				f(k * word_bits + count_trailing_zeros(w));
+		}
 	}
 
-	id_type erase(id_type id) {
-		return _erase(static_cast<size_type>(id));
+	template<typename O>
+	// O models BinaryOutputStream
+	void save(O &os) const {
+		snapshot_write(os, enabled);
+		snapshot_write_container(os, words);
 	}
 
-	void clear() {
-		_clear();
+	template<typename I>
+	// I models BinaryInputStream
+	bool load(I &is) {
+		return snapshot_read(is, enabled) && snapshot_read_container(is, words);
 	}
+};
 
-	bool empty() const {
-		return slots.empty();
+template<typename A>
+constexpr typename occupancy_bitmap<A>::size_type occupancy_bitmap<A>::npos;
+template<typename A>
+constexpr unsigned occupancy_bitmap<A>::word_bits;
+
+
+
+
+// Id getter of "slot_list" and "controlled_slot_list". Id is the index of the slot.
+template<typename S>
+// S models Integral
+struct sl_index_id_obj {
+	using id_type = S;
+
+	template<typename N>
+	// N models Slot
+	id_type operator()(S index, const N &) const { return index; }
+};
+
+// Id getter of "versioned_slot_list" and "regulated_slot_list". Id is made out of the index and the version of the slot.
+template<typename Traits>
+// Traits models IdTraits
+struct sl_versioned_id_obj {
+	using id_type = typename Traits::id_type;
+
+	template<typename N>
+	// N models VersionedSlot
+	id_type operator()(SizeType<Traits> index, const N &slot) const { return Traits::make(index, slot.version); }
+};
+
+//**************************************************************************************************
+// slot_list_iterator walks the filled list of a "slot_list" by following next and prev links.
+// It holds a pointer to the current slot, so dereferencing it needs no lookup. Each increment
+// prefetches the slot after the next one, which hides some of the latency of jumping around memory.
+// Iterators are invalidated when the slot list grows, and an iterator to an erased object is invalidated.
+//**************************************************************************************************
+
+template<typename C, typename G>
+// C models SlotContainer or const SlotContainer
+// G models IdGetter
+class slot_list_iterator {
+	using slot_type = ValueType<C>;
+	using slot_pointer = typename std::conditional<std::is_const<C>::value, const slot_type*, slot_type*>::type;
+
+public:
+	using iterator_category = std::bidirectional_iterator_tag;
+	using value_type = ValueType<slot_type>;
+	using difference_type = std::ptrdiff_t;
+	using reference = typename std::conditional<std::is_const<C>::value, const value_type&, value_type&>::type;
+	using pointer = typename std::conditional<std::is_const<C>::value, const value_type*, value_type*>::type;
+	using size_type = SizeType<slot_type>;
+	using id_type = typename G::id_type;
+
+private:
+	template<typename O, typename H>
+	friend class slot_list_iterator;
+
+	C *slots;
+	const std::pair<size_type, size_type> *filled;
+	size_type index;
+	slot_pointer slot;
+
+	void _seek(size_type i) {
+		index = i;
+		slot = i == max_type_value<size_type>() ? nullptr : std::addressof((*slots)[i]);
+	}
+
+public:
+	slot_list_iterator() : slots(nullptr), filled(nullptr), index(max_type_value<size_type>()), slot(nullptr) {}
+
+	slot_list_iterator(C &slots, const std::pair<size_type, size_type> &filled, size_type index) : 
+		slots(std::addressof(slots)), filled(std::addressof(filled)) {
+		_seek(index);
+	}
+
+	template<typename O,
+		typename = typename std::enable_if<std::is_convertible<O*, C*>::value>::type>
+	slot_list_iterator(const slot_list_iterator<O, G> &other) :
+		slots(other.slots), filled(other.filled), index(other.index), slot(other.slot) {}
+
+	reference operator*() const { return slot->value; }
+	pointer operator->() const { return std::addressof(slot->value); }
+
+	// Id of the object the iterator points to.
+	id_type id() const { return G{}(index, *slot); }
+
+	slot_list_iterator& operator++() {
+		_seek(slot->next);
+		if (slot != nullptr && slot->next != max_type_value<size_type>()) 
+			prefetch(std::addressof((*slots)[slot->next]));
+		return *this;
+	}
+
+	slot_list_iterator operator++(int) { auto tmp = *this; ++*this; return tmp; }
+
+	slot_list_iterator& operator--() {
+		_seek(slot == nullptr ? filled->second : slot->prev);
+		return *this;
 	}
+
+	slot_list_iterator operator--(int) { auto tmp = *this; --*this; return tmp; }
+
+	template<typename O>
+	bool operator==(const slot_list_iterator<O, G> &other) const { return index == other.index; }
+	template<typename O>
+	bool operator!=(const slot_list_iterator<O, G> &other) const { return index != other.index; }
 };
 
 
 
 
 template<typename T,
-	typename V = default_version_type,
 	typename S = default_size_type,
-	typename A = default_allocator_type<T>>
-class versioned_slot_list {
+	typename A = default_allocator_type<T>,
+	typename G = default_growth_policy,
+	unsigned ChunkBits = 0>
+class slot_list {
 public:
 	using value_type = T;
-	using version_type = V;
 	using size_type = S;
-	using id_type = std::pair<size_type, version_type>;
-	using slot_type = sl_versioned_slot_type<value_type, size_type, version_type>;
-	using container_type = sl_container_type<slot_type, A>;
+	using growth_policy_type = G;
+	using id_type = size_type;
+	using slot_type = sl_slot_type<value_type, size_type>;
+	using container_type = sl_container_type<slot_type, A, ChunkBits>;
+	using iterator = slot_list_iterator<container_type, sl_index_id_obj<size_type>>;
+	using const_iterator = slot_list_iterator<const container_type, sl_index_id_obj<size_type>>;
 
 private:
-	static constexpr auto npos = max_type_value<size_type>();
+	static constexpr size_type npos = max_type_value<size_type>();
 	using meta_positions_type = bidirectional_slot_meta_positions<S>;
+	using occupancy_type = occupancy_bitmap<A>;
 
 	container_type slots;
-	meta_positions_type pos;
 	size_type filled_size;
+	meta_positions_type pos;
+	occupancy_type occupancy;
+	size_type defrag_pos;
+	size_type defrag_empty_pos;
+
+	// Capacity which fits "n" more values.
+	size_type _grow_size(size_type n) const {
+		return growth_policy_type::grow_size(size(), n, sizeof(slot_type));
+	}
 
 	void _reserve(size_type s) {
+		if (defrag_empty_pos != npos) _defragment_empty(npos);
 		size_type prev_size = slots.size();
 		slots.resize(s);
 		pos.empty = forward_empty_all_slots_with_meta(slots.begin(), prev_size, slots.end(), pos.empty, npos);
+		occupancy.resize(slots.size());
 	}
 
 	template<typename U>
 	id_type _insert(U&& v) {
+		_defrag_before_insert();
+		pos = bidirectional_link_to_filled(slots.begin(), pos, npos);
+		const auto index = pos.filled.second;
+		iterator_slot(slots.begin(), index).value = std::forward<U>(v);
+		occupancy.set(index);
+		_defrag_inserted(index);
+		++filled_size;
+		return index;
+	}
+
+	template<typename... Args>
+	id_type _emplace(Args&&... args) {
+		_defrag_before_insert();
+		reconstruct_value(iterator_slot(slots.begin(), pos.empty.first).value, std::forward<Args>(args)...);
 		pos = bidirectional_link_to_filled(slots.begin(), pos, npos);
-		iterator_slot(slots.begin(), pos.filled.second).value = std::forward<U>(v);
+		const auto index = pos.filled.second;
+		occupancy.set(index);
+		_defrag_inserted(index);
 		++filled_size;
-		return _get_id_unguarded(pos.filled.second);
+		return index;
+	}
+
+	template<typename I, typename O>
+	O _insert_range(I first, I last, O out, std::input_iterator_tag) {
+		while (first != last) {
+			if (capacity() == size())
+				_reserve(_grow_size(size_type(1)));
+			*out = _insert(*first);
+			++out;
+			++first;
+		}
+		return out;
+	}
+
+	// The empty list is walked once, and the new slots join the filled list as a single chain. A defragmenting pass 
+	// which is under way relinks each insertion into place, so it takes the values one at a time.
+	template<typename I, typename O>
+	O _insert_range(I first, I last, O out, std::forward_iterator_tag) {
+		const auto n = static_cast<size_type>(std::distance(first, last));
+		if (capacity() - size() < n)
+			_reserve(_grow_size(n));
+		if (defrag_pos != size_type(0) || defrag_empty_pos != npos)
+			return _insert_range(first, last, out, std::input_iterator_tag());
+		return bidirectional_link_range_to_filled(slots.begin(), pos, npos, first, last, out, [this](size_type index, I it) -> id_type {
+			iterator_slot(slots.begin(), index).value = *it;
+			occupancy.set(index);
+			++filled_size;
+			return index;
+		});
 	}
 
 	id_type _erase(size_type index) {
-		id_type next = _id_next(index);
-		pos = versioned_bidirectional_link_to_empty(slots.begin(), pos, npos, index);
-		++iterator_slot(slots.begin(), index).version;
+		id_type next = id_next(index);
+		pos = defrag_empty_pos == npos ? bidirectional_link_to_empty(slots.begin(), pos, npos, index) :
+			bidirectional_link_to_empty_in_order(slots.begin(), pos, npos, index, defrag_empty_pos, occupancy);
+		occupancy.reset(index);
 		--filled_size;
 		return next;
 	}
 
+	// While a defragmenting pass relinks empty slots, the list of empty slots holds only those it has relinked,
+	// so one more is linked once that list runs out.
+	void _defrag_before_insert() {
+		if (pos.empty.first == npos) _defragment_empty(size_type(1));
+	}
+
+	// Filled slots which a defragmenting pass has already relinked stay in ascending order.
+	void _defrag_inserted(size_type index) {
+		if (index < defrag_pos)
+			pos.filled = bidirectional_relink_filled_in_order(slots.begin(), pos.filled, npos, index, occupancy);
+	}
+
+	// Second half of a defragmenting pass. Appends at most "budget" empty slots to the list of empty slots, 
+	// in ascending order. Returns true once all of them are linked, which finishes the pass.
+	bool _defragment_empty(size_type budget) {
+		for (;;) {
+			const auto index = occupancy.find_next_clear(defrag_empty_pos, slots.size());
+			if (index == occupancy_type::npos) break;
+			if (budget == size_type(0)) return false;
+			pos.empty = forward_link_empty_to_tail(slots.begin(), pos.empty, npos, static_cast<size_type>(index));
+			defrag_empty_pos = static_cast<size_type>(index + 1);
+			--budget;
+		}
+		defrag_pos = size_type(0);
+		defrag_empty_pos = npos;
+		return true;
+	}
+
 	void _clear() {
-		if (is_over_breakoff(capacity(), size())) {
-			versioned_forward_empty_all_slots(slots.begin(), slots.end(), size_type(0), npos);
+		if (defrag_empty_pos != npos) _defragment_empty(npos);
+		if (growth_policy_type::is_over_breakoff(capacity(), size())) {
+			forward_empty_all_slots(slots.begin(), slots.end(), size_type(0), npos);
 			pos = meta_positions_type{ { 0, slots.size() - 1 },{ npos, npos } };
 		}
 		else {
-			const auto empty_pos = versioned_forward_empty_filled_slots(slots.begin(), pos.empty.first, pos.filled.first, npos);
-			pos = meta_positions_type{ { empty_pos, pos.empty.second },{ npos, npos } };
+			const auto empty_pos = forward_empty_filled_slots(slots.begin(), pos.empty.first, pos.filled.first, npos);
+			const auto empty_tail = pos.empty.second != npos ? pos.empty.second : pos.filled.first;
+			pos = meta_positions_type{ { empty_pos, empty_tail },{ npos, npos } };
 		}
+		occupancy.reset_all();
 		filled_size = size_type(0);
 	}
 
-	id_type _get_id_unguarded(size_type index) const {
-		return{ index, iterator_slot(slots.begin(), index).version };
-	}
-
-	id_type _get_id(size_type index) const {
-		return{ index, index == npos ? npos : iterator_slot(slots.begin(), index).version };
-	}
-
-	id_type _id_next(size_type index) const {
-		return _get_id(slots[index].next);
+	// One past the index of the last filled slot.
+	size_type _filled_end() const {
+		if (occupancy.is_enabled()) {
+			const auto last = occupancy.find_prev_set(slots.size());
+			return last == occupancy_type::npos ? size_type(0) : static_cast<size_type>(last + 1);
+		}
+		size_type end = 0;
+		for (auto i = pos.filled.first; i != npos; i = iterator_slot(slots.cbegin(), i).next)
+			end = (std::max)(end, static_cast<size_type>(i + 1));
+		return end;
 	}
 
 public:
-	versioned_slot_list(AllocatorType<container_type> &&alloc = AllocatorType<container_type>{}) :
+	slot_list(AllocatorType<container_type> &&alloc = AllocatorType<container_type>{}) :
 		slots(std::move(alloc)),
 		filled_size(size_type(0)),
-		pos({ { npos, npos },{ npos, npos } })
+		pos({ { npos, npos },{ npos, npos } }),
+		occupancy(slots.get_allocator()),
+		defrag_pos(size_type(0)),
+		defrag_empty_pos(npos)
 	{}
 
-	versioned_slot_list(const AllocatorType<container_type> &alloc) :
+	slot_list(const AllocatorType<container_type> &alloc) :
 		slots(alloc),
 		filled_size(size_type(0)),
-		pos({ { npos, npos },{ npos, npos } })
+		pos({ { npos, npos },{ npos, npos } }),
+		occupancy(slots.get_allocator()),
+		defrag_pos(size_type(0)),
+		defrag_empty_pos(npos)
 	{}
 
+	template<typename I>
+	// I models InputIterator
+	slot_list(I first, I last, AllocatorType<container_type> &&alloc = AllocatorType<container_type>{}) :
+		slot_list(std::move(alloc))
+	{
+		insert_range(first, last);
+	}
+
 	value_type& id_value(id_type id) {
-		return iterator_slot(slots.begin(), id.first).value;
+		return iterator_slot(slots.begin(), id).value;
 	}
 
 	const value_type& id_value(id_type id) const {
-		return iterator_slot(slots.cbegin(), id.first).value;
+		return iterator_slot(slots.cbegin(), id).value;
 	}
 
 	id_type id_next(id_type id) const {
-		return _id_next(id.first);
+		return iterator_slot(slots.cbegin(), id).next;
 	}
-	
+
 	bool id_is_end(id_type id) const {
-		return id.first == npos;
+		return id == npos;
 	}
 
-	void reset_version_counts() {
-		versioned_reset(slots.begin(), slots.end());
+	constexpr static void reset_version_counts() {
+
 	}
 
 	void clear_and_reset_version_counts() {
-		versioned_forward_empty_and_reset_all_slots(slots.begin(), slots.end(), size_type(0), npos);
-		pos = meta_positions_type{ { 0, slots.size() - 1 },{ npos, npos } };
+		clear();
 	}
 
-	bool id_is_valid(id_type id) {
-		return id.second == iterator_slot(slots.begin(), id.first).version;
+	constexpr static bool id_is_valid(id_type){
+		return true;
 	}
 
 	id_type id_begin() const {
-		return _get_id(pos.filled.first);
+		return pos.filled.first;
 	}
 
 	size_type size() const {
@@ -1243,20 +2758,54 @@ public:
 		if (s > capacity()) _reserve(s);
 	}
 
+	// Releases the trailing slots which are all empty, and removes them from the list of empty slots.
+	void shrink_to_fit() {
+		const auto new_size = _filled_end();
+		if (new_size != capacity()) {
+			pos.empty = forward_unlink_slots_from(slots.begin(), pos.empty, new_size, npos);
+			slots.erase(next_iterator(slots.cbegin(), new_size), slots.cend());
+			occupancy.resize(new_size);
+		}
+		slots.shrink_to_fit();
+	}
+
 	id_type insert(const value_type &v) {
 		if (capacity() == size())
-			_reserve(grow_size(size()));
+			_reserve(_grow_size(size_type(1)));
 		return _insert(v);
 	}
 
 	id_type insert(value_type &&v) {
 		if (capacity() == size())
-			_reserve(grow_size(size()));
+			_reserve(_grow_size(size_type(1)));
 		return _insert(std::move(v));
 	}
 
+	// Constructs the value in place, inside the empty slot.
+	template<typename... Args>
+	id_type emplace(Args&&... args) {
+		if (capacity() == size())
+			_reserve(_grow_size(size_type(1)));
+		return _emplace(std::forward<Args>(args)...);
+	}
+
+	// Inserts all values from the range, and writes their ids to "out".
+	// If the range models ForwardRange, capacity is increased at most once.
+	template<typename I, typename O>
+	// I models InputIterator
+	// O models OutputIterator
+	O insert_range(I first, I last, O out) {
+		return _insert_range(first, last, out, IteratorCategory<I>{});
+	}
+
+	template<typename I>
+	// I models InputIterator
+	void insert_range(I first, I last) {
+		insert_range(first, last, discard_iterator{});
+	}
+
 	id_type erase(id_type id) {
-		return _erase(id.first);
+		return _erase(static_cast<size_type>(id));
 	}
 
 	void clear() {
@@ -1264,144 +2813,382 @@ public:
 	}
 
 	bool empty() const {
-		return slots.empty();
+		return filled_size == size_type(0);
 	}
-};
-
-
 
+	// Iterators walk over the filled slots in the order of insertion.
+	iterator begin() {
+		return iterator(slots, pos.filled, pos.filled.first);
+	}
 
+	iterator end() {
+		return iterator(slots, pos.filled, npos);
+	}
 
+	const_iterator begin() const {
+		return cbegin();
+	}
+
+	const_iterator end() const {
+		return cend();
+	}
+
+	const_iterator cbegin() const {
+		return const_iterator(slots, pos.filled, pos.filled.first);
+	}
+
+	const_iterator cend() const {
+		return const_iterator(slots, pos.filled, npos);
+	}
+
+	iterator iterator_of_id(id_type id) {
+		return iterator(slots, pos.filled, id);
+	}
+
+	const_iterator iterator_of_id(id_type id) const {
+		return const_iterator(slots, pos.filled, id);
+	}
+
+	id_type id_of_iterator(const_iterator it) const {
+		return it.id();
+	}
+
+	// Once enabled, the occupancy bitmap is kept in sync by all modifying methods, 
+	// and "for_each" visits the objects in the order of their slots.
+	void enable_occupancy_bitmap() {
+		if (occupancy.is_enabled()) return;
+		occupancy.enable(slots.size());
+		for (auto i = pos.filled.first; i != npos; i = iterator_slot(slots.cbegin(), i).next)
+			occupancy.set(i);
+	}
+
+	void disable_occupancy_bitmap() {
+		if (defrag_empty_pos != npos) _defragment_empty(npos);
+		defrag_pos = size_type(0);
+		occupancy.disable();
+	}
+
+	bool has_occupancy_bitmap() const {
+		return occupancy.is_enabled();
+	}
+
+	// Relinks the filled list and the list of empty slots in the ascending order of slots, without moving any objects,
+	// so all ids stay valid. At most "budget" slots are relinked per call, filled ones first and then empty ones, and 
+	// the next call continues where the previous one stopped. Objects inserted or erased in between keep the relinked 
+	// part of both lists in order. Returns true once the pass is finished. Enables the occupancy bitmap.
+	bool defragment(size_type budget = npos) {
+		enable_occupancy_bitmap();
+		while (defrag_empty_pos == npos) {
+			const auto index = occupancy.find_next_set(defrag_pos);
+			if (index >= slots.size()) {
+				defrag_pos = npos;
+				defrag_empty_pos = size_type(0);
+				pos.empty = { npos, npos };
+				break;
+			}
+			if (budget == size_type(0)) return false;
+			pos.filled = bidirectional_relink_filled_in_order(slots.begin(), pos.filled, npos, static_cast<size_type>(index), occupancy);
+			defrag_pos = static_cast<size_type>(index + 1);
+			--budget;
+		}
+		return _defragment_empty(budget);
+	}
+
+	// Calls "f" with every stored object. Objects are visited in the order of their slots 
+	// if the occupancy bitmap is enabled, and in the order of insertion otherwise.
+	template<typename F>
+	// F models UnaryProcedure : void operator()(value_type&)
+	F for_each(F f) {
+		if (occupancy.is_enabled())
+			occupancy.for_each_set([this, &f](std::size_t i) { f(slots[i].value); });
+		else
+			for (auto &v : *this) f(v);
+		return f;
+	}
+
+	template<typename F>
+	// F models UnaryProcedure : void operator()(const value_type&)
+	F for_each(F f) const {
+		if (occupancy.is_enabled())
+			occupancy.for_each_set([this, &f](std::size_t i) { f(slots[i].value); });
+		else
+			for (auto &v : *this) f(v);
+		return f;
+	}
+
+	// Writes the slots, the lists of filled and empty slots and the occupancy bitmap, 
+	// so that "load" restores the same ids.
+	template<typename O>
+	// O models BinaryOutputStream
+	void save(O &os) const {
+		snapshot_write_header(os, snapshot_kind::slot_list, sizeof(size_type), 0, sizeof(value_type));
+		snapshot_write_container(os, slots);
+		snapshot_write(os, filled_size);
+		snapshot_write(os, pos);
+		occupancy.save(os);
+		snapshot_write(os, defrag_pos);
+		snapshot_write(os, defrag_empty_pos);
+	}
+
+	// Replaces the contents with a snapshot written by "save". Returns false if the stream fails or holds
+	// a snapshot of some other container, in which case this one is left empty.
+	template<typename I>
+	// I models BinaryInputStream
+	bool load(I &is) {
+		if (snapshot_read_header(is, snapshot_kind::slot_list, sizeof(size_type), 0, sizeof(value_type)) &&
+			snapshot_read_container(is, slots) && snapshot_read(is, filled_size) && snapshot_read(is, pos) && occupancy.load(is) &&
+			snapshot_read(is, defrag_pos) && snapshot_read(is, defrag_empty_pos))
+			return true;
+		slots.clear();
+		filled_size = size_type(0);
+		pos = meta_positions_type{ { npos, npos },{ npos, npos } };
+		occupancy.disable();
+		defrag_pos = size_type(0);
+		defrag_empty_pos = npos;
+		return false;
+	}
+};
+
+template<typename T, typename S, typename A, typename G, unsigned ChunkBits>
+constexpr typename slot_list<T, S, A, G, ChunkBits>::size_type slot_list<T, S, A, G, ChunkBits>::npos;
 
 
 
 
 template<typename T,
 	typename E = get_empty<T>,
-	typename V = default_version_type,
 	typename S = default_size_type,
-	typename A = default_allocator_type<T>>
-class regulated_slot_list {
+	typename A = default_allocator_type<T>,
+	typename G = default_growth_policy,
+	unsigned ChunkBits = 0>
+class controlled_slot_list {
 public:
 	using value_type = T;
-	using size_type = S;
-	using version_type = V;
 	using get_empty_type = E;
-	using id_type = std::pair<size_type, version_type>;
-	using slot_type = sl_regulated_slot_type<value_type, size_type, version_type>;
-	using container_type = sl_container_type<slot_type, A>;
+	using size_type = S;
+	using growth_policy_type = G;
+	using id_type = size_type;
+	using slot_type = sl_controlled_slot_type<value_type, size_type>;
+	using container_type = sl_container_type<slot_type, A, ChunkBits>;
+	using iterator = slot_list_iterator<container_type, sl_index_id_obj<size_type>>;
+	using const_iterator = slot_list_iterator<const container_type, sl_index_id_obj<size_type>>;
+
 
 private:
-	static constexpr auto npos = max_type_value<size_type>();
+	static constexpr size_type npos = max_type_value<size_type>();
 	using meta_positions_type = bidirectional_slot_meta_positions<S>;
+	using occupancy_type = occupancy_bitmap<A>;
 
 	container_type slots;
-	meta_positions_type pos;
 	size_type filled_size;
 	get_empty_type get_empty_obj;
+	meta_positions_type pos;
+	occupancy_type occupancy;
+	size_type defrag_pos;
+	size_type defrag_empty_pos;
+
+	// Capacity which fits "n" more values.
+	size_type _grow_size(size_type n) const {
+		return growth_policy_type::grow_size(size(), n, sizeof(slot_type));
+	}
 
 	void _reserve(size_type s) {
+		if (defrag_empty_pos != npos) _defragment_empty(npos);
 		slot_type empty_slot{ get_empty_obj() };
 		size_type prev_size = slots.size();
 		slots.resize(s, empty_slot);
 		pos.empty = forward_empty_all_slots_with_meta(slots.begin(), prev_size, slots.end(), pos.empty, npos);
+		occupancy.resize(slots.size());
 	}
 
 	template<typename U>
 	id_type _insert(U&& v) {
+		_defrag_before_insert();
 		pos = bidirectional_link_to_filled(slots.begin(), pos, npos);
-		iterator_slot(slots.begin(), pos.filled.second).value = std::forward<U>(v);
+		const auto index = pos.filled.second;
+		iterator_slot(slots.begin(), index).value = std::forward<U>(v);
+		occupancy.set(index);
+		_defrag_inserted(index);
 		++filled_size;
-		return _get_id_unguarded(pos.filled.second);
+		return index;
+	}
+
+	template<typename... Args>
+	id_type _emplace(Args&&... args) {
+		_defrag_before_insert();
+		controlled_reconstruct_value(iterator_slot(slots.begin(), pos.empty.first).value, get_empty_obj, std::forward<Args>(args)...);
+		pos = bidirectional_link_to_filled(slots.begin(), pos, npos);
+		const auto index = pos.filled.second;
+		occupancy.set(index);
+		_defrag_inserted(index);
+		++filled_size;
+		return index;
+	}
+
+	template<typename I, typename O>
+	O _insert_range(I first, I last, O out, std::input_iterator_tag) {
+		while (first != last) {
+			if (capacity() == size())
+				_reserve(_grow_size(size_type(1)));
+			*out = _insert(*first);
+			++out;
+			++first;
+		}
+		return out;
+	}
+
+	// The empty list is walked once, and the new slots join the filled list as a single chain. A defragmenting pass 
+	// which is under way relinks each insertion into place, so it takes the values one at a time.
+	template<typename I, typename O>
+	O _insert_range(I first, I last, O out, std::forward_iterator_tag) {
+		const auto n = static_cast<size_type>(std::distance(first, last));
+		if (capacity() - size() < n)
+			_reserve(_grow_size(n));
+		if (defrag_pos != size_type(0) || defrag_empty_pos != npos)
+			return _insert_range(first, last, out, std::input_iterator_tag());
+		return bidirectional_link_range_to_filled(slots.begin(), pos, npos, first, last, out, [this](size_type index, I it) -> id_type {
+			iterator_slot(slots.begin(), index).value = *it;
+			occupancy.set(index);
+			++filled_size;
+			return index;
+		});
 	}
 
 	id_type _erase(size_type index) {
-		id_type id_next = _id_next(index);
-		pos = versioned_bidirectional_link_to_empty(slots.begin(), pos, npos, index);
-		auto &slot = iterator_slot(slots.begin(), index);
-		slot.value = get_empty_obj();
-		++slot.version;
+		id_type next = id_next(index);
+		pos = defrag_empty_pos == npos ? bidirectional_link_to_empty(slots.begin(), pos, npos, index) :
+			bidirectional_link_to_empty_in_order(slots.begin(), pos, npos, index, defrag_empty_pos, occupancy);
+		iterator_slot(slots.begin(), index).value = get_empty_obj();
+		occupancy.reset(index);
 		--filled_size;
-		return id_next;
+		return next;
+	}
+
+	// While a defragmenting pass relinks empty slots, the list of empty slots holds only those it has relinked,
+	// so one more is linked once that list runs out.
+	void _defrag_before_insert() {
+		if (pos.empty.first == npos) _defragment_empty(size_type(1));
+	}
+
+	// Filled slots which a defragmenting pass has already relinked stay in ascending order.
+	void _defrag_inserted(size_type index) {
+		if (index < defrag_pos)
+			pos.filled = bidirectional_relink_filled_in_order(slots.begin(), pos.filled, npos, index, occupancy);
+	}
+
+	// Second half of a defragmenting pass. Appends at most "budget" empty slots to the list of empty slots, 
+	// in ascending order. Returns true once all of them are linked, which finishes the pass.
+	bool _defragment_empty(size_type budget) {
+		for (;;) {
+			const auto index = occupancy.find_next_clear(defrag_empty_pos, slots.size());
+			if (index == occupancy_type::npos) break;
+			if (budget == size_type(0)) return false;
+			pos.empty = forward_link_empty_to_tail(slots.begin(), pos.empty, npos, static_cast<size_type>(index));
+			defrag_empty_pos = static_cast<size_type>(index + 1);
+			--budget;
+		}
+		defrag_pos = size_type(0);
+		defrag_empty_pos = npos;
+		return true;
 	}
 
 	void _clear() {
-		if (is_over_breakoff(capacity(), size())) {
-			regulated_forward_empty_all_slots(slots.begin(), slots.end(), size_type(0), npos, get_empty_obj());
+		if (defrag_empty_pos != npos) _defragment_empty(npos);
+		if (growth_policy_type::is_over_breakoff(capacity(), size())) {
+			controlled_forward_empty_all_slots(slots.begin(), slots.end(), size_type(0), npos, get_empty_obj());
 			pos = meta_positions_type{ { 0, slots.size() - 1 },{ npos, npos } };
 		}
 		else {
-			const auto empty_pos = regulated_forward_empty_filled_slots(slots.begin(), pos.empty.first, pos.filled.first, npos, get_empty_obj());
-			pos = meta_positions_type{ { empty_pos, pos.empty.second },{ npos, npos } };
+			const auto empty_pos = controlled_forward_empty_filled_slots(slots.begin(), pos.empty.first, pos.filled.first, npos, get_empty_obj());
+			const auto empty_tail = pos.empty.second != npos ? pos.empty.second : pos.filled.first;
+			pos = meta_positions_type{ { empty_pos, empty_tail },{ npos, npos } };
 		}
+		occupancy.reset_all();
 		filled_size = size_type(0);
 	}
 
-	id_type _get_id_unguarded(size_type index) const {
-		return{ index, iterator_slot(slots.begin(), index).version };
-	}
-
-	id_type _get_id(size_type index) const {
-		return{ index, index == npos ? npos : iterator_slot(slots.begin(), index).version };
-	}
-
-	id_type _id_next(size_type index) const {
-		return _get_id(slots[index].next);
+	// One past the index of the last filled slot.
+	size_type _filled_end() const {
+		if (occupancy.is_enabled()) {
+			const auto last = occupancy.find_prev_set(slots.size());
+			return last == occupancy_type::npos ? size_type(0) : static_cast<size_type>(last + 1);
+		}
+		size_type end = 0;
+		for (auto i = pos.filled.first; i != npos; i = iterator_slot(slots.cbegin(), i).next)
+			end = (std::max)(end, static_cast<size_type>(i + 1));
+		return end;
 	}
 
 public:
-	regulated_slot_list(get_empty_type &&get_empty_obj = get_empty<value_type>{}, AllocatorType<container_type> &&alloc = AllocatorType<container_type>{}) :
+	controlled_slot_list(get_empty_type &&get_empty_obj = get_empty_type{}, AllocatorType<container_type> &&alloc = AllocatorType<container_type>{}) :
 		slots(std::move(alloc)),
-		filled_size(size_type{ 0 }),
+		filled_size(size_type(0)),
 		get_empty_obj(std::move(get_empty_obj)),
-		pos({ { npos, npos },{ npos, npos } })
+		pos({ { npos, npos },{ npos, npos } }),
+		occupancy(slots.get_allocator()),
+		defrag_pos(size_type(0)),
+		defrag_empty_pos(npos)
 	{}
 
-	regulated_slot_list(const get_empty_type &get_empty_obj, AllocatorType<container_type> &&alloc = AllocatorType<container_type>{}) :
+	controlled_slot_list(const get_empty_type &get_empty_obj, AllocatorType<container_type> &&alloc = AllocatorType<container_type>{}) :
 		slots(std::move(alloc)),
-		filled_size(size_type{ 0 }),
+		filled_size(size_type(0)),
 		get_empty_obj(get_empty_obj),
-		pos({ { npos, npos },{ npos, npos } })
+		pos({ { npos, npos },{ npos, npos } }),
+		occupancy(slots.get_allocator()),
+		defrag_pos(size_type(0)),
+		defrag_empty_pos(npos)
 	{}
 
-	regulated_slot_list(const get_empty_type &get_empty_obj, const AllocatorType<container_type> &alloc) :
+	controlled_slot_list(const get_empty_type &get_empty_obj, const AllocatorType<container_type> &alloc) :
 		slots(alloc),
-		filled_size(size_type{ 0 }),
+		filled_size(size_type(0)),
 		get_empty_obj(get_empty_obj),
-		pos({ { npos, npos },{ npos, npos } })
+		pos({ { npos, npos },{ npos, npos } }),
+		occupancy(slots.get_allocator()),
+		defrag_pos(size_type(0)),
+		defrag_empty_pos(npos)
 	{}
 
+
+	template<typename I>
+	// I models InputIterator
+	controlled_slot_list(I first, I last, const get_empty_type &get_empty_obj = get_empty_type{}, AllocatorType<container_type> &&alloc = AllocatorType<container_type>{}) :
+		controlled_slot_list(get_empty_obj, std::move(alloc))
+	{
+		insert_range(first, last);
+	}
+
 	value_type& id_value(id_type id) {
-		return iterator_slot(slots.begin(), id.first).value;
+		return iterator_slot(slots.begin(), id).value;
 	}
 
 	const value_type& id_value(id_type id) const {
-		return iterator_slot(slots.cbegin(), id.first).value;
+		return iterator_slot(slots.cbegin(), id).value;
 	}
 
 	id_type id_next(id_type id) const {
-		return _id_next(id.first);
+		return iterator_slot(slots.cbegin(), id).next;
 	}
 
 	bool id_is_end(id_type id) const {
-		return id.first == npos;
+		return id == npos;
 	}
 
-	void reset_version_counts() {
-		versioned_reset(slots.begin(), slots.end());
+	constexpr static void reset_version_counts() {
+
 	}
 
 	void clear_and_reset_version_counts() {
-		regulated_forward_empty_and_reset_all_slots(slots.begin(), slots.end(), size_type(0), npos, get_empty_obj());
-		pos = meta_positions_type{ { 0, slots.size() - 1 },{ npos, npos } };
+		clear();
 	}
 
-	bool id_is_valid(id_type id) {
-		return id.second == iterator_slot(slots.begin(), id.first).version;
+	constexpr static bool id_is_valid(id_type) {
+		return true;
 	}
 
 	id_type id_begin() const {
-		return _get_id(pos.filled.first);
+		return pos.filled.first;
 	}
 
 	size_type size() const {
@@ -1416,20 +3203,54 @@ public:
 		if (s > capacity()) _reserve(s);
 	}
 
+	// Releases the trailing slots which are all empty, and removes them from the list of empty slots.
+	void shrink_to_fit() {
+		const auto new_size = _filled_end();
+		if (new_size != capacity()) {
+			pos.empty = forward_unlink_slots_from(slots.begin(), pos.empty, new_size, npos);
+			slots.erase(next_iterator(slots.cbegin(), new_size), slots.cend());
+			occupancy.resize(new_size);
+		}
+		slots.shrink_to_fit();
+	}
+
 	id_type insert(const value_type &v) {
 		if (capacity() == size())
-			_reserve(grow_size(size()));
+			_reserve(_grow_size(size_type(1)));
 		return _insert(v);
 	}
 
 	id_type insert(value_type &&v) {
 		if (capacity() == size())
-			_reserve(grow_size(size()));
+			_reserve(_grow_size(size_type(1)));
 		return _insert(std::move(v));
 	}
 
+	// Constructs the value in place, inside the empty slot.
+	template<typename... Args>
+	id_type emplace(Args&&... args) {
+		if (capacity() == size())
+			_reserve(_grow_size(size_type(1)));
+		return _emplace(std::forward<Args>(args)...);
+	}
+
+	// Inserts all values from the range, and writes their ids to "out".
+	// If the range models ForwardRange, capacity is increased at most once.
+	template<typename I, typename O>
+	// I models InputIterator
+	// O models OutputIterator
+	O insert_range(I first, I last, O out) {
+		return _insert_range(first, last, out, IteratorCategory<I>{});
+	}
+
+	template<typename I>
+	// I models InputIterator
+	void insert_range(I first, I last) {
+		insert_range(first, last, discard_iterator{});
+	}
+
 	id_type erase(id_type id) {
-		return _erase(id.first);
+		return _erase(static_cast<size_type>(id));
 	}
 
 	void clear() {
@@ -1437,190 +3258,3389 @@ public:
 	}
 
 	bool empty() const {
-		return slots.empty();
+		return filled_size == size_type(0);
 	}
-};
 
+	// Iterators walk over the filled slots in the order of insertion.
+	iterator begin() {
+		return iterator(slots, pos.filled, pos.filled.first);
+	}
+
+	iterator end() {
+		return iterator(slots, pos.filled, npos);
+	}
+
+	const_iterator begin() const {
+		return cbegin();
+	}
+
+	const_iterator end() const {
+		return cend();
+	}
+
+	const_iterator cbegin() const {
+		return const_iterator(slots, pos.filled, pos.filled.first);
+	}
 
+	const_iterator cend() const {
+		return const_iterator(slots, pos.filled, npos);
+	}
+
+	iterator iterator_of_id(id_type id) {
+		return iterator(slots, pos.filled, id);
+	}
 
+	const_iterator iterator_of_id(id_type id) const {
+		return const_iterator(slots, pos.filled, id);
+	}
 
+	id_type id_of_iterator(const_iterator it) const {
+		return it.id();
+	}
+
+	// Once enabled, the occupancy bitmap is kept in sync by all modifying methods, 
+	// and "for_each" visits the objects in the order of their slots.
+	void enable_occupancy_bitmap() {
+		if (occupancy.is_enabled()) return;
+		occupancy.enable(slots.size());
+		for (auto i = pos.filled.first; i != npos; i = iterator_slot(slots.cbegin(), i).next)
+			occupancy.set(i);
+	}
+
+	void disable_occupancy_bitmap() {
+		if (defrag_empty_pos != npos) _defragment_empty(npos);
+		defrag_pos = size_type(0);
+		occupancy.disable();
+	}
+
+	bool has_occupancy_bitmap() const {
+		return occupancy.is_enabled();
+	}
+
+	// Relinks the filled list and the list of empty slots in the ascending order of slots, without moving any objects,
+	// so all ids stay valid. At most "budget" slots are relinked per call, filled ones first and then empty ones, and 
+	// the next call continues where the previous one stopped. Objects inserted or erased in between keep the relinked 
+	// part of both lists in order. Returns true once the pass is finished. Enables the occupancy bitmap.
+	bool defragment(size_type budget = npos) {
+		enable_occupancy_bitmap();
+		while (defrag_empty_pos == npos) {
+			const auto index = occupancy.find_next_set(defrag_pos);
+			if (index >= slots.size()) {
+				defrag_pos = npos;
+				defrag_empty_pos = size_type(0);
+				pos.empty = { npos, npos };
+				break;
+			}
+			if (budget == size_type(0)) return false;
+			pos.filled = bidirectional_relink_filled_in_order(slots.begin(), pos.filled, npos, static_cast<size_type>(index), occupancy);
+			defrag_pos = static_cast<size_type>(index + 1);
+			--budget;
+		}
+		return _defragment_empty(budget);
+	}
 
+	// Calls "f" with every stored object. Objects are visited in the order of their slots 
+	// if the occupancy bitmap is enabled, and in the order of insertion otherwise.
+	template<typename F>
+	// F models UnaryProcedure : void operator()(value_type&)
+	F for_each(F f) {
+		if (occupancy.is_enabled())
+			occupancy.for_each_set([this, &f](std::size_t i) { f(slots[i].value); });
+		else
+			for (auto &v : *this) f(v);
+		return f;
+	}
 
+	template<typename F>
+	// F models UnaryProcedure : void operator()(const value_type&)
+	F for_each(F f) const {
+		if (occupancy.is_enabled())
+			occupancy.for_each_set([this, &f](std::size_t i) { f(slots[i].value); });
+		else
+			for (auto &v : *this) f(v);
+		return f;
+	}
+
+	// Writes the slots, the lists of filled and empty slots and the occupancy bitmap, 
+	// so that "load" restores the same ids.
+	template<typename O>
+	// O models BinaryOutputStream
+	void save(O &os) const {
+		snapshot_write_header(os, snapshot_kind::controlled_slot_list, sizeof(size_type), 0, sizeof(value_type));
+		snapshot_write_container(os, slots);
+		snapshot_write(os, filled_size);
+		snapshot_write(os, pos);
+		occupancy.save(os);
+		snapshot_write(os, defrag_pos);
+		snapshot_write(os, defrag_empty_pos);
+	}
+
+	// Replaces the contents with a snapshot written by "save". Returns false if the stream fails or holds
+	// a snapshot of some other container, in which case this one is left empty.
+	template<typename I>
+	// I models BinaryInputStream
+	bool load(I &is) {
+		if (snapshot_read_header(is, snapshot_kind::controlled_slot_list, sizeof(size_type), 0, sizeof(value_type)) &&
+			snapshot_read_container(is, slots) && snapshot_read(is, filled_size) && snapshot_read(is, pos) && occupancy.load(is) &&
+			snapshot_read(is, defrag_pos) && snapshot_read(is, defrag_empty_pos))
+			return true;
+		slots.clear();
+		filled_size = size_type(0);
+		pos = meta_positions_type{ { npos, npos },{ npos, npos } };
+		occupancy.disable();
+		defrag_pos = size_type(0);
+		defrag_empty_pos = npos;
+		return false;
+	}
+};
 
+template<typename T, typename E, typename S, typename A, typename G, unsigned ChunkBits>
+constexpr typename controlled_slot_list<T, E, S, A, G, ChunkBits>::size_type controlled_slot_list<T, E, S, A, G, ChunkBits>::npos;
 
 
 
 
 template<typename T,
+	typename V = default_version_type,
 	typename S = default_size_type,
-	typename A = default_allocator_type<T>>
-class slot_map {
+	typename A = default_allocator_type<T>,
+	typename G = default_growth_policy,
+	unsigned ChunkBits = 0>
+class versioned_slot_list {
 public:
 	using value_type = T;
 	using size_type = S;
-	using id_type = size_type;
-
-	using slot_type = sm_slot_type<size_type>;
-	using id_slot_container_type = sm_id_slot_container_type<slot_type, A>;
-	using value_container_type = sm_value_container_type<value_type, A>;
-	using id_pos_container_type = sm_id_pos_container_type<size_type, A>;
-
-	using difference_type = typename value_container_type::difference_type;
-	using iterator = typename value_container_type::iterator;
-	using const_iterator = typename value_container_type::const_iterator;
-	using reverse_iterator = typename value_container_type::reverse_iterator;
-	using const_reverse_iterator = typename value_container_type::const_reverse_iterator;
+	using growth_policy_type = G;
+	using id_traits_type = IdTraits<size_type, V>;
+	using version_type = VersionType<id_traits_type>;
+	using id_type = typename id_traits_type::id_type;
+	using slot_type = sl_versioned_slot_type<value_type, size_type, version_type>;
+	using container_type = sl_container_type<slot_type, A, ChunkBits>;
+	using iterator = slot_list_iterator<container_type, sl_versioned_id_obj<id_traits_type>>;
+	using const_iterator = slot_list_iterator<const container_type, sl_versioned_id_obj<id_traits_type>>;
 
 private:
-	static constexpr auto npos = max_type_value<size_type>();
+	static constexpr size_type npos = max_type_value<size_type>();
+	using meta_positions_type = bidirectional_slot_meta_positions<S>;
+	using occupancy_type = occupancy_bitmap<A>;
 
-	value_container_type values;
-	id_slot_container_type id_slots;
-	id_pos_container_type id_positions;
-	std::pair<size_type, size_type> empty_pos;
+	container_type slots;
+	size_type filled_size;
+	meta_positions_type pos;
+	occupancy_type occupancy;
+	size_type defrag_pos;
+	size_type defrag_empty_pos;
+	version_type version_floor;
 
-	void _reserve(size_type s) {
-		const auto prev_size = static_cast<size_type>(id_slots.size());
-		id_slots.resize(s);
-		empty_pos = trivial_forward_empty_all_slots_with_meta(id_slots.begin(), prev_size, id_slots.end(), empty_pos, npos);
+	// Capacity which fits "n" more values.
+	size_type _grow_size(size_type n) const {
+		return grow_size_within<growth_policy_type>(id_traits_type::max_size(), size(), n, sizeof(slot_type));
+	}
 
-		values.reserve(s);
-		id_positions.reserve(s);
+	void _reserve(size_type s) {
+		check_id_max_size(s, id_traits_type::max_size());
+		if (defrag_empty_pos != npos) _defragment_empty(npos);
+		size_type prev_size = slots.size();
+		slots.resize(s);
+		if (version_floor != min_type_value<version_type>())
+			versioned_set_version(next_iterator(slots.begin(), prev_size), slots.end(), version_floor);
+		pos.empty = forward_empty_all_slots_with_meta(slots.begin(), prev_size, slots.end(), pos.empty, npos);
+		occupancy.resize(slots.size());
 	}
 
 	template<typename U>
-	std::pair<iterator, id_type> _insert(U&& v) {
-		const auto value_pos = values.size();
-		values.push_back(std::forward<U>(v));
-		id_positions.push_back(empty_pos.first);
+	id_type _insert(U&& v) {
+		_defrag_before_insert();
+		pos = bidirectional_link_to_filled(slots.begin(), pos, npos);
+		const auto index = pos.filled.second;
+		iterator_slot(slots.begin(), index).value = std::forward<U>(v);
+		occupancy.set(index);
+		_defrag_inserted(index);
+		++filled_size;
+		return _get_id_unguarded(index);
+	}
 
-		const auto id = empty_pos.first;
-		auto &slot = iterator_slot(id_slots.begin(), empty_pos.first);
+	template<typename... Args>
+	id_type _emplace(Args&&... args) {
+		_defrag_before_insert();
+		reconstruct_value(iterator_slot(slots.begin(), pos.empty.first).value, std::forward<Args>(args)...);
+		pos = bidirectional_link_to_filled(slots.begin(), pos, npos);
+		const auto index = pos.filled.second;
+		occupancy.set(index);
+		_defrag_inserted(index);
+		++filled_size;
+		return _get_id_unguarded(index);
+	}
 
-		if (empty_pos.first == empty_pos.second) {
-			empty_pos.second = npos;
-			empty_pos.first = npos;
+	template<typename I, typename O>
+	O _insert_range(I first, I last, O out, std::input_iterator_tag) {
+		while (first != last) {
+			if (capacity() == size())
+				_reserve(_grow_size(size_type(1)));
+			*out = _insert(*first);
+			++out;
+			++first;
 		}
-		else {
-			empty_pos.first = slot.value;
-		}
-		slot.value = value_pos;
+		return out;
+	}
+
+	// The empty list is walked once, and the new slots join the filled list as a single chain. A defragmenting pass 
+	// which is under way relinks each insertion into place, so it takes the values one at a time.
+	template<typename I, typename O>
+	O _insert_range(I first, I last, O out, std::forward_iterator_tag) {
+		const auto n = static_cast<size_type>(std::distance(first, last));
+		if (capacity() - size() < n)
+			_reserve(_grow_size(n));
+		if (defrag_pos != size_type(0) || defrag_empty_pos != npos)
+			return _insert_range(first, last, out, std::input_iterator_tag());
+		return bidirectional_link_range_to_filled(slots.begin(), pos, npos, first, last, out, [this](size_type index, I it) -> id_type {
+			iterator_slot(slots.begin(), index).value = *it;
+			occupancy.set(index);
+			++filled_size;
+			return _get_id_unguarded(index);
+		});
+	}
 
-		return{ values.end() - 1, id };
+	id_type _erase(size_type index) {
+		id_type next = _id_next(index);
+		pos = defrag_empty_pos == npos ? versioned_bidirectional_link_to_empty(slots.begin(), pos, npos, index) :
+			bidirectional_link_to_empty_in_order(slots.begin(), pos, npos, index, defrag_empty_pos, occupancy);
+		++iterator_slot(slots.begin(), index).version;
+		occupancy.reset(index);
+		--filled_size;
+		return next;
 	}
 
-	void _erase(size_type id_index, size_type value_pos) {
-		const auto last_pos = static_cast<size_type>(size() - 1);
-		if (value_pos != last_pos) {
-			const auto pos = iterator_slot(id_positions.begin(), last_pos);
-			iterator_slot(id_positions.begin(), value_pos) = pos;
-			iterator_slot(id_slots.begin(), pos).value = value_pos;
-			iterator_slot(values.begin(), value_pos) = std::move(iterator_slot(values.begin(), last_pos));
-		}
-		id_positions.pop_back();
-		values.pop_back();
-		iterator_slot(id_slots.begin(), id_index).value = empty_pos.first;
-		if (empty_pos.second == npos)
-			empty_pos.second = id_index;
-		empty_pos.first = id_index;
+	// While a defragmenting pass relinks empty slots, the list of empty slots holds only those it has relinked,
+	// so one more is linked once that list runs out.
+	void _defrag_before_insert() {
+		if (pos.empty.first == npos) _defragment_empty(size_type(1));
+	}
+
+	// Filled slots which a defragmenting pass has already relinked stay in ascending order.
+	void _defrag_inserted(size_type index) {
+		if (index < defrag_pos)
+			pos.filled = bidirectional_relink_filled_in_order(slots.begin(), pos.filled, npos, index, occupancy);
 	}
 
+	// Second half of a defragmenting pass. Appends at most "budget" empty slots to the list of empty slots, 
+	// in ascending order. Returns true once all of them are linked, which finishes the pass.
+	bool _defragment_empty(size_type budget) {
+		for (;;) {
+			const auto index = occupancy.find_next_clear(defrag_empty_pos, slots.size());
+			if (index == occupancy_type::npos) break;
+			if (budget == size_type(0)) return false;
+			pos.empty = forward_link_empty_to_tail(slots.begin(), pos.empty, npos, static_cast<size_type>(index));
+			defrag_empty_pos = static_cast<size_type>(index + 1);
+			--budget;
+		}
+		defrag_pos = size_type(0);
+		defrag_empty_pos = npos;
+		return true;
+	}
 
 	void _clear() {
-		if (is_over_breakoff(capacity(), size())) {
-			trivial_forward_empty_all_slots(id_slots.begin(), id_slots.end(), size_type(0), npos);
-			empty_pos.first = 0;
-			empty_pos.second = id_slots.size() - 1;
+		if (defrag_empty_pos != npos) _defragment_empty(npos);
+		if (growth_policy_type::is_over_breakoff(capacity(), size())) {
+			versioned_forward_empty_all_slots(slots.begin(), slots.end(), size_type(0), npos);
+			pos = meta_positions_type{ { 0, slots.size() - 1 },{ npos, npos } };
 		}
 		else {
-			empty_pos.first = forward_empty_filled_dense_slots(id_positions.begin(), id_positions.end(), id_slots.begin(), empty_pos.first);
+			const auto empty_pos = versioned_forward_empty_filled_slots(slots.begin(), pos.empty.first, pos.filled.first, npos);
+			const auto empty_tail = pos.empty.second != npos ? pos.empty.second : pos.filled.first;
+			pos = meta_positions_type{ { empty_pos, empty_tail },{ npos, npos } };
 		}
-		values.clear();
-		id_positions.clear();
+		occupancy.reset_all();
+		filled_size = size_type(0);
 	}
 
-	template<typename I>
-	const value_type &_get_value(I index) const {
-		return iterator_slot(values.cbegin(), index);
+	id_type _get_id_unguarded(size_type index) const {
+		return id_traits_type::make(index, iterator_slot(slots.begin(), index).version);
 	}
 
-	template<typename I>
-	value_type &_get_value(I index) {
-		return iterator_slot(values.begin(), index);
+	id_type _get_id(size_type index) const {
+		return index == npos ? id_traits_type::end() : id_traits_type::make(index, iterator_slot(slots.begin(), index).version);
+	}
+
+	id_type _id_next(size_type index) const {
+		return _get_id(slots[index].next);
+	}
+	// One past the index of the last filled slot.
+	size_type _filled_end() const {
+		if (occupancy.is_enabled()) {
+			const auto last = occupancy.find_prev_set(slots.size());
+			return last == occupancy_type::npos ? size_type(0) : static_cast<size_type>(last + 1);
+		}
+		size_type end = 0;
+		for (auto i = pos.filled.first; i != npos; i = iterator_slot(slots.cbegin(), i).next)
+			end = (std::max)(end, static_cast<size_type>(i + 1));
+		return end;
 	}
 
 public:
-	slot_map(AllocatorType<id_slot_container_type> &&id_slots_allocator = AllocatorType<id_slot_container_type>{},
-		AllocatorType<value_container_type> &&value_allocator = AllocatorType<value_container_type>{},
+	versioned_slot_list(AllocatorType<container_type> &&alloc = AllocatorType<container_type>{}) :
+		slots(std::move(alloc)),
+		filled_size(size_type(0)),
+		pos({ { npos, npos },{ npos, npos } }),
+		occupancy(slots.get_allocator()),
+		defrag_pos(size_type(0)),
+		defrag_empty_pos(npos),
+		version_floor(min_type_value<version_type>())
+	{}
+
+	versioned_slot_list(const AllocatorType<container_type> &alloc) :
+		slots(alloc),
+		filled_size(size_type(0)),
+		pos({ { npos, npos },{ npos, npos } }),
+		occupancy(slots.get_allocator()),
+		defrag_pos(size_type(0)),
+		defrag_empty_pos(npos),
+		version_floor(min_type_value<version_type>())
+	{}
+
+	template<typename I>
+	// I models InputIterator
+	versioned_slot_list(I first, I last, AllocatorType<container_type> &&alloc = AllocatorType<container_type>{}) :
+		versioned_slot_list(std::move(alloc))
+	{
+		insert_range(first, last);
+	}
+
+	value_type& id_value(id_type id) {
+		return iterator_slot(slots.begin(), id_traits_type::index(id)).value;
+	}
+
+	const value_type& id_value(id_type id) const {
+		return iterator_slot(slots.cbegin(), id_traits_type::index(id)).value;
+	}
+
+	id_type id_next(id_type id) const {
+		return _id_next(id_traits_type::index(id));
+	}
+	
+	bool id_is_end(id_type id) const {
+		return id_traits_type::is_end(id);
+	}
+
+	void reset_version_counts() {
+		versioned_reset(slots.begin(), slots.end());
+		version_floor = min_type_value<version_type>();
+	}
+
+	void clear_and_reset_version_counts() {
+		version_floor = min_type_value<version_type>();
+		versioned_forward_empty_and_reset_all_slots(slots.begin(), slots.end(), size_type(0), npos);
+		pos = meta_positions_type{ { 0, slots.size() - 1 },{ npos, npos } };
+		occupancy.reset_all();
+		filled_size = size_type(0);
+		defrag_pos = size_type(0);
+		defrag_empty_pos = npos;
+	}
+
+	// Slots released by "shrink_to_fit" may be referenced by old ids, so the index is checked first.
+	bool id_is_valid(id_type id) const {
+		const auto index = id_traits_type::index(id);
+		return index < slots.size() && id_traits_type::has_version(id, iterator_slot(slots.cbegin(), index).version);
+	}
+
+	id_type id_begin() const {
+		return _get_id(pos.filled.first);
+	}
+
+	size_type size() const {
+		return filled_size;
+	}
+
+	size_type capacity() const {
+		return slots.size();
+	}
+
+	void reserve(size_type s) {
+		if (s > capacity()) _reserve(s);
+	}
+
+	// Releases the trailing slots which are all empty, and removes them from the list of empty slots.
+	// Versions of released slots are remembered, so that ids of objects which used to be stored in them
+	// don't become valid again once those slots are reused.
+	void shrink_to_fit() {
+		const auto new_size = _filled_end();
+		if (new_size != capacity()) {
+			pos.empty = forward_unlink_slots_from(slots.begin(), pos.empty, new_size, npos);
+			version_floor = versioned_max_version(next_iterator(slots.begin(), new_size), slots.end(), version_floor);
+			slots.erase(next_iterator(slots.cbegin(), new_size), slots.cend());
+			occupancy.resize(new_size);
+		}
+		slots.shrink_to_fit();
+	}
+
+	id_type insert(const value_type &v) {
+		if (capacity() == size())
+			_reserve(_grow_size(size_type(1)));
+		return _insert(v);
+	}
+
+	id_type insert(value_type &&v) {
+		if (capacity() == size())
+			_reserve(_grow_size(size_type(1)));
+		return _insert(std::move(v));
+	}
+
+	// Constructs the value in place, inside the empty slot.
+	template<typename... Args>
+	id_type emplace(Args&&... args) {
+		if (capacity() == size())
+			_reserve(_grow_size(size_type(1)));
+		return _emplace(std::forward<Args>(args)...);
+	}
+
+	// Inserts all values from the range, and writes their ids to "out".
+	// If the range models ForwardRange, capacity is increased at most once.
+	template<typename I, typename O>
+	// I models InputIterator
+	// O models OutputIterator
+	O insert_range(I first, I last, O out) {
+		return _insert_range(first, last, out, IteratorCategory<I>{});
+	}
+
+	template<typename I>
+	// I models InputIterator
+	void insert_range(I first, I last) {
+		insert_range(first, last, discard_iterator{});
+	}
+
+	id_type erase(id_type id) {
+		return _erase(id_traits_type::index(id));
+	}
+
+	void clear() {
+		_clear();
+	}
+
+	bool empty() const {
+		return filled_size == size_type(0);
+	}
+
+	// Iterators walk over the filled slots in the order of insertion.
+	iterator begin() {
+		return iterator(slots, pos.filled, pos.filled.first);
+	}
+
+	iterator end() {
+		return iterator(slots, pos.filled, npos);
+	}
+
+	const_iterator begin() const {
+		return cbegin();
+	}
+
+	const_iterator end() const {
+		return cend();
+	}
+
+	const_iterator cbegin() const {
+		return const_iterator(slots, pos.filled, pos.filled.first);
+	}
+
+	const_iterator cend() const {
+		return const_iterator(slots, pos.filled, npos);
+	}
+
+	iterator iterator_of_id(id_type id) {
+		return iterator(slots, pos.filled, id_traits_type::index(id));
+	}
+
+	const_iterator iterator_of_id(id_type id) const {
+		return const_iterator(slots, pos.filled, id_traits_type::index(id));
+	}
+
+	id_type id_of_iterator(const_iterator it) const {
+		return it.id();
+	}
+
+	// Once enabled, the occupancy bitmap is kept in sync by all modifying methods, 
+	// and "for_each" visits the objects in the order of their slots.
+	void enable_occupancy_bitmap() {
+		if (occupancy.is_enabled()) return;
+		occupancy.enable(slots.size());
+		for (auto i = pos.filled.first; i != npos; i = iterator_slot(slots.cbegin(), i).next)
+			occupancy.set(i);
+	}
+
+	void disable_occupancy_bitmap() {
+		if (defrag_empty_pos != npos) _defragment_empty(npos);
+		defrag_pos = size_type(0);
+		occupancy.disable();
+	}
+
+	bool has_occupancy_bitmap() const {
+		return occupancy.is_enabled();
+	}
+
+	// Relinks the filled list and the list of empty slots in the ascending order of slots, without moving any objects,
+	// so all ids stay valid. At most "budget" slots are relinked per call, filled ones first and then empty ones, and 
+	// the next call continues where the previous one stopped. Objects inserted or erased in between keep the relinked 
+	// part of both lists in order. Returns true once the pass is finished. Enables the occupancy bitmap.
+	bool defragment(size_type budget = npos) {
+		enable_occupancy_bitmap();
+		while (defrag_empty_pos == npos) {
+			const auto index = occupancy.find_next_set(defrag_pos);
+			if (index >= slots.size()) {
+				defrag_pos = npos;
+				defrag_empty_pos = size_type(0);
+				pos.empty = { npos, npos };
+				break;
+			}
+			if (budget == size_type(0)) return false;
+			pos.filled = bidirectional_relink_filled_in_order(slots.begin(), pos.filled, npos, static_cast<size_type>(index), occupancy);
+			defrag_pos = static_cast<size_type>(index + 1);
+			--budget;
+		}
+		return _defragment_empty(budget);
+	}
+
+	// Calls "f" with every stored object. Objects are visited in the order of their slots 
+	// if the occupancy bitmap is enabled, and in the order of insertion otherwise.
+	template<typename F>
+	// F models UnaryProcedure : void operator()(value_type&)
+	F for_each(F f) {
+		if (occupancy.is_enabled())
+			occupancy.for_each_set([this, &f](std::size_t i) { f(slots[i].value); });
+		else
+			for (auto &v : *this) f(v);
+		return f;
+	}
+
+	template<typename F>
+	// F models UnaryProcedure : void operator()(const value_type&)
+	F for_each(F f) const {
+		if (occupancy.is_enabled())
+			occupancy.for_each_set([this, &f](std::size_t i) { f(slots[i].value); });
+		else
+			for (auto &v : *this) f(v);
+		return f;
+	}
+
+	// Writes the slots, the lists of filled and empty slots, the versions and the occupancy bitmap, 
+	// so that "load" restores the same ids.
+	template<typename O>
+	// O models BinaryOutputStream
+	void save(O &os) const {
+		snapshot_write_header(os, snapshot_kind::versioned_slot_list, sizeof(size_type), sizeof(version_type), sizeof(value_type));
+		snapshot_write_container(os, slots);
+		snapshot_write(os, filled_size);
+		snapshot_write(os, pos);
+		snapshot_write(os, version_floor);
+		occupancy.save(os);
+		snapshot_write(os, defrag_pos);
+		snapshot_write(os, defrag_empty_pos);
+	}
+
+	// Replaces the contents with a snapshot written by "save". Returns false if the stream fails or holds
+	// a snapshot of some other container, in which case this one is left empty.
+	template<typename I>
+	// I models BinaryInputStream
+	bool load(I &is) {
+		if (snapshot_read_header(is, snapshot_kind::versioned_slot_list, sizeof(size_type), sizeof(version_type), sizeof(value_type)) &&
+			snapshot_read_container(is, slots) && snapshot_read(is, filled_size) && snapshot_read(is, pos) && snapshot_read(is, version_floor) && occupancy.load(is) &&
+			snapshot_read(is, defrag_pos) && snapshot_read(is, defrag_empty_pos))
+			return true;
+		slots.clear();
+		filled_size = size_type(0);
+		pos = meta_positions_type{ { npos, npos },{ npos, npos } };
+		version_floor = min_type_value<version_type>();
+		occupancy.disable();
+		defrag_pos = size_type(0);
+		defrag_empty_pos = npos;
+		return false;
+	}
+};
+
+template<typename T, typename V, typename S, typename A, typename G, unsigned ChunkBits>
+constexpr typename versioned_slot_list<T, V, S, A, G, ChunkBits>::size_type versioned_slot_list<T, V, S, A, G, ChunkBits>::npos;
+
+
+
+
+
+
+
+
+
+template<typename T,
+	typename E = get_empty<T>,
+	typename V = default_version_type,
+	typename S = default_size_type,
+	typename A = default_allocator_type<T>,
+	typename G = default_growth_policy,
+	unsigned ChunkBits = 0>
+class regulated_slot_list {
+public:
+	using value_type = T;
+	using size_type = S;
+	using growth_policy_type = G;
+	using id_traits_type = IdTraits<size_type, V>;
+	using version_type = VersionType<id_traits_type>;
+	using get_empty_type = E;
+	using id_type = typename id_traits_type::id_type;
+	using slot_type = sl_regulated_slot_type<value_type, size_type, version_type>;
+	using container_type = sl_container_type<slot_type, A, ChunkBits>;
+	using iterator = slot_list_iterator<container_type, sl_versioned_id_obj<id_traits_type>>;
+	using const_iterator = slot_list_iterator<const container_type, sl_versioned_id_obj<id_traits_type>>;
+
+private:
+	static constexpr size_type npos = max_type_value<size_type>();
+	using meta_positions_type = bidirectional_slot_meta_positions<S>;
+	using occupancy_type = occupancy_bitmap<A>;
+
+	container_type slots;
+	size_type filled_size;
+	get_empty_type get_empty_obj;
+	meta_positions_type pos;
+	occupancy_type occupancy;
+	size_type defrag_pos;
+	size_type defrag_empty_pos;
+	version_type version_floor;
+
+	// Capacity which fits "n" more values.
+	size_type _grow_size(size_type n) const {
+		return grow_size_within<growth_policy_type>(id_traits_type::max_size(), size(), n, sizeof(slot_type));
+	}
+
+	void _reserve(size_type s) {
+		check_id_max_size(s, id_traits_type::max_size());
+		if (defrag_empty_pos != npos) _defragment_empty(npos);
+		slot_type empty_slot{ get_empty_obj() };
+		empty_slot.version = version_floor;
+		size_type prev_size = slots.size();
+		slots.resize(s, empty_slot);
+		pos.empty = forward_empty_all_slots_with_meta(slots.begin(), prev_size, slots.end(), pos.empty, npos);
+		occupancy.resize(slots.size());
+	}
+
+	template<typename U>
+	id_type _insert(U&& v) {
+		_defrag_before_insert();
+		pos = bidirectional_link_to_filled(slots.begin(), pos, npos);
+		const auto index = pos.filled.second;
+		iterator_slot(slots.begin(), index).value = std::forward<U>(v);
+		occupancy.set(index);
+		_defrag_inserted(index);
+		++filled_size;
+		return _get_id_unguarded(index);
+	}
+
+	template<typename... Args>
+	id_type _emplace(Args&&... args) {
+		_defrag_before_insert();
+		controlled_reconstruct_value(iterator_slot(slots.begin(), pos.empty.first).value, get_empty_obj, std::forward<Args>(args)...);
+		pos = bidirectional_link_to_filled(slots.begin(), pos, npos);
+		const auto index = pos.filled.second;
+		occupancy.set(index);
+		_defrag_inserted(index);
+		++filled_size;
+		return _get_id_unguarded(index);
+	}
+
+	template<typename I, typename O>
+	O _insert_range(I first, I last, O out, std::input_iterator_tag) {
+		while (first != last) {
+			if (capacity() == size())
+				_reserve(_grow_size(size_type(1)));
+			*out = _insert(*first);
+			++out;
+			++first;
+		}
+		return out;
+	}
+
+	// The empty list is walked once, and the new slots join the filled list as a single chain. A defragmenting pass 
+	// which is under way relinks each insertion into place, so it takes the values one at a time.
+	template<typename I, typename O>
+	O _insert_range(I first, I last, O out, std::forward_iterator_tag) {
+		const auto n = static_cast<size_type>(std::distance(first, last));
+		if (capacity() - size() < n)
+			_reserve(_grow_size(n));
+		if (defrag_pos != size_type(0) || defrag_empty_pos != npos)
+			return _insert_range(first, last, out, std::input_iterator_tag());
+		return bidirectional_link_range_to_filled(slots.begin(), pos, npos, first, last, out, [this](size_type index, I it) -> id_type {
+			iterator_slot(slots.begin(), index).value = *it;
+			occupancy.set(index);
+			++filled_size;
+			return _get_id_unguarded(index);
+		});
+	}
+
+	id_type _erase(size_type index) {
+		id_type id_next = _id_next(index);
+		pos = defrag_empty_pos == npos ? versioned_bidirectional_link_to_empty(slots.begin(), pos, npos, index) :
+			bidirectional_link_to_empty_in_order(slots.begin(), pos, npos, index, defrag_empty_pos, occupancy);
+		auto &slot = iterator_slot(slots.begin(), index);
+		slot.value = get_empty_obj();
+		++slot.version;
+		occupancy.reset(index);
+		--filled_size;
+		return id_next;
+	}
+
+	// While a defragmenting pass relinks empty slots, the list of empty slots holds only those it has relinked,
+	// so one more is linked once that list runs out.
+	void _defrag_before_insert() {
+		if (pos.empty.first == npos) _defragment_empty(size_type(1));
+	}
+
+	// Filled slots which a defragmenting pass has already relinked stay in ascending order.
+	void _defrag_inserted(size_type index) {
+		if (index < defrag_pos)
+			pos.filled = bidirectional_relink_filled_in_order(slots.begin(), pos.filled, npos, index, occupancy);
+	}
+
+	// Second half of a defragmenting pass. Appends at most "budget" empty slots to the list of empty slots, 
+	// in ascending order. Returns true once all of them are linked, which finishes the pass.
+	bool _defragment_empty(size_type budget) {
+		for (;;) {
+			const auto index = occupancy.find_next_clear(defrag_empty_pos, slots.size());
+			if (index == occupancy_type::npos) break;
+			if (budget == size_type(0)) return false;
+			pos.empty = forward_link_empty_to_tail(slots.begin(), pos.empty, npos, static_cast<size_type>(index));
+			defrag_empty_pos = static_cast<size_type>(index + 1);
+			--budget;
+		}
+		defrag_pos = size_type(0);
+		defrag_empty_pos = npos;
+		return true;
+	}
+
+	void _clear() {
+		if (defrag_empty_pos != npos) _defragment_empty(npos);
+		if (growth_policy_type::is_over_breakoff(capacity(), size())) {
+			regulated_forward_empty_all_slots(slots.begin(), slots.end(), size_type(0), npos, get_empty_obj());
+			pos = meta_positions_type{ { 0, slots.size() - 1 },{ npos, npos } };
+		}
+		else {
+			const auto empty_pos = regulated_forward_empty_filled_slots(slots.begin(), pos.empty.first, pos.filled.first, npos, get_empty_obj());
+			const auto empty_tail = pos.empty.second != npos ? pos.empty.second : pos.filled.first;
+			pos = meta_positions_type{ { empty_pos, empty_tail },{ npos, npos } };
+		}
+		occupancy.reset_all();
+		filled_size = size_type(0);
+	}
+
+	id_type _get_id_unguarded(size_type index) const {
+		return id_traits_type::make(index, iterator_slot(slots.begin(), index).version);
+	}
+
+	id_type _get_id(size_type index) const {
+		return index == npos ? id_traits_type::end() : id_traits_type::make(index, iterator_slot(slots.begin(), index).version);
+	}
+
+	id_type _id_next(size_type index) const {
+		return _get_id(slots[index].next);
+	}
+	// One past the index of the last filled slot.
+	size_type _filled_end() const {
+		if (occupancy.is_enabled()) {
+			const auto last = occupancy.find_prev_set(slots.size());
+			return last == occupancy_type::npos ? size_type(0) : static_cast<size_type>(last + 1);
+		}
+		size_type end = 0;
+		for (auto i = pos.filled.first; i != npos; i = iterator_slot(slots.cbegin(), i).next)
+			end = (std::max)(end, static_cast<size_type>(i + 1));
+		return end;
+	}
+
+public:
+	regulated_slot_list(get_empty_type &&get_empty_obj = get_empty_type{}, AllocatorType<container_type> &&alloc = AllocatorType<container_type>{}) :
+		slots(std::move(alloc)),
+		filled_size(size_type{ 0 }),
+		get_empty_obj(std::move(get_empty_obj)),
+		pos({ { npos, npos },{ npos, npos } }),
+		occupancy(slots.get_allocator()),
+		defrag_pos(size_type(0)),
+		defrag_empty_pos(npos),
+		version_floor(min_type_value<version_type>())
+	{}
+
+	regulated_slot_list(const get_empty_type &get_empty_obj, AllocatorType<container_type> &&alloc = AllocatorType<container_type>{}) :
+		slots(std::move(alloc)),
+		filled_size(size_type{ 0 }),
+		get_empty_obj(get_empty_obj),
+		pos({ { npos, npos },{ npos, npos } }),
+		occupancy(slots.get_allocator()),
+		defrag_pos(size_type(0)),
+		defrag_empty_pos(npos),
+		version_floor(min_type_value<version_type>())
+	{}
+
+	regulated_slot_list(const get_empty_type &get_empty_obj, const AllocatorType<container_type> &alloc) :
+		slots(alloc),
+		filled_size(size_type{ 0 }),
+		get_empty_obj(get_empty_obj),
+		pos({ { npos, npos },{ npos, npos } }),
+		occupancy(slots.get_allocator()),
+		defrag_pos(size_type(0)),
+		defrag_empty_pos(npos),
+		version_floor(min_type_value<version_type>())
+	{}
+
+	template<typename I>
+	// I models InputIterator
+	regulated_slot_list(I first, I last, const get_empty_type &get_empty_obj = get_empty_type{}, AllocatorType<container_type> &&alloc = AllocatorType<container_type>{}) :
+		regulated_slot_list(get_empty_obj, std::move(alloc))
+	{
+		insert_range(first, last);
+	}
+
+	value_type& id_value(id_type id) {
+		return iterator_slot(slots.begin(), id_traits_type::index(id)).value;
+	}
+
+	const value_type& id_value(id_type id) const {
+		return iterator_slot(slots.cbegin(), id_traits_type::index(id)).value;
+	}
+
+	id_type id_next(id_type id) const {
+		return _id_next(id_traits_type::index(id));
+	}
+
+	bool id_is_end(id_type id) const {
+		return id_traits_type::is_end(id);
+	}
+
+	void reset_version_counts() {
+		versioned_reset(slots.begin(), slots.end());
+		version_floor = min_type_value<version_type>();
+	}
+
+	void clear_and_reset_version_counts() {
+		version_floor = min_type_value<version_type>();
+		regulated_forward_empty_and_reset_all_slots(slots.begin(), slots.end(), size_type(0), npos, get_empty_obj());
+		pos = meta_positions_type{ { 0, slots.size() - 1 },{ npos, npos } };
+		occupancy.reset_all();
+		filled_size = size_type(0);
+		defrag_pos = size_type(0);
+		defrag_empty_pos = npos;
+	}
+
+	// Slots released by "shrink_to_fit" may be referenced by old ids, so the index is checked first.
+	bool id_is_valid(id_type id) const {
+		const auto index = id_traits_type::index(id);
+		return index < slots.size() && id_traits_type::has_version(id, iterator_slot(slots.cbegin(), index).version);
+	}
+
+	id_type id_begin() const {
+		return _get_id(pos.filled.first);
+	}
+
+	size_type size() const {
+		return filled_size;
+	}
+
+	size_type capacity() const {
+		return slots.size();
+	}
+
+	void reserve(size_type s) {
+		if (s > capacity()) _reserve(s);
+	}
+
+	// Releases the trailing slots which are all empty, and removes them from the list of empty slots.
+	// Versions of released slots are remembered, so that ids of objects which used to be stored in them
+	// don't become valid again once those slots are reused.
+	void shrink_to_fit() {
+		const auto new_size = _filled_end();
+		if (new_size != capacity()) {
+			pos.empty = forward_unlink_slots_from(slots.begin(), pos.empty, new_size, npos);
+			version_floor = versioned_max_version(next_iterator(slots.begin(), new_size), slots.end(), version_floor);
+			slots.erase(next_iterator(slots.cbegin(), new_size), slots.cend());
+			occupancy.resize(new_size);
+		}
+		slots.shrink_to_fit();
+	}
+
+	id_type insert(const value_type &v) {
+		if (capacity() == size())
+			_reserve(_grow_size(size_type(1)));
+		return _insert(v);
+	}
+
+	id_type insert(value_type &&v) {
+		if (capacity() == size())
+			_reserve(_grow_size(size_type(1)));
+		return _insert(std::move(v));
+	}
+
+	// Constructs the value in place, inside the empty slot.
+	template<typename... Args>
+	id_type emplace(Args&&... args) {
+		if (capacity() == size())
+			_reserve(_grow_size(size_type(1)));
+		return _emplace(std::forward<Args>(args)...);
+	}
+
+	// Inserts all values from the range, and writes their ids to "out".
+	// If the range models ForwardRange, capacity is increased at most once.
+	template<typename I, typename O>
+	// I models InputIterator
+	// O models OutputIterator
+	O insert_range(I first, I last, O out) {
+		return _insert_range(first, last, out, IteratorCategory<I>{});
+	}
+
+	template<typename I>
+	// I models InputIterator
+	void insert_range(I first, I last) {
+		insert_range(first, last, discard_iterator{});
+	}
+
+	id_type erase(id_type id) {
+		return _erase(id_traits_type::index(id));
+	}
+
+	void clear() {
+		_clear();
+	}
+
+	bool empty() const {
+		return filled_size == size_type(0);
+	}
+
+	// Iterators walk over the filled slots in the order of insertion.
+	iterator begin() {
+		return iterator(slots, pos.filled, pos.filled.first);
+	}
+
+	iterator end() {
+		return iterator(slots, pos.filled, npos);
+	}
+
+	const_iterator begin() const {
+		return cbegin();
+	}
+
+	const_iterator end() const {
+		return cend();
+	}
+
+	const_iterator cbegin() const {
+		return const_iterator(slots, pos.filled, pos.filled.first);
+	}
+
+	const_iterator cend() const {
+		return const_iterator(slots, pos.filled, npos);
+	}
+
+	iterator iterator_of_id(id_type id) {
+		return iterator(slots, pos.filled, id_traits_type::index(id));
+	}
+
+	const_iterator iterator_of_id(id_type id) const {
+		return const_iterator(slots, pos.filled, id_traits_type::index(id));
+	}
+
+	id_type id_of_iterator(const_iterator it) const {
+		return it.id();
+	}
+
+	// Once enabled, the occupancy bitmap is kept in sync by all modifying methods, 
+	// and "for_each" visits the objects in the order of their slots.
+	void enable_occupancy_bitmap() {
+		if (occupancy.is_enabled()) return;
+		occupancy.enable(slots.size());
+		for (auto i = pos.filled.first; i != npos; i = iterator_slot(slots.cbegin(), i).next)
+			occupancy.set(i);
+	}
+
+	void disable_occupancy_bitmap() {
+		if (defrag_empty_pos != npos) _defragment_empty(npos);
+		defrag_pos = size_type(0);
+		occupancy.disable();
+	}
+
+	bool has_occupancy_bitmap() const {
+		return occupancy.is_enabled();
+	}
+
+	// Relinks the filled list and the list of empty slots in the ascending order of slots, without moving any objects,
+	// so all ids stay valid. At most "budget" slots are relinked per call, filled ones first and then empty ones, and 
+	// the next call continues where the previous one stopped. Objects inserted or erased in between keep the relinked 
+	// part of both lists in order. Returns true once the pass is finished. Enables the occupancy bitmap.
+	bool defragment(size_type budget = npos) {
+		enable_occupancy_bitmap();
+		while (defrag_empty_pos == npos) {
+			const auto index = occupancy.find_next_set(defrag_pos);
+			if (index >= slots.size()) {
+				defrag_pos = npos;
+				defrag_empty_pos = size_type(0);
+				pos.empty = { npos, npos };
+				break;
+			}
+			if (budget == size_type(0)) return false;
+			pos.filled = bidirectional_relink_filled_in_order(slots.begin(), pos.filled, npos, static_cast<size_type>(index), occupancy);
+			defrag_pos = static_cast<size_type>(index + 1);
+			--budget;
+		}
+		return _defragment_empty(budget);
+	}
+
+	// Calls "f" with every stored object. Objects are visited in the order of their slots 
+	// if the occupancy bitmap is enabled, and in the order of insertion otherwise.
+	template<typename F>
+	// F models UnaryProcedure : void operator()(value_type&)
+	F for_each(F f) {
+		if (occupancy.is_enabled())
+			occupancy.for_each_set([this, &f](std::size_t i) { f(slots[i].value); });
+		else
+			for (auto &v : *this) f(v);
+		return f;
+	}
+
+	template<typename F>
+	// F models UnaryProcedure : void operator()(const value_type&)
+	F for_each(F f) const {
+		if (occupancy.is_enabled())
+			occupancy.for_each_set([this, &f](std::size_t i) { f(slots[i].value); });
+		else
+			for (auto &v : *this) f(v);
+		return f;
+	}
+
+	// Writes the slots, the lists of filled and empty slots, the versions and the occupancy bitmap, 
+	// so that "load" restores the same ids.
+	template<typename O>
+	// O models BinaryOutputStream
+	void save(O &os) const {
+		snapshot_write_header(os, snapshot_kind::regulated_slot_list, sizeof(size_type), sizeof(version_type), sizeof(value_type));
+		snapshot_write_container(os, slots);
+		snapshot_write(os, filled_size);
+		snapshot_write(os, pos);
+		snapshot_write(os, version_floor);
+		occupancy.save(os);
+		snapshot_write(os, defrag_pos);
+		snapshot_write(os, defrag_empty_pos);
+	}
+
+	// Replaces the contents with a snapshot written by "save". Returns false if the stream fails or holds
+	// a snapshot of some other container, in which case this one is left empty.
+	template<typename I>
+	// I models BinaryInputStream
+	bool load(I &is) {
+		if (snapshot_read_header(is, snapshot_kind::regulated_slot_list, sizeof(size_type), sizeof(version_type), sizeof(value_type)) &&
+			snapshot_read_container(is, slots) && snapshot_read(is, filled_size) && snapshot_read(is, pos) && snapshot_read(is, version_floor) && occupancy.load(is) &&
+			snapshot_read(is, defrag_pos) && snapshot_read(is, defrag_empty_pos))
+			return true;
+		slots.clear();
+		filled_size = size_type(0);
+		pos = meta_positions_type{ { npos, npos },{ npos, npos } };
+		version_floor = min_type_value<version_type>();
+		occupancy.disable();
+		defrag_pos = size_type(0);
+		defrag_empty_pos = npos;
+		return false;
+	}
+};
+
+template<typename T, typename E, typename V, typename S, typename A, typename G, unsigned ChunkBits>
+constexpr typename regulated_slot_list<T, E, V, S, A, G, ChunkBits>::size_type regulated_slot_list<T, E, V, S, A, G, ChunkBits>::npos;
+
+
+
+
+//**************************************************************************************************
+// split_slot_list_iterator walks the filled list of a "split_slot_list" by following the links,
+// which are stored apart from the values. Each increment prefetches both the link and the value
+// of the slot after the next one.
+// Iterators are invalidated when the slot list grows, and an iterator to an erased object is invalidated.
+//**************************************************************************************************
+
+template<typename L, typename C, typename G>
+// L models SlotContainer or const SlotContainer
+// C models SlotContainer or const SlotContainer
+// G models IdGetter
+class split_slot_list_iterator {
+	using link_type = ValueType<L>;
+	using link_pointer = typename std::conditional<std::is_const<L>::value, const link_type*, link_type*>::type;
+
+public:
+	using iterator_category = std::bidirectional_iterator_tag;
+	using value_type = ValueType<C>;
+	using difference_type = std::ptrdiff_t;
+	using reference = typename std::conditional<std::is_const<C>::value, const value_type&, value_type&>::type;
+	using pointer = typename std::conditional<std::is_const<C>::value, const value_type*, value_type*>::type;
+	using size_type = SizeType<link_type>;
+	using id_type = typename G::id_type;
+
+private:
+	template<typename O, typename P, typename H>
+	friend class split_slot_list_iterator;
+
+	L *links;
+	C *values;
+	const std::pair<size_type, size_type> *filled;
+	size_type index;
+	link_pointer link;
+
+	void _seek(size_type i) {
+		index = i;
+		link = i == max_type_value<size_type>() ? nullptr : std::addressof((*links)[i]);
+	}
+
+public:
+	split_slot_list_iterator() : links(nullptr), values(nullptr), filled(nullptr), index(max_type_value<size_type>()), link(nullptr) {}
+
+	split_slot_list_iterator(L &links, C &values, const std::pair<size_type, size_type> &filled, size_type index) :
+		links(std::addressof(links)), values(std::addressof(values)), filled(std::addressof(filled)) {
+		_seek(index);
+	}
+
+	template<typename O, typename P,
+		typename = typename std::enable_if<std::is_convertible<O*, L*>::value && std::is_convertible<P*, C*>::value>::type>
+	split_slot_list_iterator(const split_slot_list_iterator<O, P, G> &other) :
+		links(other.links), values(other.values), filled(other.filled), index(other.index), link(other.link) {}
+
+	reference operator*() const { return (*values)[index]; }
+	pointer operator->() const { return std::addressof((*values)[index]); }
+
+	// Id of the object the iterator points to.
+	id_type id() const { return G{}(index, *link); }
+
+	split_slot_list_iterator& operator++() {
+		_seek(link->next);
+		if (link != nullptr && link->next != max_type_value<size_type>()) {
+			prefetch(std::addressof((*links)[link->next]));
+			prefetch(std::addressof((*values)[link->next]));
+		}
+		return *this;
+	}
+
+	split_slot_list_iterator operator++(int) { auto tmp = *this; ++*this; return tmp; }
+
+	split_slot_list_iterator& operator--() {
+		_seek(link == nullptr ? filled->second : link->prev);
+		return *this;
+	}
+
+	split_slot_list_iterator operator--(int) { auto tmp = *this; --*this; return tmp; }
+
+	template<typename O, typename P>
+	bool operator==(const split_slot_list_iterator<O, P, G> &other) const { return index == other.index; }
+	template<typename O, typename P>
+	bool operator!=(const split_slot_list_iterator<O, P, G> &other) const { return index != other.index; }
+};
+
+
+
+
+// Variation of "slot_list" which keeps the links of its slots apart from the values. 
+// Links and values are stored in two containers indexed by the same slot index, so a slot
+// takes sizeof(link_type) + sizeof(value_type) bytes, without the padding which interleaving 
+// them would need. Relinking touches only the links, and "for_each" over the occupancy bitmap
+// touches only the values.
+template<typename T,
+	typename S = default_size_type,
+	typename A = default_allocator_type<T>,
+	typename G = default_growth_policy,
+	unsigned ChunkBits = 0>
+class split_slot_list {
+public:
+	using value_type = T;
+	using size_type = S;
+	using growth_policy_type = G;
+	using id_type = size_type;
+	using link_type = sl_link_type<size_type>;
+	using link_container_type = sl_container_type<link_type, A, ChunkBits>;
+	using value_container_type = sl_container_type<value_type, A, ChunkBits>;
+	using iterator = split_slot_list_iterator<link_container_type, value_container_type, sl_index_id_obj<size_type>>;
+	using const_iterator = split_slot_list_iterator<const link_container_type, const value_container_type, sl_index_id_obj<size_type>>;
+
+private:
+	static constexpr size_type npos = max_type_value<size_type>();
+	using meta_positions_type = bidirectional_slot_meta_positions<S>;
+	using occupancy_type = occupancy_bitmap<A>;
+
+	link_container_type links;
+	value_container_type values;
+	size_type filled_size;
+	meta_positions_type pos;
+	occupancy_type occupancy;
+	size_type defrag_pos;
+	size_type defrag_empty_pos;
+
+	// Capacity which fits "n" more values.
+	size_type _grow_size(size_type n) const {
+		return growth_policy_type::grow_size(size(), n, sizeof(link_type) + sizeof(value_type));
+	}
+
+	void _reserve(size_type s) {
+		if (defrag_empty_pos != npos) _defragment_empty(npos);
+		size_type prev_size = links.size();
+		values.resize(s);
+		links.resize(s);
+		pos.empty = forward_empty_all_slots_with_meta(links.begin(), prev_size, links.end(), pos.empty, npos);
+		occupancy.resize(links.size());
+	}
+
+	template<typename U>
+	id_type _insert(U&& v) {
+		_defrag_before_insert();
+		values[pos.empty.first] = std::forward<U>(v);
+		pos = bidirectional_link_to_filled(links.begin(), pos, npos);
+		const auto index = pos.filled.second;
+		occupancy.set(index);
+		_defrag_inserted(index);
+		++filled_size;
+		return index;
+	}
+
+	template<typename... Args>
+	id_type _emplace(Args&&... args) {
+		_defrag_before_insert();
+		reconstruct_value(values[pos.empty.first], std::forward<Args>(args)...);
+		pos = bidirectional_link_to_filled(links.begin(), pos, npos);
+		const auto index = pos.filled.second;
+		occupancy.set(index);
+		_defrag_inserted(index);
+		++filled_size;
+		return index;
+	}
+
+	template<typename I, typename O>
+	O _insert_range(I first, I last, O out, std::input_iterator_tag) {
+		while (first != last) {
+			if (capacity() == size())
+				_reserve(_grow_size(size_type(1)));
+			*out = _insert(*first);
+			++out;
+			++first;
+		}
+		return out;
+	}
+
+	// The empty list is walked once, and the new slots join the filled list as a single chain. A defragmenting pass 
+	// which is under way relinks each insertion into place, so it takes the values one at a time.
+	template<typename I, typename O>
+	O _insert_range(I first, I last, O out, std::forward_iterator_tag) {
+		const auto n = static_cast<size_type>(std::distance(first, last));
+		if (capacity() - size() < n)
+			_reserve(_grow_size(n));
+		if (defrag_pos != size_type(0) || defrag_empty_pos != npos)
+			return _insert_range(first, last, out, std::input_iterator_tag());
+		return bidirectional_link_range_to_filled(links.begin(), pos, npos, first, last, out, [this](size_type index, I it) -> id_type {
+			values[index] = *it;
+			occupancy.set(index);
+			++filled_size;
+			return index;
+		});
+	}
+
+	id_type _erase(size_type index) {
+		id_type next = id_next(index);
+		pos = defrag_empty_pos == npos ? bidirectional_link_to_empty(links.begin(), pos, npos, index) :
+			bidirectional_link_to_empty_in_order(links.begin(), pos, npos, index, defrag_empty_pos, occupancy);
+		occupancy.reset(index);
+		--filled_size;
+		return next;
+	}
+
+	// While a defragmenting pass relinks empty slots, the list of empty slots holds only those it has relinked,
+	// so one more is linked once that list runs out.
+	void _defrag_before_insert() {
+		if (pos.empty.first == npos) _defragment_empty(size_type(1));
+	}
+
+	// Filled slots which a defragmenting pass has already relinked stay in ascending order.
+	void _defrag_inserted(size_type index) {
+		if (index < defrag_pos)
+			pos.filled = bidirectional_relink_filled_in_order(links.begin(), pos.filled, npos, index, occupancy);
+	}
+
+	// Second half of a defragmenting pass. Appends at most "budget" empty slots to the list of empty slots, 
+	// in ascending order. Returns true once all of them are linked, which finishes the pass.
+	bool _defragment_empty(size_type budget) {
+		for (;;) {
+			const auto index = occupancy.find_next_clear(defrag_empty_pos, links.size());
+			if (index == occupancy_type::npos) break;
+			if (budget == size_type(0)) return false;
+			pos.empty = forward_link_empty_to_tail(links.begin(), pos.empty, npos, static_cast<size_type>(index));
+			defrag_empty_pos = static_cast<size_type>(index + 1);
+			--budget;
+		}
+		defrag_pos = size_type(0);
+		defrag_empty_pos = npos;
+		return true;
+	}
+
+	void _clear() {
+		if (defrag_empty_pos != npos) _defragment_empty(npos);
+		if (growth_policy_type::is_over_breakoff(capacity(), size())) {
+			forward_empty_all_slots(links.begin(), links.end(), size_type(0), npos);
+			pos = meta_positions_type{ { 0, links.size() - 1 },{ npos, npos } };
+		}
+		else {
+			const auto empty_pos = forward_empty_filled_slots(links.begin(), pos.empty.first, pos.filled.first, npos);
+			const auto empty_tail = pos.empty.second != npos ? pos.empty.second : pos.filled.first;
+			pos = meta_positions_type{ { empty_pos, empty_tail },{ npos, npos } };
+		}
+		occupancy.reset_all();
+		filled_size = size_type(0);
+	}
+
+	// One past the index of the last filled slot.
+	size_type _filled_end() const {
+		if (occupancy.is_enabled()) {
+			const auto last = occupancy.find_prev_set(links.size());
+			return last == occupancy_type::npos ? size_type(0) : static_cast<size_type>(last + 1);
+		}
+		size_type end = 0;
+		for (auto i = pos.filled.first; i != npos; i = links[i].next)
+			end = (std::max)(end, static_cast<size_type>(i + 1));
+		return end;
+	}
+
+public:
+	split_slot_list(AllocatorType<value_container_type> &&alloc = AllocatorType<value_container_type>{}) :
+		links(AllocatorType<link_container_type>(alloc)),
+		values(std::move(alloc)),
+		filled_size(size_type(0)),
+		pos({ { npos, npos },{ npos, npos } }),
+		occupancy(values.get_allocator()),
+		defrag_pos(size_type(0)),
+		defrag_empty_pos(npos)
+	{}
+
+	split_slot_list(const AllocatorType<value_container_type> &alloc) :
+		links(AllocatorType<link_container_type>(alloc)),
+		values(alloc),
+		filled_size(size_type(0)),
+		pos({ { npos, npos },{ npos, npos } }),
+		occupancy(values.get_allocator()),
+		defrag_pos(size_type(0)),
+		defrag_empty_pos(npos)
+	{}
+
+	template<typename I>
+	// I models InputIterator
+	split_slot_list(I first, I last, AllocatorType<value_container_type> &&alloc = AllocatorType<value_container_type>{}) :
+		split_slot_list(std::move(alloc))
+	{
+		insert_range(first, last);
+	}
+
+	value_type& id_value(id_type id) {
+		return values[id];
+	}
+
+	const value_type& id_value(id_type id) const {
+		return values[id];
+	}
+
+	id_type id_next(id_type id) const {
+		return links[id].next;
+	}
+
+	bool id_is_end(id_type id) const {
+		return id == npos;
+	}
+
+	constexpr static void reset_version_counts() {
+
+	}
+
+	void clear_and_reset_version_counts() {
+		clear();
+	}
+
+	constexpr static bool id_is_valid(id_type){
+		return true;
+	}
+
+	id_type id_begin() const {
+		return pos.filled.first;
+	}
+
+	size_type size() const {
+		return filled_size;
+	}
+
+	size_type capacity() const {
+		return links.size();
+	}
+
+	void reserve(size_type s) {
+		if (s > capacity()) _reserve(s);
+	}
+
+	// Releases the trailing slots which are all empty, and removes them from the list of empty slots.
+	void shrink_to_fit() {
+		const auto new_size = _filled_end();
+		if (new_size != capacity()) {
+			pos.empty = forward_unlink_slots_from(links.begin(), pos.empty, new_size, npos);
+			links.erase(next_iterator(links.cbegin(), new_size), links.cend());
+			values.erase(next_iterator(values.cbegin(), new_size), values.cend());
+			occupancy.resize(new_size);
+		}
+		links.shrink_to_fit();
+		values.shrink_to_fit();
+	}
+
+	id_type insert(const value_type &v) {
+		if (capacity() == size())
+			_reserve(_grow_size(size_type(1)));
+		return _insert(v);
+	}
+
+	id_type insert(value_type &&v) {
+		if (capacity() == size())
+			_reserve(_grow_size(size_type(1)));
+		return _insert(std::move(v));
+	}
+
+	// Constructs the value in place, inside the empty slot.
+	template<typename... Args>
+	id_type emplace(Args&&... args) {
+		if (capacity() == size())
+			_reserve(_grow_size(size_type(1)));
+		return _emplace(std::forward<Args>(args)...);
+	}
+
+	// Inserts all values from the range, and writes their ids to "out".
+	// If the range models ForwardRange, capacity is increased at most once.
+	template<typename I, typename O>
+	// I models InputIterator
+	// O models OutputIterator
+	O insert_range(I first, I last, O out) {
+		return _insert_range(first, last, out, IteratorCategory<I>{});
+	}
+
+	template<typename I>
+	// I models InputIterator
+	void insert_range(I first, I last) {
+		insert_range(first, last, discard_iterator{});
+	}
+
+	id_type erase(id_type id) {
+		return _erase(static_cast<size_type>(id));
+	}
+
+	void clear() {
+		_clear();
+	}
+
+	bool empty() const {
+		return filled_size == size_type(0);
+	}
+
+	// Iterators walk over the filled slots in the order of insertion.
+	iterator begin() {
+		return iterator(links, values, pos.filled, pos.filled.first);
+	}
+
+	iterator end() {
+		return iterator(links, values, pos.filled, npos);
+	}
+
+	const_iterator begin() const {
+		return cbegin();
+	}
+
+	const_iterator end() const {
+		return cend();
+	}
+
+	const_iterator cbegin() const {
+		return const_iterator(links, values, pos.filled, pos.filled.first);
+	}
+
+	const_iterator cend() const {
+		return const_iterator(links, values, pos.filled, npos);
+	}
+
+	iterator iterator_of_id(id_type id) {
+		return iterator(links, values, pos.filled, id);
+	}
+
+	const_iterator iterator_of_id(id_type id) const {
+		return const_iterator(links, values, pos.filled, id);
+	}
+
+	id_type id_of_iterator(const_iterator it) const {
+		return it.id();
+	}
+
+	// Once enabled, the occupancy bitmap is kept in sync by all modifying methods, 
+	// and "for_each" visits the objects in the order of their slots.
+	void enable_occupancy_bitmap() {
+		if (occupancy.is_enabled()) return;
+		occupancy.enable(links.size());
+		for (auto i = pos.filled.first; i != npos; i = links[i].next)
+			occupancy.set(i);
+	}
+
+	void disable_occupancy_bitmap() {
+		if (defrag_empty_pos != npos) _defragment_empty(npos);
+		defrag_pos = size_type(0);
+		occupancy.disable();
+	}
+
+	bool has_occupancy_bitmap() const {
+		return occupancy.is_enabled();
+	}
+
+	// Relinks the filled list and the list of empty slots in the ascending order of slots, without moving any objects,
+	// so all ids stay valid. At most "budget" slots are relinked per call, filled ones first and then empty ones, and 
+	// the next call continues where the previous one stopped. Objects inserted or erased in between keep the relinked 
+	// part of both lists in order. Returns true once the pass is finished. Enables the occupancy bitmap.
+	bool defragment(size_type budget = npos) {
+		enable_occupancy_bitmap();
+		while (defrag_empty_pos == npos) {
+			const auto index = occupancy.find_next_set(defrag_pos);
+			if (index >= links.size()) {
+				defrag_pos = npos;
+				defrag_empty_pos = size_type(0);
+				pos.empty = { npos, npos };
+				break;
+			}
+			if (budget == size_type(0)) return false;
+			pos.filled = bidirectional_relink_filled_in_order(links.begin(), pos.filled, npos, static_cast<size_type>(index), occupancy);
+			defrag_pos = static_cast<size_type>(index + 1);
+			--budget;
+		}
+		return _defragment_empty(budget);
+	}
+
+	// Calls "f" with every stored object. Objects are visited in the order of their slots 
+	// if the occupancy bitmap is enabled, and in the order of insertion otherwise.
+	template<typename F>
+	// F models UnaryProcedure : void operator()(value_type&)
+	F for_each(F f) {
+		if (occupancy.is_enabled())
+			occupancy.for_each_set([this, &f](std::size_t i) { f(values[i]); });
+		else
+			for (auto &v : *this) f(v);
+		return f;
+	}
+
+	template<typename F>
+	// F models UnaryProcedure : void operator()(const value_type&)
+	F for_each(F f) const {
+		if (occupancy.is_enabled())
+			occupancy.for_each_set([this, &f](std::size_t i) { f(values[i]); });
+		else
+			for (auto &v : *this) f(v);
+		return f;
+	}
+
+	// Writes the links, the values, the lists of filled and empty slots and the occupancy bitmap, 
+	// so that "load" restores the same ids.
+	template<typename O>
+	// O models BinaryOutputStream
+	void save(O &os) const {
+		snapshot_write_header(os, snapshot_kind::split_slot_list, sizeof(size_type), 0, sizeof(value_type));
+		snapshot_write_container(os, links);
+		snapshot_write_container(os, values);
+		snapshot_write(os, filled_size);
+		snapshot_write(os, pos);
+		occupancy.save(os);
+		snapshot_write(os, defrag_pos);
+		snapshot_write(os, defrag_empty_pos);
+	}
+
+	// Replaces the contents with a snapshot written by "save". Returns false if the stream fails or holds
+	// a snapshot of some other container, in which case this one is left empty.
+	template<typename I>
+	// I models BinaryInputStream
+	bool load(I &is) {
+		if (snapshot_read_header(is, snapshot_kind::split_slot_list, sizeof(size_type), 0, sizeof(value_type)) &&
+			snapshot_read_container(is, links) && snapshot_read_container(is, values) && snapshot_read(is, filled_size) && snapshot_read(is, pos) && occupancy.load(is) &&
+			snapshot_read(is, defrag_pos) && snapshot_read(is, defrag_empty_pos))
+			return true;
+		links.clear();
+		values.clear();
+		filled_size = size_type(0);
+		pos = meta_positions_type{ { npos, npos },{ npos, npos } };
+		occupancy.disable();
+		defrag_pos = size_type(0);
+		defrag_empty_pos = npos;
+		return false;
+	}
+};
+
+template<typename T, typename S, typename A, typename G, unsigned ChunkBits>
+constexpr typename split_slot_list<T, S, A, G, ChunkBits>::size_type split_slot_list<T, S, A, G, ChunkBits>::npos;
+
+
+
+
+// Variation of "versioned_slot_list" which keeps the links and versions of its slots apart from the values.
+template<typename T,
+	typename V = default_version_type,
+	typename S = default_size_type,
+	typename A = default_allocator_type<T>,
+	typename G = default_growth_policy,
+	unsigned ChunkBits = 0>
+class versioned_split_slot_list {
+public:
+	using value_type = T;
+	using size_type = S;
+	using growth_policy_type = G;
+	using id_traits_type = IdTraits<size_type, V>;
+	using version_type = VersionType<id_traits_type>;
+	using id_type = typename id_traits_type::id_type;
+	using link_type = sl_versioned_link_type<size_type, version_type>;
+	using link_container_type = sl_container_type<link_type, A, ChunkBits>;
+	using value_container_type = sl_container_type<value_type, A, ChunkBits>;
+	using iterator = split_slot_list_iterator<link_container_type, value_container_type, sl_versioned_id_obj<id_traits_type>>;
+	using const_iterator = split_slot_list_iterator<const link_container_type, const value_container_type, sl_versioned_id_obj<id_traits_type>>;
+
+private:
+	static constexpr size_type npos = max_type_value<size_type>();
+	using meta_positions_type = bidirectional_slot_meta_positions<S>;
+	using occupancy_type = occupancy_bitmap<A>;
+
+	link_container_type links;
+	value_container_type values;
+	size_type filled_size;
+	meta_positions_type pos;
+	occupancy_type occupancy;
+	size_type defrag_pos;
+	size_type defrag_empty_pos;
+	version_type version_floor;
+
+	// Capacity which fits "n" more values.
+	size_type _grow_size(size_type n) const {
+		return grow_size_within<growth_policy_type>(id_traits_type::max_size(), size(), n, sizeof(link_type) + sizeof(value_type));
+	}
+
+	void _reserve(size_type s) {
+		check_id_max_size(s, id_traits_type::max_size());
+		if (defrag_empty_pos != npos) _defragment_empty(npos);
+		size_type prev_size = links.size();
+		values.resize(s);
+		links.resize(s);
+		if (version_floor != min_type_value<version_type>())
+			versioned_set_version(next_iterator(links.begin(), prev_size), links.end(), version_floor);
+		pos.empty = forward_empty_all_slots_with_meta(links.begin(), prev_size, links.end(), pos.empty, npos);
+		occupancy.resize(links.size());
+	}
+
+	template<typename U>
+	id_type _insert(U&& v) {
+		_defrag_before_insert();
+		values[pos.empty.first] = std::forward<U>(v);
+		pos = bidirectional_link_to_filled(links.begin(), pos, npos);
+		const auto index = pos.filled.second;
+		occupancy.set(index);
+		_defrag_inserted(index);
+		++filled_size;
+		return _get_id_unguarded(index);
+	}
+
+	template<typename... Args>
+	id_type _emplace(Args&&... args) {
+		_defrag_before_insert();
+		reconstruct_value(values[pos.empty.first], std::forward<Args>(args)...);
+		pos = bidirectional_link_to_filled(links.begin(), pos, npos);
+		const auto index = pos.filled.second;
+		occupancy.set(index);
+		_defrag_inserted(index);
+		++filled_size;
+		return _get_id_unguarded(index);
+	}
+
+	template<typename I, typename O>
+	O _insert_range(I first, I last, O out, std::input_iterator_tag) {
+		while (first != last) {
+			if (capacity() == size())
+				_reserve(_grow_size(size_type(1)));
+			*out = _insert(*first);
+			++out;
+			++first;
+		}
+		return out;
+	}
+
+	// The empty list is walked once, and the new slots join the filled list as a single chain. A defragmenting pass 
+	// which is under way relinks each insertion into place, so it takes the values one at a time.
+	template<typename I, typename O>
+	O _insert_range(I first, I last, O out, std::forward_iterator_tag) {
+		const auto n = static_cast<size_type>(std::distance(first, last));
+		if (capacity() - size() < n)
+			_reserve(_grow_size(n));
+		if (defrag_pos != size_type(0) || defrag_empty_pos != npos)
+			return _insert_range(first, last, out, std::input_iterator_tag());
+		return bidirectional_link_range_to_filled(links.begin(), pos, npos, first, last, out, [this](size_type index, I it) -> id_type {
+			values[index] = *it;
+			occupancy.set(index);
+			++filled_size;
+			return _get_id_unguarded(index);
+		});
+	}
+
+	id_type _erase(size_type index) {
+		id_type next = _id_next(index);
+		pos = defrag_empty_pos == npos ? versioned_bidirectional_link_to_empty(links.begin(), pos, npos, index) :
+			bidirectional_link_to_empty_in_order(links.begin(), pos, npos, index, defrag_empty_pos, occupancy);
+		++links[index].version;
+		occupancy.reset(index);
+		--filled_size;
+		return next;
+	}
+
+	// While a defragmenting pass relinks empty slots, the list of empty slots holds only those it has relinked,
+	// so one more is linked once that list runs out.
+	void _defrag_before_insert() {
+		if (pos.empty.first == npos) _defragment_empty(size_type(1));
+	}
+
+	// Filled slots which a defragmenting pass has already relinked stay in ascending order.
+	void _defrag_inserted(size_type index) {
+		if (index < defrag_pos)
+			pos.filled = bidirectional_relink_filled_in_order(links.begin(), pos.filled, npos, index, occupancy);
+	}
+
+	// Second half of a defragmenting pass. Appends at most "budget" empty slots to the list of empty slots, 
+	// in ascending order. Returns true once all of them are linked, which finishes the pass.
+	bool _defragment_empty(size_type budget) {
+		for (;;) {
+			const auto index = occupancy.find_next_clear(defrag_empty_pos, links.size());
+			if (index == occupancy_type::npos) break;
+			if (budget == size_type(0)) return false;
+			pos.empty = forward_link_empty_to_tail(links.begin(), pos.empty, npos, static_cast<size_type>(index));
+			defrag_empty_pos = static_cast<size_type>(index + 1);
+			--budget;
+		}
+		defrag_pos = size_type(0);
+		defrag_empty_pos = npos;
+		return true;
+	}
+
+	void _clear() {
+		if (defrag_empty_pos != npos) _defragment_empty(npos);
+		if (growth_policy_type::is_over_breakoff(capacity(), size())) {
+			versioned_forward_empty_all_slots(links.begin(), links.end(), size_type(0), npos);
+			pos = meta_positions_type{ { 0, links.size() - 1 },{ npos, npos } };
+		}
+		else {
+			const auto empty_pos = versioned_forward_empty_filled_slots(links.begin(), pos.empty.first, pos.filled.first, npos);
+			const auto empty_tail = pos.empty.second != npos ? pos.empty.second : pos.filled.first;
+			pos = meta_positions_type{ { empty_pos, empty_tail },{ npos, npos } };
+		}
+		occupancy.reset_all();
+		filled_size = size_type(0);
+	}
+
+	id_type _get_id_unguarded(size_type index) const {
+		return id_traits_type::make(index, links[index].version);
+	}
+
+	id_type _get_id(size_type index) const {
+		return index == npos ? id_traits_type::end() : id_traits_type::make(index, links[index].version);
+	}
+
+	id_type _id_next(size_type index) const {
+		return _get_id(links[index].next);
+	}
+
+	// One past the index of the last filled slot.
+	size_type _filled_end() const {
+		if (occupancy.is_enabled()) {
+			const auto last = occupancy.find_prev_set(links.size());
+			return last == occupancy_type::npos ? size_type(0) : static_cast<size_type>(last + 1);
+		}
+		size_type end = 0;
+		for (auto i = pos.filled.first; i != npos; i = links[i].next)
+			end = (std::max)(end, static_cast<size_type>(i + 1));
+		return end;
+	}
+
+public:
+	versioned_split_slot_list(AllocatorType<value_container_type> &&alloc = AllocatorType<value_container_type>{}) :
+		links(AllocatorType<link_container_type>(alloc)),
+		values(std::move(alloc)),
+		filled_size(size_type(0)),
+		pos({ { npos, npos },{ npos, npos } }),
+		occupancy(values.get_allocator()),
+		defrag_pos(size_type(0)),
+		defrag_empty_pos(npos),
+		version_floor(min_type_value<version_type>())
+	{}
+
+	versioned_split_slot_list(const AllocatorType<value_container_type> &alloc) :
+		links(AllocatorType<link_container_type>(alloc)),
+		values(alloc),
+		filled_size(size_type(0)),
+		pos({ { npos, npos },{ npos, npos } }),
+		occupancy(values.get_allocator()),
+		defrag_pos(size_type(0)),
+		defrag_empty_pos(npos),
+		version_floor(min_type_value<version_type>())
+	{}
+
+	template<typename I>
+	// I models InputIterator
+	versioned_split_slot_list(I first, I last, AllocatorType<value_container_type> &&alloc = AllocatorType<value_container_type>{}) :
+		versioned_split_slot_list(std::move(alloc))
+	{
+		insert_range(first, last);
+	}
+
+	value_type& id_value(id_type id) {
+		return values[id_traits_type::index(id)];
+	}
+
+	const value_type& id_value(id_type id) const {
+		return values[id_traits_type::index(id)];
+	}
+
+	id_type id_next(id_type id) const {
+		return _id_next(id_traits_type::index(id));
+	}
+	
+	bool id_is_end(id_type id) const {
+		return id_traits_type::is_end(id);
+	}
+
+	void reset_version_counts() {
+		versioned_reset(links.begin(), links.end());
+		version_floor = min_type_value<version_type>();
+	}
+
+	void clear_and_reset_version_counts() {
+		version_floor = min_type_value<version_type>();
+		versioned_forward_empty_and_reset_all_slots(links.begin(), links.end(), size_type(0), npos);
+		pos = meta_positions_type{ { 0, links.size() - 1 },{ npos, npos } };
+		occupancy.reset_all();
+		filled_size = size_type(0);
+		defrag_pos = size_type(0);
+		defrag_empty_pos = npos;
+	}
+
+	// Slots released by "shrink_to_fit" may be referenced by old ids, so the index is checked first.
+	bool id_is_valid(id_type id) const {
+		const auto index = id_traits_type::index(id);
+		return index < links.size() && id_traits_type::has_version(id, links[index].version);
+	}
+
+	id_type id_begin() const {
+		return _get_id(pos.filled.first);
+	}
+
+	size_type size() const {
+		return filled_size;
+	}
+
+	size_type capacity() const {
+		return links.size();
+	}
+
+	void reserve(size_type s) {
+		if (s > capacity()) _reserve(s);
+	}
+
+	// Releases the trailing slots which are all empty, and removes them from the list of empty slots.
+	// Versions of released slots are remembered, so that ids of objects which used to be stored in them
+	// don't become valid again once those slots are reused.
+	void shrink_to_fit() {
+		const auto new_size = _filled_end();
+		if (new_size != capacity()) {
+			pos.empty = forward_unlink_slots_from(links.begin(), pos.empty, new_size, npos);
+			version_floor = versioned_max_version(next_iterator(links.begin(), new_size), links.end(), version_floor);
+			links.erase(next_iterator(links.cbegin(), new_size), links.cend());
+			values.erase(next_iterator(values.cbegin(), new_size), values.cend());
+			occupancy.resize(new_size);
+		}
+		links.shrink_to_fit();
+		values.shrink_to_fit();
+	}
+
+	id_type insert(const value_type &v) {
+		if (capacity() == size())
+			_reserve(_grow_size(size_type(1)));
+		return _insert(v);
+	}
+
+	id_type insert(value_type &&v) {
+		if (capacity() == size())
+			_reserve(_grow_size(size_type(1)));
+		return _insert(std::move(v));
+	}
+
+	// Constructs the value in place, inside the empty slot.
+	template<typename... Args>
+	id_type emplace(Args&&... args) {
+		if (capacity() == size())
+			_reserve(_grow_size(size_type(1)));
+		return _emplace(std::forward<Args>(args)...);
+	}
+
+	// Inserts all values from the range, and writes their ids to "out".
+	// If the range models ForwardRange, capacity is increased at most once.
+	template<typename I, typename O>
+	// I models InputIterator
+	// O models OutputIterator
+	O insert_range(I first, I last, O out) {
+		return _insert_range(first, last, out, IteratorCategory<I>{});
+	}
+
+	template<typename I>
+	// I models InputIterator
+	void insert_range(I first, I last) {
+		insert_range(first, last, discard_iterator{});
+	}
+
+	id_type erase(id_type id) {
+		return _erase(id_traits_type::index(id));
+	}
+
+	void clear() {
+		_clear();
+	}
+
+	bool empty() const {
+		return filled_size == size_type(0);
+	}
+
+	// Iterators walk over the filled slots in the order of insertion.
+	iterator begin() {
+		return iterator(links, values, pos.filled, pos.filled.first);
+	}
+
+	iterator end() {
+		return iterator(links, values, pos.filled, npos);
+	}
+
+	const_iterator begin() const {
+		return cbegin();
+	}
+
+	const_iterator end() const {
+		return cend();
+	}
+
+	const_iterator cbegin() const {
+		return const_iterator(links, values, pos.filled, pos.filled.first);
+	}
+
+	const_iterator cend() const {
+		return const_iterator(links, values, pos.filled, npos);
+	}
+
+	iterator iterator_of_id(id_type id) {
+		return iterator(links, values, pos.filled, id_traits_type::index(id));
+	}
+
+	const_iterator iterator_of_id(id_type id) const {
+		return const_iterator(links, values, pos.filled, id_traits_type::index(id));
+	}
+
+	id_type id_of_iterator(const_iterator it) const {
+		return it.id();
+	}
+
+	// Once enabled, the occupancy bitmap is kept in sync by all modifying methods, 
+	// and "for_each" visits the objects in the order of their slots.
+	void enable_occupancy_bitmap() {
+		if (occupancy.is_enabled()) return;
+		occupancy.enable(links.size());
+		for (auto i = pos.filled.first; i != npos; i = links[i].next)
+			occupancy.set(i);
+	}
+
+	void disable_occupancy_bitmap() {
+		if (defrag_empty_pos != npos) _defragment_empty(npos);
+		defrag_pos = size_type(0);
+		occupancy.disable();
+	}
+
+	bool has_occupancy_bitmap() const {
+		return occupancy.is_enabled();
+	}
+
+	// Relinks the filled list and the list of empty slots in the ascending order of slots, without moving any objects,
+	// so all ids stay valid. At most "budget" slots are relinked per call, filled ones first and then empty ones, and 
+	// the next call continues where the previous one stopped. Objects inserted or erased in between keep the relinked 
+	// part of both lists in order. Returns true once the pass is finished. Enables the occupancy bitmap.
+	bool defragment(size_type budget = npos) {
+		enable_occupancy_bitmap();
+		while (defrag_empty_pos == npos) {
+			const auto index = occupancy.find_next_set(defrag_pos);
+			if (index >= links.size()) {
+				defrag_pos = npos;
+				defrag_empty_pos = size_type(0);
+				pos.empty = { npos, npos };
+				break;
+			}
+			if (budget == size_type(0)) return false;
+			pos.filled = bidirectional_relink_filled_in_order(links.begin(), pos.filled, npos, static_cast<size_type>(index), occupancy);
+			defrag_pos = static_cast<size_type>(index + 1);
+			--budget;
+		}
+		return _defragment_empty(budget);
+	}
+
+	// Calls "f" with every stored object. Objects are visited in the order of their slots 
+	// if the occupancy bitmap is enabled, and in the order of insertion otherwise.
+	template<typename F>
+	// F models UnaryProcedure : void operator()(value_type&)
+	F for_each(F f) {
+		if (occupancy.is_enabled())
+			occupancy.for_each_set([this, &f](std::size_t i) { f(values[i]); });
+		else
+			for (auto &v : *this) f(v);
+		return f;
+	}
+
+	template<typename F>
+	// F models UnaryProcedure : void operator()(const value_type&)
+	F for_each(F f) const {
+		if (occupancy.is_enabled())
+			occupancy.for_each_set([this, &f](std::size_t i) { f(values[i]); });
+		else
+			for (auto &v : *this) f(v);
+		return f;
+	}
+
+	// Writes the links, the values, the lists of filled and empty slots, the versions and the occupancy bitmap, 
+	// so that "load" restores the same ids.
+	template<typename O>
+	// O models BinaryOutputStream
+	void save(O &os) const {
+		snapshot_write_header(os, snapshot_kind::versioned_split_slot_list, sizeof(size_type), sizeof(version_type), sizeof(value_type));
+		snapshot_write_container(os, links);
+		snapshot_write_container(os, values);
+		snapshot_write(os, filled_size);
+		snapshot_write(os, pos);
+		snapshot_write(os, version_floor);
+		occupancy.save(os);
+		snapshot_write(os, defrag_pos);
+		snapshot_write(os, defrag_empty_pos);
+	}
+
+	// Replaces the contents with a snapshot written by "save". Returns false if the stream fails or holds
+	// a snapshot of some other container, in which case this one is left empty.
+	template<typename I>
+	// I models BinaryInputStream
+	bool load(I &is) {
+		if (snapshot_read_header(is, snapshot_kind::versioned_split_slot_list, sizeof(size_type), sizeof(version_type), sizeof(value_type)) &&
+			snapshot_read_container(is, links) && snapshot_read_container(is, values) && snapshot_read(is, filled_size) && snapshot_read(is, pos) && snapshot_read(is, version_floor) && occupancy.load(is) &&
+			snapshot_read(is, defrag_pos) && snapshot_read(is, defrag_empty_pos))
+			return true;
+		links.clear();
+		values.clear();
+		filled_size = size_type(0);
+		pos = meta_positions_type{ { npos, npos },{ npos, npos } };
+		version_floor = min_type_value<version_type>();
+		occupancy.disable();
+		defrag_pos = size_type(0);
+		defrag_empty_pos = npos;
+		return false;
+	}
+};
+
+template<typename T, typename V, typename S, typename A, typename G, unsigned ChunkBits>
+constexpr typename versioned_split_slot_list<T, V, S, A, G, ChunkBits>::size_type versioned_split_slot_list<T, V, S, A, G, ChunkBits>::npos;
+
+
+
+
+
+
+
+
+
+
+
+template<typename T,
+	typename S = default_size_type,
+	typename A = default_allocator_type<T>,
+	typename G = default_growth_policy>
+class slot_map {
+public:
+	using value_type = T;
+	using size_type = S;
+	using growth_policy_type = G;
+	using id_type = size_type;
+
+	using slot_type = sm_slot_type<size_type>;
+	using id_slot_container_type = sm_id_slot_container_type<slot_type, A>;
+	using value_container_type = sm_value_container_type<value_type, A>;
+	using id_pos_container_type = sm_id_pos_container_type<size_type, A>;
+
+	using difference_type = typename value_container_type::difference_type;
+	using iterator = typename value_container_type::iterator;
+	using const_iterator = typename value_container_type::const_iterator;
+	using reverse_iterator = typename value_container_type::reverse_iterator;
+	using const_reverse_iterator = typename value_container_type::const_reverse_iterator;
+
+private:
+	static constexpr size_type npos = max_type_value<size_type>();
+
+	id_slot_container_type id_slots;
+	value_container_type values;
+	id_pos_container_type id_positions;
+	std::pair<size_type, size_type> empty_pos;
+	occupancy_bitmap<A> dead;
+	size_type nm_dead;
+
+	// Capacity which fits "n" more values.
+	size_type _grow_size(size_type n) const {
+		return growth_policy_type::grow_size(size(), n, sizeof(value_type));
+	}
+
+	void _reserve(size_type s) {
+		const auto prev_size = static_cast<size_type>(id_slots.size());
+		if (s > prev_size) {
+			id_slots.resize(s);
+			empty_pos = trivial_forward_empty_all_slots_with_meta(id_slots.begin(), prev_size, id_slots.end(), empty_pos, npos);
+		}
+
+		values.reserve(s);
+		id_positions.reserve(s);
+		dead.resize(capacity());
+	}
+
+	template<typename... Args>
+	std::pair<iterator, id_type> _emplace(Args&&... args) {
+		const auto value_pos = static_cast<size_type>(values.size());
+		values.emplace_back(std::forward<Args>(args)...);
+		return{ values.end() - 1, _link_value(value_pos) };
+	}
+
+	// Takes the id slot from the head of the empty list, and makes it point to the value at "value_pos".
+	id_type _link_value(size_type value_pos) {
+		id_positions.push_back(empty_pos.first);
+
+		const auto id = empty_pos.first;
+		auto &slot = iterator_slot(id_slots.begin(), empty_pos.first);
+
+		if (empty_pos.first == empty_pos.second) {
+			empty_pos.second = npos;
+			empty_pos.first = npos;
+		}
+		else {
+			empty_pos.first = slot.value;
+		}
+		slot.value = value_pos;
+
+		return id;
+	}
+
+	template<typename I, typename O>
+	O _insert_range(I first, I last, O out, std::input_iterator_tag) {
+		while (first != last) {
+			if (capacity() == size())
+				_reserve(_grow_size(size_type(1)));
+			*out = _emplace(*first).second;
+			++out;
+			++first;
+		}
+		return out;
+	}
+
+	// Values are copied in one go, after which their ids are linked in a single pass.
+	template<typename I, typename O>
+	O _insert_range(I first, I last, O out, std::forward_iterator_tag) {
+		const auto n = static_cast<size_type>(std::distance(first, last));
+		if (capacity() - size() < n)
+			_reserve(_grow_size(n));
+
+		auto value_pos = size();
+		values.insert(values.end(), first, last);
+		for (const auto new_size = size(); value_pos != new_size; ++value_pos) {
+			*out = _link_value(value_pos);
+			++out;
+		}
+		return out;
+	}
+
+	void _erase(size_type id_index, size_type value_pos) {
+		const auto last_pos = static_cast<size_type>(size() - 1);
+		if (value_pos != last_pos)
+			_move_value(last_pos, value_pos);
+		id_positions.pop_back();
+		values.pop_back();
+		_free_id_slot(id_index);
+	}
+
+	// Moves the value at position "from" to position "to", together with its id position,
+	// and makes its id slot point to the new position.
+	void _move_value(size_type from, size_type to) {
+		const auto pos = iterator_slot(id_positions.begin(), from);
+		iterator_slot(id_positions.begin(), to) = pos;
+		iterator_slot(id_slots.begin(), pos).value = to;
+		iterator_slot(values.begin(), to) = std::move(iterator_slot(values.begin(), from));
+	}
+
+	// Destroys all values from position "new_size" onwards.
+	void _truncate(size_type new_size) {
+		values.erase(next_iterator(values.begin(), new_size), values.end());
+		id_positions.erase(next_iterator(id_positions.begin(), new_size), id_positions.end());
+	}
+
+	// Makes the id slot the head of the empty list.
+	void _free_id_slot(size_type id_index) {
+		_free_id_slots({ id_index, id_index });
+	}
+
+	// Makes the chain of id slots from "chain.first" to "chain.second" the head of the empty list.
+	void _free_id_slots(const std::pair<size_type, size_type> &chain) {
+		iterator_slot(id_slots.begin(), chain.second).value = empty_pos.first;
+		if (empty_pos.second == npos)
+			empty_pos.second = chain.second;
+		empty_pos.first = chain.first;
+	}
+
+	// Fills the holes left by marked values below "new_size" with the values which survive above it.
+	// Ids in the range are the ones whose values were marked.
+	template<typename I>
+	void _erase_marked(I first, I last, size_type new_size) {
+		auto survivor = static_cast<size_type>(size());
+		for (; first != last; ++first) {
+			const auto id_index = static_cast<size_type>(*first);
+			const auto value_pos = iterator_slot(id_slots.begin(), id_index).value;
+			if (value_pos < new_size) {
+				do --survivor; while (iterator_slot(id_positions.begin(), survivor) == npos);
+				_move_value(survivor, value_pos);
+			}
+			_free_id_slot(id_index);
+		}
+		_truncate(new_size);
+	}
+
+	void _erase_if_finish(size_type new_size, const std::pair<size_type, size_type> &freed) {
+		_truncate(new_size);
+		if (freed.first != npos)
+			_free_id_slots(freed);
+	}
+
+
+	// One past the index of the last id slot in use.
+	size_type _filled_end() const {
+		return id_positions.empty() ? size_type(0) : static_cast<size_type>(*std::max_element(id_positions.begin(), id_positions.end()) + 1);
+	}
+
+	void _clear() {
+		if (growth_policy_type::is_over_breakoff(capacity(), size())) {
+			trivial_forward_empty_all_slots(id_slots.begin(), id_slots.end(), size_type(0), npos);
+			empty_pos.first = 0;
+			empty_pos.second = id_slots.size() - 1;
+		}
+		else if (!id_positions.empty()) {
+			if (empty_pos.second == npos)
+				empty_pos.second = id_positions.front();
+			empty_pos.first = forward_empty_filled_dense_slots(id_positions.begin(), id_positions.end(), id_slots.begin(), empty_pos.first);
+		}
+		values.clear();
+		id_positions.clear();
+		dead.reset_all();
+		nm_dead = 0;
+	}
+
+	template<typename I>
+	const value_type &_get_value(I index) const {
+		return iterator_slot(values.cbegin(), index);
+	}
+
+	template<typename I>
+	value_type &_get_value(I index) {
+		return iterator_slot(values.begin(), index);
+	}
+
+public:
+	slot_map(AllocatorType<id_slot_container_type> &&id_slots_allocator = AllocatorType<id_slot_container_type>{},
+		AllocatorType<value_container_type> &&value_allocator = AllocatorType<value_container_type>{},
 		AllocatorType<id_pos_container_type> &&is_positions_allocator = AllocatorType<id_pos_container_type>{}) :
 		id_slots(std::move(id_slots_allocator)),
 		values(std::move(value_allocator)),
-		id_positions(std::move(is_positions_allocator))
+		id_positions(std::move(is_positions_allocator)),
+		empty_pos(npos, npos),
+		dead(values.get_allocator()),
+		nm_dead(0)
+	{
+
+	}
+
+	slot_map(const AllocatorType<id_slot_container_type> &id_slots_allocator,
+		const AllocatorType<value_container_type> &value_allocator,
+		const AllocatorType<id_pos_container_type> &is_positions_allocator) :
+		id_slots(id_slots_allocator),
+		values(value_allocator),
+		id_positions(is_positions_allocator),
+		empty_pos(npos, npos),
+		dead(values.get_allocator()),
+		nm_dead(0)
+	{
+
+	}
+
+
+	// All three containers allocate from copies of "alloc", rebound to their value types.
+	explicit slot_map(const A &alloc) :
+		id_slots(AllocatorType<id_slot_container_type>(alloc)),
+		values(AllocatorType<value_container_type>(alloc)),
+		id_positions(AllocatorType<id_pos_container_type>(alloc)),
+		empty_pos(npos, npos),
+		dead(values.get_allocator()),
+		nm_dead(0)
+	{
+
+	}
+
+#ifdef REA_HAS_PMR
+	// E.g. rea::pmr::slot_map<T> sm(&arena)
+	// Only exists if "A" can be made out of a memory resource, E.g. std::pmr::polymorphic_allocator.
+	template<typename R,
+		typename = typename std::enable_if<std::is_convertible<R*, std::pmr::memory_resource*>::value &&
+			std::is_constructible<A, std::pmr::memory_resource*>::value>::type>
+	explicit slot_map(R *resource) :
+		slot_map(A(static_cast<std::pmr::memory_resource*>(resource)))
+	{
+
+	}
+
+#endif
+	template<typename I>
+	// I models InputIterator
+	slot_map(I first, I last) :
+		slot_map()
+	{
+		insert_range(first, last);
+	}
+
+	value_type& id_value(id_type id) {
+		return _get_value(iterator_slot(id_slots.begin(), id).value);
+	}
+
+	const value_type& id_value(id_type id) const {
+		return _get_value(iterator_slot(id_slots.cbegin(), id).value);
+	}
+
+	constexpr static void reset_version_counts() {
+
+	}
+
+	void clear_and_reset_version_counts() {
+		clear();
+	}
+
+	constexpr static bool id_is_valid(id_type) {
+		return true;
+	}
+
+	size_type size() const {
+		return values.size();
+	}
+
+	size_type capacity() const {
+		return values.capacity();
+	}
+
+	void reserve(size_type s) {
+		if (s > capacity()) _reserve(s);
+	}
+
+	// Reallocates values and their id positions to fit, which invalidates all iterators. Trailing id slots
+	// which are all empty are released too, and removed from the list of empty id slots.
+	void shrink_to_fit() {
+		values.shrink_to_fit();
+		id_positions.shrink_to_fit();
+		dead.resize(capacity());
+		const auto new_size = (std::max)(_filled_end(), static_cast<size_type>(values.capacity()));
+		if (new_size < id_slots.size()) {
+			empty_pos = trivial_forward_unlink_slots_from(id_slots.begin(), empty_pos, new_size, npos);
+			id_slots.erase(next_iterator(id_slots.cbegin(), new_size), id_slots.cend());
+		}
+		id_slots.shrink_to_fit();
+	}
+
+	std::pair<iterator, id_type> insert(const value_type &v) {
+		if (capacity() == size())
+			_reserve(_grow_size(size_type(1)));
+		return _emplace(v);
+	}
+
+	std::pair<iterator, id_type> insert(value_type &&v) {
+		if (capacity() == size())
+			_reserve(_grow_size(size_type(1)));
+		return _emplace(std::move(v));
+	}
+
+	// Constructs the value in place, at the end of the value container.
+	template<typename... Args>
+	std::pair<iterator, id_type> emplace(Args&&... args) {
+		if (capacity() == size())
+			_reserve(_grow_size(size_type(1)));
+		return _emplace(std::forward<Args>(args)...);
+	}
+
+	// Inserts all values from the range, and writes their ids to "out", in the order of values.
+	// If the range models ForwardRange, capacity is increased at most once.
+	template<typename I, typename O>
+	// I models InputIterator
+	// O models OutputIterator
+	O insert_range(I first, I last, O out) {
+		return _insert_range(first, last, out, IteratorCategory<I>{});
+	}
+
+	template<typename I>
+	// I models InputIterator
+	void insert_range(I first, I last) {
+		insert_range(first, last, discard_iterator{});
+	}
+
+	void erase(id_type id) {
+		commit();
+		return _erase(id, iterator_slot(id_slots.begin(), id).value);
+	}
+
+	// Erases values of all ids in the range, and returns their number. Values are first marked as erased,
+	// after which the survivors are compacted in one pass, so each value is moved at most once.
+	// Ids have to be valid and unique.
+	template<typename I>
+	// I models ForwardIterator
+	// ValueType<I> == id_type
+	size_type erase_many(I first, I last) {
+		commit();
+		size_type erased = 0;
+		for (auto it = first; it != last; ++it) {
+			iterator_slot(id_positions.begin(), iterator_slot(id_slots.begin(), static_cast<size_type>(*it)).value) = npos;
+			++erased;
+		}
+		_erase_marked(first, last, static_cast<size_type>(size() - erased));
+		return erased;
+	}
+
+	// Erases all values which satisfy the predicate, and returns their number.
+	// Values are traversed once, and the remaining ones are compacted in place just like "std::remove_if" does,
+	// so their relative order is preserved. Freed id slots are chained during traversal, and linked to the empty list at once.
+	// If the predicate throws, values which weren't tested yet are kept.
+	template<typename P>
+	// P models UnaryPredicate : bool operator()(const value_type &);
+	size_type erase_if(P pred) {
+		commit();
+		const auto old_size = static_cast<size_type>(size());
+		std::pair<size_type, size_type> freed{ npos, npos };
+		size_type kept = 0;
+		size_type pos = 0;
+		try {
+			for (; pos != old_size; ++pos) {
+				if (pred(static_cast<const value_type&>(iterator_slot(values.begin(), pos)))) {
+					const auto id_index = iterator_slot(id_positions.begin(), pos);
+					if (freed.first == npos)
+						freed.first = id_index;
+					else
+						trivial_set_successor(iterator_slot(id_slots.begin(), freed.second), id_index);
+					freed.second = id_index;
+				}
+				else {
+					if (kept != pos)
+						_move_value(pos, kept);
+					++kept;
+				}
+			}
+		}
+		catch (...) {
+			for (; pos != old_size; ++pos, ++kept)
+				if (kept != pos)
+					_move_value(pos, kept);
+			_erase_if_finish(kept, freed);
+			throw;
+		}
+		_erase_if_finish(kept, freed);
+		return static_cast<size_type>(old_size - kept);
+	}
+
+	// Reorders values so that the value at position "first[i]" moves to position "i", for every position "i".
+	// Id positions move together with their values, and each id slot is updated as soon as its value lands,
+	// so ids stay valid. Values are moved along the cycles of the permutation, so each one is moved once,
+	// plus once more per cycle. The range must be a permutation of [0, size()), and no erasure may be deferred.
+	template<typename I>
+	// I models RandomAccessIterator
+	// ValueType<I> models Integral
+	void apply_permutation(I first) {
+		const auto n = static_cast<size_type>(size());
+		std::vector<bool, AllocatorRebindType<A, bool>> placed(n, false, AllocatorRebindType<A, bool>(values.get_allocator()));
+		for (size_type i = 0; i != n; ++i) {
+			if (placed[i]) continue;
+			auto value = std::move(iterator_slot(values.begin(), i));
+			const auto id_index = iterator_slot(id_positions.begin(), i);
+			auto to = i;
+			for (auto from = static_cast<size_type>(iterator_slot(first, to)); from != i; from = static_cast<size_type>(iterator_slot(first, to))) {
+				_move_value(from, to);
+				placed[to] = true;
+				to = from;
+			}
+			iterator_slot(values.begin(), to) = std::move(value);
+			iterator_slot(id_positions.begin(), to) = id_index;
+			iterator_slot(id_slots.begin(), id_index).value = to;
+			placed[to] = true;
+		}
+	}
+
+	// Sorts values with "comp", while keeping ids valid. Pending deferred erasures are committed first.
+	// Positions are sorted first, after which values are moved into place with "apply_permutation".
+	// Scratch memory of both comes from the allocator of the map.
+	template<typename C>
+	// C models StrictWeakOrdering : bool operator()(const value_type&, const value_type&)
+	void sort(C comp) {
+		commit();
+		std::vector<size_type, AllocatorRebindType<A, size_type>> order(size(), size_type(0), AllocatorRebindType<A, size_type>(values.get_allocator()));
+		for (size_type i = 0; i != static_cast<size_type>(order.size()); ++i)
+			order[i] = i;
+		std::sort(order.begin(), order.end(), [this, &comp](size_type a, size_type b) {
+			return comp(static_cast<const value_type&>(_get_value(a)), static_cast<const value_type&>(_get_value(b)));
+		});
+		apply_permutation(order.cbegin());
+	}
+
+	void sort() {
+		sort(std::less<value_type>{});
+	}
+
+	// Marks the value of the id as dead, instead of moving the last value into its place.
+	// The value stays where it is, so iteration which is under way isn't disturbed. It's destroyed by the next "commit".
+	// Any other erasure commits pending ones first. Returns false if the value is already dead, in which case nothing changes.
+	bool defer_erase(id_type id) {
+		const auto value_pos = iterator_slot(id_slots.begin(), id).value;
+		if (!dead.is_enabled())
+			dead.enable(capacity());
+		else if (dead.test(value_pos))
+			return false;
+		dead.set(value_pos);
+		++nm_dead;
+		return true;
+	}
+
+	// Erases all values marked by "defer_erase", and returns their number. Values are compacted in a single pass
+	// which starts at the first dead one, so the relative order of the remaining values is preserved.
+	size_type commit() {
+		if (nm_dead == size_type(0)) return 0;
+		const auto old_size = static_cast<size_type>(size());
+		std::pair<size_type, size_type> freed{ npos, npos };
+		auto kept = static_cast<size_type>(dead.find_next_set(0));
+		for (auto pos = kept; pos != old_size; ++pos) {
+			if (dead.test(pos)) {
+				const auto id_index = iterator_slot(id_positions.begin(), pos);
+				if (freed.first == npos)
+					freed.first = id_index;
+				else
+					trivial_set_successor(iterator_slot(id_slots.begin(), freed.second), id_index);
+				freed.second = id_index;
+			}
+			else {
+				_move_value(pos, kept);
+				++kept;
+			}
+		}
+		_erase_if_finish(kept, freed);
+		dead.reset_all();
+		const auto erased = nm_dead;
+		nm_dead = 0;
+		return erased;
+	}
+
+	// Number of values marked by "defer_erase" since the last commit.
+	size_type deferred_size() const {
+		return nm_dead;
+	}
+
+	// True if the value was marked by "defer_erase", and isn't erased yet.
+	bool is_dead(const_iterator it) const {
+		return nm_dead != size_type(0) && dead.test(iterator_distance<const_iterator, std::size_t>(cbegin(), it));
+	}
+
+	// Calls "f" with every value which isn't dead, in the order of values.
+	template<typename F>
+	// F models UnaryProcedure : void operator()(value_type&)
+	F for_each(F f) {
+		if (nm_dead == size_type(0)) {
+			for (auto &v : *this) f(v);
+			return f;
+		}
+		dead.for_each_clear(size(), [this, &f](std::size_t pos) { f(_get_value(pos)); });
+		return f;
+	}
+
+	template<typename F>
+	// F models UnaryProcedure : void operator()(const value_type&)
+	F for_each(F f) const {
+		if (nm_dead == size_type(0)) {
+			for (auto &v : *this) f(v);
+			return f;
+		}
+		dead.for_each_clear(size(), [this, &f](std::size_t pos) { f(_get_value(pos)); });
+		return f;
+	}
+
+	iterator erase(iterator it) {
+		if (nm_dead != size_type(0)) {
+			const auto id_index = iterator_slot(id_positions.begin(), iterator_distance<iterator, size_type>(begin(), it));
+			commit();
+			it = next_iterator(begin(), iterator_slot(id_slots.begin(), id_index).value);
+		}
+		const auto value_pos = iterator_distance<iterator, size_type>(begin(), it);
+		if (it == end()) {
+			_erase(iterator_slot(id_positions.begin(), value_pos), value_pos);
+			return end();
+		}
+		else {
+			_erase(iterator_slot(id_positions.begin(), value_pos), value_pos);
+			return it;
+		}
+	}
+
+	const_iterator erase(const_iterator it) {
+		if (nm_dead != size_type(0)) {
+			const auto id_index = iterator_slot(id_positions.begin(), iterator_distance<const_iterator, size_type>(cbegin(), it));
+			commit();
+			it = next_iterator(cbegin(), iterator_slot(id_slots.begin(), id_index).value);
+		}
+		const auto value_pos = iterator_distance<const_iterator, size_type>(cbegin(), it);
+		if (it == cend()) {
+			_erase(iterator_slot(id_positions.begin(), value_pos), value_pos);
+			return cend();
+		}
+		else {
+			_erase(iterator_slot(id_positions.begin(), value_pos), value_pos);
+			return it;
+		}
+	}
+
+	void clear() {
+		_clear();
+	}
+
+	bool empty() const {
+		return values.empty();
+	}
+
+	iterator begin() {
+		return values.begin();
+	}
+
+	const_iterator cbegin() const {
+		return values.cbegin();
+	}
+
+	const_iterator begin() const {
+		return cbegin();
+	}
+
+	reverse_iterator rbegin() {
+		return values.rbegin();
+	}
+
+	const_reverse_iterator crbegin() const {
+		return values.crbegin();
+	}
+
+	const_reverse_iterator rbegin() const {
+		return crbegin();
+	}
+
+	iterator end() {
+		return values.end();
+	}
+
+	const_iterator cend() const {
+		return values.cend();
+	}
+
+	const_iterator end() const {
+		return cend();
+	}
+
+	reverse_iterator rend() {
+		return values.rend();
+	}
+
+	const_reverse_iterator crend() const {
+		return values.crend();
+	}
+
+	const_reverse_iterator rend() const {
+		return crend();
+	}
+
+	iterator iterator_of_id(id_type id) {
+		return next_iterator(values.begin(), iterator_slot(id_slots.begin(), id).value);
+	}
+
+	const_iterator const_iterator_of_id(id_type id) const {
+		return next_iterator(values.cbegin(), iterator_slot(id_slots.cbegin(), id).value);
+	}
+
+	const_iterator iterator_of_id(id_type id) const {
+		return const_iterator_of_id(id);
+	}
+
+	id_type id_of_iterator(const_iterator it) const {
+		return iterator_slot(id_positions.cbegin(), iterator_distance(values.cbegin(), it));
+	}
+
+	id_type id_of_iterator(iterator it) const {
+		return id_of_iterator(const_iterator{ it });
+	}
+
+
+	// Writes the id slots, the values, their id positions, the list of empty id slots and the erasures
+	// deferred by "defer_erase", so that "load" restores the same ids. Values are written in one block
+	// if they are bitwise.
+	template<typename O>
+	// O models BinaryOutputStream
+	void save(O &os) const {
+		snapshot_write_header(os, snapshot_kind::slot_map, sizeof(size_type), 0, sizeof(value_type));
+		snapshot_write(os, static_cast<std::uint64_t>(capacity()));
+		snapshot_write_container(os, id_slots);
+		snapshot_write_container(os, values);
+		snapshot_write_container(os, id_positions);
+		snapshot_write(os, empty_pos);
+		snapshot_write(os, nm_dead);
+		dead.save(os);
+	}
+
+	// Replaces the contents with a snapshot written by "save", and reserves the same capacity. Returns false
+	// if the stream fails or holds a snapshot of some other container, in which case this one is left empty.
+	template<typename I>
+	// I models BinaryInputStream
+	bool load(I &is) {
+		std::uint64_t cap = 0;
+		if (snapshot_read_header(is, snapshot_kind::slot_map, sizeof(size_type), 0, sizeof(value_type)) &&
+			snapshot_read(is, cap) && cap <= values.max_size()) {
+			values.clear();
+			id_positions.clear();
+			values.reserve(static_cast<size_type>(cap));
+			id_positions.reserve(static_cast<size_type>(cap));
+			if (snapshot_read_container(is, id_slots) && snapshot_read_container(is, values) && snapshot_read_container(is, id_positions) &&
+				snapshot_read(is, empty_pos) && snapshot_read(is, nm_dead) && dead.load(is)) {
+				dead.resize(capacity());
+				return true;
+			}
+		}
+		id_slots.clear();
+		values.clear();
+		id_positions.clear();
+		empty_pos = std::pair<size_type, size_type>(npos, npos);
+		dead.disable();
+		nm_dead = size_type(0);
+		return false;
+	}
+};
+
+template<typename T, typename S, typename A, typename G>
+constexpr typename slot_map<T, S, A, G>::size_type slot_map<T, S, A, G>::npos;
+
+
+
+template<typename T,
+	typename S = default_size_type,
+	typename V = default_version_type,
+	typename A = default_allocator_type<T>,
+	typename G = default_growth_policy,
+	typename Containers = default_sm_containers>
+// Containers models SlotMapContainers, E.g. "default_sm_containers"
+class versioned_slot_map {
+public:
+	using value_type = T;
+	using size_type = S;
+	using growth_policy_type = G;
+	using id_traits_type = IdTraits<size_type, V>;
+	using version_type = VersionType<id_traits_type>;
+	using id_type = typename id_traits_type::id_type;
+
+	using slot_type = sm_versioned_slot_type<size_type, version_type>;
+	using id_slot_container_type = typename Containers::template id_slot_container<slot_type, A>;
+	using value_container_type = typename Containers::template value_container<value_type, A>;
+	using id_pos_container_type = typename Containers::template id_pos_container<size_type, A>;
+
+	using difference_type = typename value_container_type::difference_type;
+	using iterator = typename value_container_type::iterator;
+	using const_iterator = typename value_container_type::const_iterator;
+	using reverse_iterator = typename value_container_type::reverse_iterator;
+	using const_reverse_iterator = typename value_container_type::const_reverse_iterator;
+
+private:
+	static constexpr size_type npos = max_type_value<size_type>();
+
+	id_slot_container_type id_slots;
+	value_container_type values;
+	id_pos_container_type id_positions;
+	std::pair<size_type, size_type> empty_pos;
+	occupancy_bitmap<A> dead;
+	size_type nm_dead;
+	version_type version_floor;
+
+	// Capacity which fits "n" more values.
+	size_type _grow_size(size_type n) const {
+		return grow_size_within<growth_policy_type>(max_size(), size(), n, sizeof(value_type));
+	}
+
+	// Values are reserved first, so id slots are linked for all of their capacity, which may be more than "s".
+	void _reserve(size_type s) {
+		check_id_max_size(s, max_size());
+		values.reserve(s);
+		id_positions.reserve(s);
+
+		const auto prev_size = static_cast<size_type>(id_slots.size());
+		const auto new_size = (std::min)((std::max)(s, static_cast<size_type>(values.capacity())), max_size());
+		if (new_size > prev_size) {
+			id_slots.resize(new_size);
+			if (version_floor != min_type_value<version_type>())
+				versioned_set_version(next_iterator(id_slots.begin(), prev_size), id_slots.end(), version_floor);
+			empty_pos = trivial_forward_empty_all_slots_with_meta(id_slots.begin(), prev_size, id_slots.end(), empty_pos, npos);
+			_store_state();
+		}
+		dead.resize(capacity());
+	}
+
+	void _store_state() {
+		sm_store_state(id_slots, empty_pos, version_floor);
+	}
+
+	template<typename... Args>
+	std::pair<iterator, id_type> _emplace(Args&&... args) {
+		const auto value_pos = static_cast<size_type>(values.size());
+		values.emplace_back(std::forward<Args>(args)...);
+		return{ values.end() - 1, _link_value(value_pos) };
+	}
+
+	// Takes the id slot from the head of the empty list, and makes it point to the value at "value_pos".
+	id_type _link_value(size_type value_pos) {
+		id_positions.push_back(empty_pos.first);
+
+		const auto id = empty_pos.first;
+		auto &slot = iterator_slot(id_slots.begin(), empty_pos.first);
+
+		if (empty_pos.first == empty_pos.second) {
+			empty_pos.second = npos;
+			empty_pos.first = npos;
+		}
+		else {
+			empty_pos.first = slot.value;
+		}
+		slot.value = value_pos;
+		_store_state();
+
+		return id_traits_type::make(id, slot.version);
+	}
+
+	template<typename I, typename O>
+	O _insert_range(I first, I last, O out, std::input_iterator_tag) {
+		while (first != last) {
+			if (capacity() == size())
+				_reserve(_grow_size(size_type(1)));
+			*out = _emplace(*first).second;
+			++out;
+			++first;
+		}
+		return out;
+	}
+
+	// Values are copied in one go, after which their ids are linked in a single pass.
+	template<typename I, typename O>
+	O _insert_range(I first, I last, O out, std::forward_iterator_tag) {
+		const auto n = static_cast<size_type>(std::distance(first, last));
+		if (capacity() - size() < n)
+			_reserve(_grow_size(n));
+
+		auto value_pos = size();
+		values.insert(values.end(), first, last);
+		for (const auto new_size = size(); value_pos != new_size; ++value_pos) {
+			*out = _link_value(value_pos);
+			++out;
+		}
+		return out;
+	}
+
+	void _erase(size_type id_index, size_type value_pos) {
+		const auto last_pos = static_cast<size_type>(size() - 1);
+		if (value_pos != last_pos)
+			_move_value(last_pos, value_pos);
+		id_positions.pop_back();
+		values.pop_back();
+		_free_id_slot(id_index);
+	}
+
+	// Moves the value at position "from" to position "to", together with its id position,
+	// and makes its id slot point to the new position.
+	void _move_value(size_type from, size_type to) {
+		const auto pos = iterator_slot(id_positions.begin(), from);
+		iterator_slot(id_positions.begin(), to) = pos;
+		iterator_slot(id_slots.begin(), pos).value = to;
+		iterator_slot(values.begin(), to) = std::move(iterator_slot(values.begin(), from));
+	}
+
+	// Destroys all values from position "new_size" onwards.
+	void _truncate(size_type new_size) {
+		values.erase(next_iterator(values.begin(), new_size), values.end());
+		id_positions.erase(next_iterator(id_positions.begin(), new_size), id_positions.end());
+	}
+
+	// Increments the version of the id slot, and makes it the tail of the empty list.
+	void _free_id_slot(size_type id_index) {
+		++iterator_slot(id_slots.begin(), id_index).version;
+		_free_id_slots({ id_index, id_index });
+	}
+
+	// Makes the chain of id slots from "chain.first" to "chain.second" the tail of the empty list.
+	// Versions of those slots have to be incremented beforehand.
+	void _free_id_slots(const std::pair<size_type, size_type> &chain) {
+		iterator_slot(id_slots.begin(), chain.second).value = npos;
+
+		if (empty_pos.second == npos)
+			empty_pos.first = chain.first;
+		else
+			trivial_set_successor(iterator_slot(id_slots.begin(), empty_pos.second), chain.first);
+		empty_pos.second = chain.second;
+		_store_state();
+	}
+
+	// Fills the holes left by marked values below "new_size" with the values which survive above it.
+	// Ids in the range which are still valid are the ones whose values were marked. Once an id slot is freed
+	// its version changes, so duplicates and invalid ids are skipped.
+	template<typename I>
+	void _erase_marked(I first, I last, size_type new_size) {
+		auto survivor = static_cast<size_type>(size());
+		for (; first != last; ++first) {
+			const id_type id = *first;
+			if (!id_is_valid(id)) continue;
+			const auto id_index = id_traits_type::index(id);
+			const auto value_pos = iterator_slot(id_slots.begin(), id_index).value;
+			if (value_pos < new_size) {
+				do --survivor; while (iterator_slot(id_positions.begin(), survivor) == npos);
+				_move_value(survivor, value_pos);
+			}
+			_free_id_slot(id_index);
+		}
+		_truncate(new_size);
+	}
+
+	void _erase_if_finish(size_type new_size, const std::pair<size_type, size_type> &freed) {
+		_truncate(new_size);
+		if (freed.first != npos)
+			_free_id_slots(freed);
+	}
+
+
+	// One past the index of the last id slot in use.
+	size_type _filled_end() const {
+		return id_positions.empty() ? size_type(0) : static_cast<size_type>(*std::max_element(id_positions.begin(), id_positions.end()) + 1);
+	}
+
+	void _clear() {
+		if (growth_policy_type::is_over_breakoff(capacity(), size())) {
+			versioned_trivial_forward_empty_all_slots(id_slots.begin(), id_slots.end(), size_type(0), npos);
+			empty_pos.first = 0;
+			empty_pos.second = id_slots.size() - 1;
+		}
+		else if (!id_positions.empty()) {
+			if (empty_pos.second == npos)
+				empty_pos.second = id_positions.front();
+			empty_pos.first = versioned_forward_empty_filled_dense_slots(id_positions.begin(), id_positions.end(), id_slots.begin(), empty_pos.first);
+		}
+		_store_state();
+		values.clear();
+		id_positions.clear();
+		dead.reset_all();
+		nm_dead = 0;
+	}
+
+	template<typename I>
+	value_type &_get_value(I index) {
+		return iterator_slot(values.begin(), index);
+	}
+
+	template<typename I>
+	const value_type &_get_value(I index) const {
+		return iterator_slot(values.cbegin(), index);
+	}
+
+public:
+	versioned_slot_map(AllocatorType<id_slot_container_type> &&id_slots_allocator = AllocatorType<id_slot_container_type>{},
+		AllocatorType<value_container_type> &&value_allocator = AllocatorType<value_container_type>{},
+		AllocatorType<id_pos_container_type> &&id_positions_allocator = AllocatorType<id_pos_container_type>{}) :
+		id_slots(id_slots_allocator),
+		values(value_allocator),
+		id_positions(id_positions_allocator),
+		empty_pos(npos, npos),
+		dead(values.get_allocator()),
+		nm_dead(0),
+		version_floor(min_type_value<version_type>())
 	{
 
 	}
 
-	slot_map(const AllocatorType<id_slot_container_type> &id_slots_allocator,
+	versioned_slot_map(const AllocatorType<id_slot_container_type> &id_slots_allocator,
 		const AllocatorType<value_container_type> &value_allocator,
-		const AllocatorType<id_pos_container_type> &is_positions_allocator) :
+		const AllocatorType<id_pos_container_type> &id_positions_allocator) :
 		id_slots(id_slots_allocator),
 		values(value_allocator),
-		id_positions(is_positions_allocator)
+		id_positions(id_positions_allocator),
+		empty_pos(npos, npos),
+		dead(values.get_allocator()),
+		nm_dead(0),
+		version_floor(min_type_value<version_type>())
+	{
+
+	}
+
+	// All three containers allocate from copies of "alloc", rebound to their value types.
+	explicit versioned_slot_map(const A &alloc) :
+		id_slots(AllocatorType<id_slot_container_type>(alloc)),
+		values(AllocatorType<value_container_type>(alloc)),
+		id_positions(AllocatorType<id_pos_container_type>(alloc)),
+		empty_pos(npos, npos),
+		dead(values.get_allocator()),
+		nm_dead(0),
+		version_floor(min_type_value<version_type>())
+	{
+
+	}
+
+	// Takes over containers which can't be made out of an allocator, E.g. files of "mapped_containers".
+	// If they hold a map already, it's restored through "sm_restore_state". Throws std::runtime_error 
+	// if the containers don't belong to the same map.
+	versioned_slot_map(id_slot_container_type &&id_slots, value_container_type &&values, id_pos_container_type &&id_positions) :
+		id_slots(std::move(id_slots)),
+		values(std::move(values)),
+		id_positions(std::move(id_positions)),
+		empty_pos(npos, npos),
+		dead(this->values.get_allocator()),
+		nm_dead(0),
+		version_floor(min_type_value<version_type>())
+	{
+		if (this->values.size() != this->id_positions.size() || this->values.size() > this->id_slots.size())
+			throw std::runtime_error("rea::versioned_slot_map: containers don't belong to the same map");
+		if (!this->id_slots.empty())
+			sm_restore_state(this->id_slots, empty_pos, version_floor);
+		_store_state();
+	}
+
+#ifdef REA_HAS_PMR
+	// E.g. rea::pmr::versioned_slot_map<T> sm(&arena)
+	// Only exists if "A" can be made out of a memory resource, E.g. std::pmr::polymorphic_allocator.
+	template<typename R,
+		typename = typename std::enable_if<std::is_convertible<R*, std::pmr::memory_resource*>::value &&
+			std::is_constructible<A, std::pmr::memory_resource*>::value>::type>
+	explicit versioned_slot_map(R *resource) :
+		versioned_slot_map(A(static_cast<std::pmr::memory_resource*>(resource)))
 	{
 
 	}
 
+#endif
+	template<typename I>
+	// I models InputIterator
+	versioned_slot_map(I first, I last) :
+		versioned_slot_map()
+	{
+		insert_range(first, last);
+	}
 
 	value_type& id_value(id_type id) {
-		return _get_value(iterator_slot(id_slots.begin(), id).value);
+		return _get_value(iterator_slot(id_slots.begin(), id_traits_type::index(id)).value);
 	}
 
 	const value_type& id_value(id_type id) const {
-		return _get_value(iterator_slot(id_slots.cbegin(), id).value);
+		return _get_value(iterator_slot(id_slots.cbegin(), id_traits_type::index(id)).value);
 	}
 
-	constexpr static void reset_version_counts() {
-
+	void reset_version_counts() {
+		versioned_reset(id_slots.begin(), id_slots.end());
+		version_floor = min_type_value<version_type>();
+		_store_state();
 	}
 
 	void clear_and_reset_version_counts() {
-		clear();
+		version_floor = min_type_value<version_type>();
+		versioned_trivial_forward_empty_and_reset_all_slots(id_slots.begin(), id_slots.end(), size_type(0), npos);
+		empty_pos.first = 0;
+		empty_pos.second = id_slots.size() - 1;
+		_store_state();
+		values.clear();
+		id_positions.clear();
+		dead.reset_all();
+		nm_dead = 0;
 	}
 
-	constexpr static bool id_is_valid(id_type id) {
-		return true;
+	// Id slots released by "shrink_to_fit" may be referenced by old ids, so the index is checked first.
+	bool id_is_valid(id_type id) const {
+		const auto index = id_traits_type::index(id);
+		return index < id_slots.size() && id_traits_type::has_version(id, iterator_slot(id_slots.cbegin(), index).version);
 	}
 
 	size_type size() const {
 		return values.size();
 	}
 
+	// Values which fit without growth. Some containers, E.g. "reserved_array", have more room for values than there
+	// are id slots, in which case the id slots are the limit.
 	size_type capacity() const {
-		return values.capacity();
+		return (std::min)(static_cast<size_type>(values.capacity()), static_cast<size_type>(id_slots.size()));
+	}
+
+	// Largest size, bounded by both the value container and the ids.
+	size_type max_size() const {
+		const auto n = values.max_size();
+		return static_cast<std::uintmax_t>(n) < static_cast<std::uintmax_t>(id_traits_type::max_size()) ? 
+			static_cast<size_type>(n) : id_traits_type::max_size();
 	}
 
 	void reserve(size_type s) {
 		if (s > capacity()) _reserve(s);
 	}
 
+	// Reallocates values and their id positions to fit, which invalidates all iterators. Trailing id slots
+	// which are all empty are released too, and removed from the list of empty id slots.
+	// Versions of released id slots are remembered, so that ids of values which used to be linked to them
+	// don't become valid again once those slots are reused.
+	void shrink_to_fit() {
+		values.shrink_to_fit();
+		id_positions.shrink_to_fit();
+		dead.resize(capacity());
+		const auto new_size = (std::max)(_filled_end(), static_cast<size_type>(values.capacity()));
+		if (new_size < id_slots.size()) {
+			empty_pos = trivial_forward_unlink_slots_from(id_slots.begin(), empty_pos, new_size, npos);
+			version_floor = versioned_max_version(next_iterator(id_slots.begin(), new_size), id_slots.end(), version_floor);
+			id_slots.erase(next_iterator(id_slots.cbegin(), new_size), id_slots.cend());
+			_store_state();
+		}
+		id_slots.shrink_to_fit();
+	}
+
 	std::pair<iterator, id_type> insert(const value_type &v) {
 		if (capacity() == size())
-			_reserve(grow_size(size()));
-		return _insert(v);
+			_reserve(_grow_size(size_type(1)));
+		return _emplace(v);
 	}
 
 	std::pair<iterator, id_type> insert(value_type &&v) {
 		if (capacity() == size())
-			_reserve(grow_size(size()));
-		return _insert(std::move(v));
+			_reserve(_grow_size(size_type(1)));
+		return _emplace(std::move(v));
+	}
+
+	// Constructs the value in place, at the end of the value container.
+	template<typename... Args>
+	std::pair<iterator, id_type> emplace(Args&&... args) {
+		if (capacity() == size())
+			_reserve(_grow_size(size_type(1)));
+		return _emplace(std::forward<Args>(args)...);
+	}
+
+	// Inserts all values from the range, and writes their ids to "out", in the order of values.
+	// If the range models ForwardRange, capacity is increased at most once.
+	template<typename I, typename O>
+	// I models InputIterator
+	// O models OutputIterator
+	O insert_range(I first, I last, O out) {
+		return _insert_range(first, last, out, IteratorCategory<I>{});
+	}
+
+	template<typename I>
+	// I models InputIterator
+	void insert_range(I first, I last) {
+		insert_range(first, last, discard_iterator{});
 	}
 
 	void erase(id_type id) {
-		return _erase(id, iterator_slot(id_slots.begin(), id).value);
+		commit();
+		const auto id_index = id_traits_type::index(id);
+		return _erase(id_index, iterator_slot(id_slots.begin(), id_index).value);
+	}
+
+	// Erases values of all ids in the range, and returns their number. Values are first marked as erased,
+	// after which the survivors are compacted in one pass, so each value is moved at most once.
+	// Invalid and duplicate ids are skipped.
+	template<typename I>
+	// I models ForwardIterator
+	// ValueType<I> == id_type
+	size_type erase_many(I first, I last) {
+		commit();
+		size_type erased = 0;
+		for (auto it = first; it != last; ++it) {
+			const id_type id = *it;
+			if (!id_is_valid(id)) continue;
+			auto &position = iterator_slot(id_positions.begin(), iterator_slot(id_slots.begin(), id_traits_type::index(id)).value);
+			if (position == npos) continue;
+			position = npos;
+			++erased;
+		}
+		_erase_marked(first, last, static_cast<size_type>(size() - erased));
+		return erased;
+	}
+
+	// Erases all values which satisfy the predicate, and returns their number.
+	// Values are traversed once, and the remaining ones are compacted in place just like "std::remove_if" does,
+	// so their relative order is preserved. Freed id slots are chained during traversal, and linked to the empty list at once.
+	// If the predicate throws, values which weren't tested yet are kept.
+	template<typename P>
+	// P models UnaryPredicate : bool operator()(const value_type &);
+	size_type erase_if(P pred) {
+		commit();
+		const auto old_size = static_cast<size_type>(size());
+		std::pair<size_type, size_type> freed{ npos, npos };
+		size_type kept = 0;
+		size_type pos = 0;
+		try {
+			for (; pos != old_size; ++pos) {
+				if (pred(static_cast<const value_type&>(iterator_slot(values.begin(), pos)))) {
+					const auto id_index = iterator_slot(id_positions.begin(), pos);
+					++iterator_slot(id_slots.begin(), id_index).version;
+					if (freed.first == npos)
+						freed.first = id_index;
+					else
+						trivial_set_successor(iterator_slot(id_slots.begin(), freed.second), id_index);
+					freed.second = id_index;
+				}
+				else {
+					if (kept != pos)
+						_move_value(pos, kept);
+					++kept;
+				}
+			}
+		}
+		catch (...) {
+			for (; pos != old_size; ++pos, ++kept)
+				if (kept != pos)
+					_move_value(pos, kept);
+			_erase_if_finish(kept, freed);
+			throw;
+		}
+		_erase_if_finish(kept, freed);
+		return static_cast<size_type>(old_size - kept);
+	}
+
+	// Reorders values so that the value at position "first[i]" moves to position "i", for every position "i".
+	// Id positions move together with their values, and each id slot is updated as soon as its value lands,
+	// so ids stay valid. Values are moved along the cycles of the permutation, so each one is moved once,
+	// plus once more per cycle. The range must be a permutation of [0, size()), and no erasure may be deferred.
+	template<typename I>
+	// I models RandomAccessIterator
+	// ValueType<I> models Integral
+	void apply_permutation(I first) {
+		const auto n = static_cast<size_type>(size());
+		std::vector<bool, AllocatorRebindType<A, bool>> placed(n, false, AllocatorRebindType<A, bool>(values.get_allocator()));
+		for (size_type i = 0; i != n; ++i) {
+			if (placed[i]) continue;
+			auto value = std::move(iterator_slot(values.begin(), i));
+			const auto id_index = iterator_slot(id_positions.begin(), i);
+			auto to = i;
+			for (auto from = static_cast<size_type>(iterator_slot(first, to)); from != i; from = static_cast<size_type>(iterator_slot(first, to))) {
+				_move_value(from, to);
+				placed[to] = true;
+				to = from;
+			}
+			iterator_slot(values.begin(), to) = std::move(value);
+			iterator_slot(id_positions.begin(), to) = id_index;
+			iterator_slot(id_slots.begin(), id_index).value = to;
+			placed[to] = true;
+		}
+	}
+
+	// Sorts values with "comp", while keeping ids valid. Pending deferred erasures are committed first.
+	// Positions are sorted first, after which values are moved into place with "apply_permutation".
+	// Scratch memory of both comes from the allocator of the map.
+	template<typename C>
+	// C models StrictWeakOrdering : bool operator()(const value_type&, const value_type&)
+	void sort(C comp) {
+		commit();
+		std::vector<size_type, AllocatorRebindType<A, size_type>> order(size(), size_type(0), AllocatorRebindType<A, size_type>(values.get_allocator()));
+		for (size_type i = 0; i != static_cast<size_type>(order.size()); ++i)
+			order[i] = i;
+		std::sort(order.begin(), order.end(), [this, &comp](size_type a, size_type b) {
+			return comp(static_cast<const value_type&>(_get_value(a)), static_cast<const value_type&>(_get_value(b)));
+		});
+		apply_permutation(order.cbegin());
+	}
+
+	void sort() {
+		sort(std::less<value_type>{});
+	}
+
+	// Marks the value of the id as dead, instead of moving the last value into its place.
+	// The version of the id slot changes at once, so the id stops being valid, but the value stays where it is,
+	// so iteration which is under way isn't disturbed. The value is destroyed by the next "commit".
+	// Any other erasure commits pending ones first. Returns false if the id isn't valid, which includes ids whose 
+	// values are already dead, in which case nothing changes.
+	bool defer_erase(id_type id) {
+		if (!id_is_valid(id)) return false;
+		const auto id_index = id_traits_type::index(id);
+		++iterator_slot(id_slots.begin(), id_index).version;
+		if (!dead.is_enabled())
+			dead.enable(capacity());
+		dead.set(iterator_slot(id_slots.begin(), id_index).value);
+		++nm_dead;
+		return true;
+	}
+
+	// Erases all values marked by "defer_erase", and returns their number. Values are compacted in a single pass
+	// which starts at the first dead one, so the relative order of the remaining values is preserved.
+	size_type commit() {
+		if (nm_dead == size_type(0)) return 0;
+		const auto old_size = static_cast<size_type>(size());
+		std::pair<size_type, size_type> freed{ npos, npos };
+		auto kept = static_cast<size_type>(dead.find_next_set(0));
+		for (auto pos = kept; pos != old_size; ++pos) {
+			if (dead.test(pos)) {
+				const auto id_index = iterator_slot(id_positions.begin(), pos);
+				if (freed.first == npos)
+					freed.first = id_index;
+				else
+					trivial_set_successor(iterator_slot(id_slots.begin(), freed.second), id_index);
+				freed.second = id_index;
+			}
+			else {
+				_move_value(pos, kept);
+				++kept;
+			}
+		}
+		_erase_if_finish(kept, freed);
+		dead.reset_all();
+		const auto erased = nm_dead;
+		nm_dead = 0;
+		return erased;
+	}
+
+	// Number of values marked by "defer_erase" since the last commit.
+	size_type deferred_size() const {
+		return nm_dead;
+	}
+
+	// True if the value was marked by "defer_erase", and isn't erased yet.
+	bool is_dead(const_iterator it) const {
+		return nm_dead != size_type(0) && dead.test(iterator_distance<const_iterator, std::size_t>(cbegin(), it));
+	}
+
+	// Calls "f" with every value which isn't dead, in the order of values.
+	template<typename F>
+	// F models UnaryProcedure : void operator()(value_type&)
+	F for_each(F f) {
+		if (nm_dead == size_type(0)) {
+			for (auto &v : *this) f(v);
+			return f;
+		}
+		dead.for_each_clear(size(), [this, &f](std::size_t pos) { f(_get_value(pos)); });
+		return f;
+	}
+
+	template<typename F>
+	// F models UnaryProcedure : void operator()(const value_type&)
+	F for_each(F f) const {
+		if (nm_dead == size_type(0)) {
+			for (auto &v : *this) f(v);
+			return f;
+		}
+		dead.for_each_clear(size(), [this, &f](std::size_t pos) { f(_get_value(pos)); });
+		return f;
 	}
 
 	iterator erase(iterator it) {
-		const auto value_pos = iterator_distance<size_type>(begin(), it);
+		if (nm_dead != size_type(0)) {
+			const auto id_index = iterator_slot(id_positions.begin(), iterator_distance<iterator, size_type>(begin(), it));
+			commit();
+			it = next_iterator(begin(), iterator_slot(id_slots.begin(), id_index).value);
+		}
+		const auto value_pos = iterator_distance<iterator, size_type>(begin(), it);
 		if (it == end()) {
 			_erase(iterator_slot(id_positions.begin(), value_pos), value_pos);
 			return end();
@@ -1632,7 +6652,12 @@ public:
 	}
 
 	const_iterator erase(const_iterator it) {
-		const auto value_pos = iterator_distance<size_type>(cbegin(), it);
+		if (nm_dead != size_type(0)) {
+			const auto id_index = iterator_slot(id_positions.begin(), iterator_distance<const_iterator, size_type>(cbegin(), it));
+			commit();
+			it = next_iterator(cbegin(), iterator_slot(id_slots.begin(), id_index).value);
+		}
+		const auto value_pos = iterator_distance<const_iterator, size_type>(cbegin(), it);
 		if (it == cend()) {
 			_erase(iterator_slot(id_positions.begin(), value_pos), value_pos);
 			return cend();
@@ -1644,67 +6669,451 @@ public:
 	}
 
 	void clear() {
-		_clear();
+		_clear();
+	}
+
+	bool empty() const {
+		return values.empty();
+	}
+
+	iterator begin() {
+		return values.begin();
+	}
+
+	const_iterator cbegin() const {
+		return values.cbegin();
+	}
+
+	const_iterator begin() const {
+		return cbegin();
+	}
+
+	reverse_iterator rbegin() {
+		return values.rbegin();
+	}
+
+	const_reverse_iterator crbegin() const {
+		return values.crbegin();
+	}
+
+	const_reverse_iterator rbegin() const {
+		return crbegin();
+	}
+
+	iterator end() {
+		return values.end();
+	}
+
+	const_iterator cend() const {
+		return values.cend();
+	}
+
+	const_iterator end() const {
+		return cend();
+	}
+
+	reverse_iterator rend() {
+		return values.rend();
+	}
+
+	const_reverse_iterator crend() const {
+		return values.crend();
+	}
+
+	const_reverse_iterator rend() const {
+		return crend();
+	}
+
+	iterator iterator_of_id(id_type id) {
+		return next_iterator(begin(), iterator_slot(id_slots.begin(), id_traits_type::index(id)).value);
+	}
+
+	const_iterator const_iterator_of_id(id_type id) const {
+		return next_iterator(cbegin(), iterator_slot(id_slots.cbegin(), id_traits_type::index(id)).value);
+	}
+
+	const_iterator iterator_of_id(id_type id) const {
+		return const_iterator_of_id(id);
+	}
+
+	id_type id_of_iterator(const_iterator it) const {
+		const auto slot_index = iterator_slot(id_positions.cbegin(), iterator_distance(values.cbegin(), it));
+		return id_traits_type::make(slot_index, iterator_slot(id_slots.cbegin(), slot_index).version);
+	}
+
+	id_type id_of_iterator(iterator it) const {
+		return id_of_iterator(const_iterator{ it });
+	}
+
+	// Containers which hold the map, E.g. for flushing files of "mapped_containers".
+	const id_slot_container_type& id_slot_container() const {
+		return id_slots;
+	}
+
+	const value_container_type& value_container() const {
+		return values;
+	}
+
+	const id_pos_container_type& id_pos_container() const {
+		return id_positions;
+	}
+
+
+	// Writes the id slots, the values, their id positions, the list of empty id slots, the versions and the erasures
+	// deferred by "defer_erase", so that "load" restores the same ids. Values are written in one block
+	// if they are bitwise.
+	template<typename O>
+	// O models BinaryOutputStream
+	void save(O &os) const {
+		snapshot_write_header(os, snapshot_kind::versioned_slot_map, sizeof(size_type), sizeof(version_type), sizeof(value_type));
+		snapshot_write(os, static_cast<std::uint64_t>(capacity()));
+		snapshot_write_container(os, id_slots);
+		snapshot_write_container(os, values);
+		snapshot_write_container(os, id_positions);
+		snapshot_write(os, empty_pos);
+		snapshot_write(os, version_floor);
+		snapshot_write(os, nm_dead);
+		dead.save(os);
+	}
+
+	// Replaces the contents with a snapshot written by "save", and reserves the same capacity. Returns false
+	// if the stream fails or holds a snapshot of some other container, in which case this one is left empty.
+	template<typename I>
+	// I models BinaryInputStream
+	bool load(I &is) {
+		std::uint64_t cap = 0;
+		if (snapshot_read_header(is, snapshot_kind::versioned_slot_map, sizeof(size_type), sizeof(version_type), sizeof(value_type)) &&
+			snapshot_read(is, cap) && cap <= values.max_size()) {
+			values.clear();
+			id_positions.clear();
+			values.reserve(static_cast<size_type>(cap));
+			id_positions.reserve(static_cast<size_type>(cap));
+			if (snapshot_read_container(is, id_slots) && snapshot_read_container(is, values) && snapshot_read_container(is, id_positions) &&
+				snapshot_read(is, empty_pos) && snapshot_read(is, version_floor) && snapshot_read(is, nm_dead) && dead.load(is)) {
+				dead.resize(capacity());
+				_store_state();
+				return true;
+			}
+		}
+		id_slots.clear();
+		values.clear();
+		id_positions.clear();
+		empty_pos = std::pair<size_type, size_type>(npos, npos);
+		version_floor = min_type_value<version_type>();
+		_store_state();
+		dead.disable();
+		nm_dead = size_type(0);
+		return false;
+	}
+};
+
+template<typename T, typename S, typename V, typename A, typename G, typename Containers>
+constexpr typename versioned_slot_map<T, S, V, A, G, Containers>::size_type versioned_slot_map<T, S, V, A, G, Containers>::npos;
+
+
+
+//**************************************************************************************************
+// stable_slot_map keeps its values in the order of insertion, even across erasures. It's built on top
+// of "versioned_slot_map", whose deferred erasure leaves a tombstone in place of the erased value.
+// Once tombstones outnumber the values, all of them are removed in a single pass which shifts the
+// remaining values towards the front, so each erasure costs amortized constant time. Room left by
+// tombstones is also reclaimed before the values would have to grow.
+//
+// Lookup goes through the id slots, just like in "versioned_slot_map". Iterators skip tombstones,
+// so iteration stays contiguous apart from the holes which haven't been compacted yet.
+// Iterators are invalidated by insertion and erasure.
+//**************************************************************************************************
+
+template<typename M, typename I>
+// M models VersionedSlotMap or const VersionedSlotMap
+// I models RandomAccessIterator of M
+class stable_slot_map_iterator {
+public:
+	using iterator_category = std::bidirectional_iterator_tag;
+	using value_type = IteratorValueType<I>;
+	using difference_type = IteratorDifferenceType<I>;
+	using reference = IteratorReferenceType<I>;
+	using pointer = typename std::iterator_traits<I>::pointer;
+
+private:
+	template<typename N, typename J>
+	friend class stable_slot_map_iterator;
+
+	template<typename U, typename S, typename V, typename A, typename G>
+	friend class stable_slot_map;
+
+	M *map;
+	I it;
+	I last;
+
+	void _skip_forward() {
+		if (map->deferred_size() != 0)
+			while (it != last && map->is_dead(it)) ++it;
+	}
+
+public:
+	stable_slot_map_iterator() : map(nullptr), it(), last() {}
+
+	stable_slot_map_iterator(M &map, I it) : map(std::addressof(map)), it(it), last(map.end()) {
+		_skip_forward();
+	}
+
+	template<typename N, typename J,
+		typename = typename std::enable_if<std::is_convertible<N*, M*>::value && std::is_convertible<J, I>::value>::type>
+	stable_slot_map_iterator(const stable_slot_map_iterator<N, J> &other) : map(other.map), it(other.it), last(other.last) {}
+
+	reference operator*() const { return *it; }
+	pointer operator->() const { return std::addressof(*it); }
+
+	stable_slot_map_iterator& operator++() {
+		++it;
+		_skip_forward();
+		return *this;
+	}
+
+	stable_slot_map_iterator operator++(int) { auto tmp = *this; ++*this; return tmp; }
+
+	stable_slot_map_iterator& operator--() {
+		do --it; while (map->is_dead(it));
+		return *this;
+	}
+
+	stable_slot_map_iterator operator--(int) { auto tmp = *this; --*this; return tmp; }
+
+	template<typename N, typename J>
+	bool operator==(const stable_slot_map_iterator<N, J> &other) const { return it == other.it; }
+	template<typename N, typename J>
+	bool operator!=(const stable_slot_map_iterator<N, J> &other) const { return it != other.it; }
+};
+
+template<typename T,
+	typename S = default_size_type,
+	typename V = default_version_type,
+	typename A = default_allocator_type<T>,
+	typename G = default_growth_policy>
+class stable_slot_map {
+public:
+	using value_type = T;
+	using size_type = S;
+	using growth_policy_type = G;
+	using map_type = versioned_slot_map<T, S, V, A, G>;
+	using id_traits_type = typename map_type::id_traits_type;
+	using version_type = typename map_type::version_type;
+	using id_type = typename map_type::id_type;
+
+	using iterator = stable_slot_map_iterator<map_type, typename map_type::iterator>;
+	using const_iterator = stable_slot_map_iterator<const map_type, typename map_type::const_iterator>;
+
+private:
+	map_type map;
+
+	// Tombstones are removed once they outnumber the values.
+	bool _should_compact() const {
+		return map.deferred_size() > map.size() - map.deferred_size();
+	}
+
+	// Room taken by tombstones is reclaimed before values grow.
+	void _make_room(size_type n) {
+		if (map.deferred_size() != size_type(0) && map.capacity() - map.size() < n)
+			map.commit();
+	}
+
+public:
+	stable_slot_map() = default;
+
+	explicit stable_slot_map(const A &alloc) : map(alloc) {}
+
+#ifdef REA_HAS_PMR
+	template<typename R,
+		typename = typename std::enable_if<std::is_convertible<R*, std::pmr::memory_resource*>::value &&
+			std::is_constructible<A, std::pmr::memory_resource*>::value>::type>
+	explicit stable_slot_map(R *resource) : map(resource) {}
+#endif
+
+	template<typename I>
+	// I models InputIterator
+	stable_slot_map(I first, I last) {
+		insert_range(first, last);
+	}
+
+	value_type& id_value(id_type id) {
+		return map.id_value(id);
+	}
+
+	const value_type& id_value(id_type id) const {
+		return map.id_value(id);
+	}
+
+	bool id_is_valid(id_type id) const {
+		return map.id_is_valid(id);
+	}
+
+	// Number of values, tombstones excluded.
+	size_type size() const {
+		return static_cast<size_type>(map.size() - map.deferred_size());
+	}
+
+	bool empty() const {
+		return size() == size_type(0);
+	}
+
+	size_type capacity() const {
+		return map.capacity();
+	}
+
+	// Number of tombstones which weren't compacted yet.
+	size_type tombstones() const {
+		return map.deferred_size();
+	}
+
+	void reserve(size_type s) {
+		map.reserve(s);
+	}
+
+	// Removes all tombstones, after which values are contiguous.
+	void compact() {
+		map.commit();
+	}
+
+	// Sorts values with "comp", while keeping ids valid. Tombstones are compacted first.
+	template<typename C>
+	// C models StrictWeakOrdering : bool operator()(const value_type&, const value_type&)
+	void sort(C comp) {
+		map.sort(comp);
+	}
+
+	void sort() {
+		map.sort();
+	}
+
+	void shrink_to_fit() {
+		map.commit();
+		map.shrink_to_fit();
+	}
+
+	// Tombstones are kept in the snapshot, so values keep their order.
+	template<typename O>
+	// O models BinaryOutputStream
+	void save(O &os) const {
+		map.save(os);
+	}
+
+	template<typename I>
+	// I models BinaryInputStream
+	bool load(I &is) {
+		return map.load(is);
+	}
+
+	std::pair<iterator, id_type> insert(const value_type &v) {
+		return emplace(v);
+	}
+
+	std::pair<iterator, id_type> insert(value_type &&v) {
+		return emplace(std::move(v));
+	}
+
+	// Constructs the value in place, after all others.
+	template<typename... Args>
+	std::pair<iterator, id_type> emplace(Args&&... args) {
+		_make_room(1);
+		const auto r = map.emplace(std::forward<Args>(args)...);
+		return{ iterator(map, r.first), r.second };
+	}
+
+	// Inserts all values from the range, after all others, and writes their ids to "out" in the same order.
+	template<typename I, typename O>
+	// I models InputIterator
+	// O models OutputIterator
+	O insert_range(I first, I last, O out) {
+		_make_room(_range_size(first, last, IteratorCategory<I>{}));
+		return map.insert_range(first, last, out);
+	}
+
+	template<typename I>
+	// I models InputIterator
+	void insert_range(I first, I last) {
+		insert_range(first, last, discard_iterator{});
+	}
+
+	// Leaves a tombstone in place of the value, so the order of the others is kept.
+	// All iterators are invalidated if tombstones get compacted.
+	void erase(id_type id) {
+		map.defer_erase(id);
+		if (_should_compact()) map.commit();
+	}
+
+	// Returns the iterator to the value after the erased one.
+	iterator erase(const_iterator it) {
+		auto next = it;
+		++next;
+		const auto next_id = next.it != map.cend() ? map.id_of_iterator(next.it) : id_traits_type::end();
+		erase(map.id_of_iterator(it.it));
+		return id_traits_type::is_end(next_id) ? end() : iterator_of_id(next_id);
+	}
+
+	// Erases all values which satisfy the predicate, and returns their number. Tombstones are compacted together
+	// with erased values in a single pass, which preserves the order of the remaining values.
+	template<typename P>
+	// P models UnaryPredicate : bool operator()(const value_type &);
+	size_type erase_if(P pred) {
+		size_type erased = 0;
+		for (auto it = map.cbegin(); it != map.cend(); ++it) {
+			if (!map.is_dead(it) && pred(*it)) {
+				map.defer_erase(map.id_of_iterator(it));
+				++erased;
+			}
+		}
+		map.commit();
+		return erased;
+	}
+
+	void clear() {
+		map.clear();
 	}
 
-	bool empty() const {
-		return values.empty();
+	// Calls "f" with every value, in the order of insertion.
+	template<typename F>
+	// F models UnaryProcedure : void operator()(value_type&)
+	F for_each(F f) {
+		return map.for_each(f);
+	}
+
+	template<typename F>
+	// F models UnaryProcedure : void operator()(const value_type&)
+	F for_each(F f) const {
+		return map.for_each(f);
 	}
 
 	iterator begin() {
-		return values.begin();
+		return iterator(map, map.begin());
 	}
 
 	const_iterator cbegin() const {
-		return values.cbegin();
+		return const_iterator(map, map.cbegin());
 	}
 
 	const_iterator begin() const {
 		return cbegin();
 	}
 
-	reverse_iterator rbegin() {
-		return values.rbegin();
-	}
-
-	const_reverse_iterator crbegin() const {
-		return values.crbegin();
-	}
-
-	const_reverse_iterator rbegin() const {
-		return crbegin();
-	}
-
 	iterator end() {
-		return values.end();
+		return iterator(map, map.end());
 	}
 
 	const_iterator cend() const {
-		return values.cend();
+		return const_iterator(map, map.cend());
 	}
 
 	const_iterator end() const {
 		return cend();
 	}
 
-	iterator rend() {
-		return values.rend();
-	}
-
-	const_reverse_iterator crend() const {
-		return values.crend();
-	}
-
-	const_reverse_iterator rend() const {
-		return crend();
-	}
-
 	iterator iterator_of_id(id_type id) {
-		return next_iterator(values.begin(), iterator_slot(id_slots.begin(), id).value);
+		return iterator(map, map.iterator_of_id(id));
 	}
 
 	const_iterator const_iterator_of_id(id_type id) const {
-		return next_iterator(values.cbegin(), iterator_slot(id_slots.cbegin(), id).value);
+		return const_iterator(map, map.const_iterator_of_id(id));
 	}
 
 	const_iterator iterator_of_id(id_type id) const {
@@ -1712,60 +7121,136 @@ public:
 	}
 
 	id_type id_of_iterator(const_iterator it) const {
-		return iterator_slot(id_positions.cbegin(), iterator_distance(values.cbegin(), it));
+		return map.id_of_iterator(it.it);
 	}
 
-	id_type id_of_iterator(iterator it) const {
-		return iterator_slot(id_positions.cbegin(), iterator_distance(values.cbegin(), it));
+private:
+	template<typename I>
+	static size_type _range_size(I first, I last, std::forward_iterator_tag) {
+		return static_cast<size_type>(std::distance(first, last));
 	}
 
+	template<typename I>
+	static size_type _range_size(I, I, std::input_iterator_tag) {
+		return 1;
+	}
 };
 
 
 
-template<typename T,
-	typename S = default_size_type,
-	typename V = default_version_type,
-	typename A = default_allocator_type<T>>
-class versioned_slot_map {
+// Compile time list of indices 0, 1, ..., N - 1, used to expand a pack of columns.
+template<std::size_t... Is>
+struct index_pack {};
+
+template<std::size_t N, std::size_t... Is>
+struct make_index_pack_obj : make_index_pack_obj<N - 1, N - 1, Is...> {};
+
+template<std::size_t... Is>
+struct make_index_pack_obj<0, Is...> {
+	using type = index_pack<Is...>;
+};
+
+template<std::size_t N>
+using make_index_pack = typename make_index_pack_obj<N>::type;
+
+// Evaluates each of its arguments, used to run an expression once per element of a pack.
+struct expand_pack_obj {
+	template<typename... Args>
+	expand_pack_obj(Args&&...) {}
+};
+
+
+
+//**************************************************************************************************
+// soa_slot_map stores each field of its values in a dense column of its own, instead of storing
+// whole structs in a single array. All columns share one set of id slots and id positions, so a
+// single id addresses a value in every column, and erasure moves the last value into the hole
+// in all columns at once. Passes which touch only some of the fields read only their columns,
+// and each column is a plain contiguous array, so its raw pointer can be handed to SIMD kernels.
+// Ids are versioned, just like those of "versioned_slot_map".
+//**************************************************************************************************
+
+template<typename S, typename V, typename A, typename G, typename... Ts>
+// S models Integral
+// A models Allocator, which is rebound for each column
+// G models GrowthPolicy
+// Ts model SemiRegular
+class basic_soa_slot_map {
+	static_assert(sizeof...(Ts) > 0, "soa_slot_map needs at least one column");
+
 public:
-	using value_type = T;
 	using size_type = S;
-	using version_type = V;
-	using id_type = std::pair<size_type, version_type>;
+	using growth_policy_type = G;
+	using id_traits_type = IdTraits<size_type, V>;
+	using version_type = VersionType<id_traits_type>;
+	using id_type = typename id_traits_type::id_type;
 
 	using slot_type = sm_versioned_slot_type<size_type, version_type>;
 	using id_slot_container_type = sm_id_slot_container_type<slot_type, A>;
-	using value_container_type = sm_value_container_type<value_type, A>;
 	using id_pos_container_type = sm_id_pos_container_type<size_type, A>;
 
-	using difference_type = typename value_container_type::difference_type;
-	using iterator = typename value_container_type::iterator;
-	using const_iterator = typename value_container_type::const_iterator;
-	using reverse_iterator = typename value_container_type::reverse_iterator;
-	using const_reverse_iterator = typename value_container_type::const_reverse_iterator;
+	template<std::size_t N>
+	using column_type = typename std::tuple_element<N, std::tuple<Ts...>>::type;
+
+	template<std::size_t N>
+	using column_container_type = sm_value_container_type<column_type<N>, AllocatorRebindType<A, column_type<N>>>;
+
+	static constexpr std::size_t column_count = sizeof...(Ts);
 
 private:
-	static constexpr auto npos = max_type_value<size_type>();
+	static constexpr size_type npos = max_type_value<size_type>();
+
+	using columns_indices = make_index_pack<sizeof...(Ts)>;
 
-	value_container_type values;
 	id_slot_container_type id_slots;
+	std::tuple<sm_value_container_type<Ts, AllocatorRebindType<A, Ts>>...> columns;
 	id_pos_container_type id_positions;
 	std::pair<size_type, size_type> empty_pos;
 
+	template<std::size_t... Is>
+	void _reserve_columns(size_type s, index_pack<Is...>) {
+		expand_pack_obj{ (std::get<Is>(columns).reserve(s), 0)... };
+	}
+
+	template<std::size_t... Is, typename... Us>
+	void _push_back_columns(index_pack<Is...>, Us&&... vs) {
+		expand_pack_obj{ (std::get<Is>(columns).push_back(std::forward<Us>(vs)), 0)... };
+	}
+
+	template<std::size_t... Is>
+	void _move_columns(size_type from, size_type to, index_pack<Is...>) {
+		expand_pack_obj{ (iterator_slot(std::get<Is>(columns).begin(), to) = std::move(iterator_slot(std::get<Is>(columns).begin(), from)), 0)... };
+	}
+
+	template<std::size_t... Is>
+	void _truncate_columns(size_type new_size, index_pack<Is...>) {
+		expand_pack_obj{ (std::get<Is>(columns).erase(next_iterator(std::get<Is>(columns).begin(), new_size), std::get<Is>(columns).end()), 0)... };
+	}
+
+	template<std::size_t... Is>
+	void _clear_columns(index_pack<Is...>) {
+		expand_pack_obj{ (std::get<Is>(columns).clear(), 0)... };
+	}
+
+	template<std::size_t... Is>
+	void _shrink_columns(index_pack<Is...>) {
+		expand_pack_obj{ (std::get<Is>(columns).shrink_to_fit(), 0)... };
+	}
+
 	void _reserve(size_type s) {
+		check_id_max_size(s, id_traits_type::max_size());
 		const auto prev_size = static_cast<size_type>(id_slots.size());
-		id_slots.resize(s);
-		empty_pos = trivial_forward_empty_all_slots_with_meta(id_slots.begin(), prev_size, id_slots.end(), empty_pos, npos);
+		if (s > prev_size) {
+			id_slots.resize(s);
+			empty_pos = trivial_forward_empty_all_slots_with_meta(id_slots.begin(), prev_size, id_slots.end(), empty_pos, npos);
+		}
 
-		values.reserve(s);
+		_reserve_columns(s, columns_indices{});
 		id_positions.reserve(s);
 	}
 
-	template<typename U>
-	std::pair<iterator, id_type> _insert(U&& v) {
-		const auto value_pos = values.size();
-		values.push_back(std::forward<U>(v));
+	// Takes the id slot from the head of the empty list, and makes it point to the value at "value_pos".
+	id_type _link_value(size_type value_pos) {
 		id_positions.push_back(empty_pos.first);
 
 		const auto id = empty_pos.first;
@@ -1780,232 +7265,174 @@ private:
 		}
 		slot.value = value_pos;
 
-		return{ values.end() - 1, id_type{ id, slot.version } };
+		return id_traits_type::make(id, slot.version);
 	}
 
-	void _erase(size_type id_index, size_type value_pos) {
-		const auto last_pos = static_cast<size_type>(size() - 1);
-		if (value_pos != last_pos) {
-			const auto pos = iterator_slot(id_positions.begin(), last_pos);
-			iterator_slot(id_positions.begin(), value_pos) = pos;
-			iterator_slot(id_slots.begin(), pos).value = value_pos;
-			iterator_slot(values.begin(), value_pos) = std::move(iterator_slot(values.begin(), last_pos));
-		}
-		id_positions.pop_back();
-		values.pop_back();
+	// Increments the version of the id slot, and makes it the tail of the empty list.
+	void _free_id_slot(size_type id_index) {
 		auto &slot = iterator_slot(id_slots.begin(), id_index);
-		slot.value = npos;
 		++slot.version;
-
-		if (empty_pos.second == npos) {
+		slot.value = npos;
+		if (empty_pos.second == npos)
 			empty_pos.first = id_index;
-			empty_pos.second = id_index;
-		}
-		else {
+		else
 			trivial_set_successor(iterator_slot(id_slots.begin(), empty_pos.second), id_index);
-			empty_pos.second = id_index;
-		}
-	}
-
-
-	void _clear() {
-		if (is_over_breakoff(capacity(), size())) {
-			versioned_trivial_forward_empty_all_slots(id_slots.begin(), id_slots.end(), size_type(0), npos);
-			empty_pos.first = 0;
-			empty_pos.second = id_slots.size() - 1;
-		}
-		else {
-			empty_pos.first = versioned_forward_empty_filled_dense_slots(id_positions.begin(), id_positions.end(), id_slots.begin(), empty_pos.first);
-		}
-		values.clear();
-		id_positions.clear();
-	}
-
-	template<typename I>
-	value_type &_get_value(I index) {
-		return iterator_slot(values.begin(), index);
+		empty_pos.second = id_index;
 	}
 
-	template<typename I>
-	const value_type &_get_value(I index) const {
-		return iterator_slot(values.cbegin(), index);
+	size_type _position(id_type id) const {
+		return iterator_slot(id_slots.cbegin(), id_traits_type::index(id)).value;
 	}
 
 public:
-	versioned_slot_map(AllocatorType<id_slot_container_type> &&id_slots_allocator = AllocatorType<id_slot_container_type>{},
-		AllocatorType<value_container_type> &&value_allocator = AllocatorType<value_container_type>{},
-		AllocatorType<id_pos_container_type> &&id_positions_allocator = AllocatorType<id_pos_container_type>{}) :
-		id_slots(id_slots_allocator),
-		values(value_allocator),
-		id_positions(id_positions_allocator)
+	basic_soa_slot_map(const A &alloc = A{}) :
+		id_slots(AllocatorType<id_slot_container_type>(alloc)),
+		columns(sm_value_container_type<Ts, AllocatorRebindType<A, Ts>>(AllocatorRebindType<A, Ts>(alloc))...),
+		id_positions(AllocatorType<id_pos_container_type>(alloc)),
+		empty_pos(npos, npos)
 	{
 
 	}
 
-	versioned_slot_map(const AllocatorType<id_slot_container_type> &id_slots_allocator,
-		const AllocatorType<value_container_type> &value_allocator,
-		const AllocatorType<id_pos_container_type> &id_positions_allocator) :
-		id_slots(id_slots_allocator),
-		values(value_allocator),
-		id_positions(id_positions_allocator)
-	{
-
-	}
-
-	value_type& id_value(id_type id) {
-		return _get_value(iterator_slot(id_slots.begin(), id.first).value);
-	}
-
-	const value_type& id_value(id_type id) const {
-		return _get_value(iterator_slot(id_slots.cbegin(), id.first).value);
+	// Inserts one value per column, in the order of columns, and returns the id which addresses all of them.
+	// If any column throws, values already added to the other columns are removed.
+	template<typename... Us>
+	id_type insert(Us&&... vs) {
+		static_assert(sizeof...(Us) == sizeof...(Ts), "soa_slot_map::insert takes one value per column");
+		if (capacity() == size())
+			_reserve(grow_size_within<growth_policy_type>(id_traits_type::max_size(), size(), size_type(1), sizeof(std::tuple<Ts...>)));
+		const auto value_pos = size();
+		try {
+			_push_back_columns(columns_indices{}, std::forward<Us>(vs)...);
+		}
+		catch (...) {
+			_truncate_columns(value_pos, columns_indices{});
+			throw;
+		}
+		return _link_value(value_pos);
 	}
 
-	void reset_version_counts() {
-		versioned_reset(id_slots.begin(), id_slots.end());
+	// Moves the last value of every column into the hole left by the erased one.
+	void erase(id_type id) {
+		const auto id_index = id_traits_type::index(id);
+		const auto value_pos = iterator_slot(id_slots.begin(), id_index).value;
+		const auto last_pos = static_cast<size_type>(size() - 1);
+		if (value_pos != last_pos) {
+			_move_columns(last_pos, value_pos, columns_indices{});
+			const auto moved = iterator_slot(id_positions.begin(), last_pos);
+			iterator_slot(id_positions.begin(), value_pos) = moved;
+			iterator_slot(id_slots.begin(), moved).value = value_pos;
+		}
+		_truncate_columns(last_pos, columns_indices{});
+		id_positions.pop_back();
+		_free_id_slot(id_index);
 	}
 
-	void clear_and_reset_version_counts() {
-		versioned_trivial_forward_empty_and_reset_all_slots(id_slots.begin(), id_slots.end(), size_type(0), npos);
-		empty_pos.first = 0;
-		empty_pos.second = id_slots.size() - 1;
-		values.clear();
+	void clear() {
+		if (!id_positions.empty()) {
+			if (empty_pos.second == npos)
+				empty_pos.second = id_positions.front();
+			empty_pos.first = versioned_forward_empty_filled_dense_slots(id_positions.begin(), id_positions.end(), id_slots.begin(), empty_pos.first);
+		}
+		_clear_columns(columns_indices{});
 		id_positions.clear();
 	}
 
-	bool id_is_valid(id_type id) {
-		return id.second == iterator_slot(id_slots.cbegin(), id.first).version;
-		return true;
-	}
-
-	size_type size() const {
-		return values.size();
-	}
-
-	size_type capacity() const {
-		return values.capacity();
+	bool id_is_valid(id_type id) const {
+		const auto index = id_traits_type::index(id);
+		return index < id_slots.size() && id_traits_type::has_version(id, iterator_slot(id_slots.cbegin(), index).version);
 	}
 
-	void reserve(size_type s) {
-		if (s > capacity()) _reserve(s);
+	// Field of column "N" of the value of the id.
+	template<std::size_t N>
+	column_type<N>& id_value(id_type id) {
+		return iterator_slot(std::get<N>(columns).begin(), _position(id));
 	}
 
-	std::pair<iterator, id_type> insert(const value_type &v) {
-		if (capacity() == size())
-			_reserve(grow_size(size()));
-		return _insert(v);
+	template<std::size_t N>
+	const column_type<N>& id_value(id_type id) const {
+		return iterator_slot(std::get<N>(columns).cbegin(), _position(id));
 	}
 
-	std::pair<iterator, id_type> insert(value_type &&v) {
-		if (capacity() == size())
-			_reserve(grow_size(size()));
-		return _insert(std::move(v));
+	// Position of the value of the id within every column.
+	size_type position_of_id(id_type id) const {
+		return _position(id);
 	}
 
-	void erase(id_type id) {
-		return _erase(id.first, iterator_slot(id_slots.begin(), id.first).value);
+	id_type id_of_position(size_type pos) const {
+		const auto slot_index = iterator_slot(id_positions.cbegin(), pos);
+		return id_traits_type::make(slot_index, iterator_slot(id_slots.cbegin(), slot_index).version);
 	}
 
-	iterator erase(iterator it) {
-		const auto value_pos = iterator_distance<size_type>(begin(), it);
-		if (it == end()) {
-			_erase(iterator_slot(id_positions.begin(), value_pos), value_pos);
-			return end();
-		}
-		else {
-			_erase(iterator_slot(id_positions.begin(), value_pos), value_pos);
-			return it;
-		}
+	// Contiguous array of column "N", which holds "size()" fields. Invalidated by insertion and erasure.
+	template<std::size_t N>
+	column_type<N>* data() {
+		return std::get<N>(columns).data();
 	}
 
-	const_iterator erase(const_iterator it) {
-		const auto value_pos = iterator_distance<size_type>(cbegin(), it);
-		if (it == cend()) {
-			_erase(iterator_slot(id_positions.begin(), value_pos), value_pos);
-			return cend();
-		}
-		else {
-			_erase(iterator_slot(id_positions.begin(), value_pos), value_pos);
-			return it;
-		}
+	template<std::size_t N>
+	const column_type<N>* data() const {
+		return std::get<N>(columns).data();
 	}
 
-	void clear() {
-		_clear();
+	size_type size() const {
+		return static_cast<size_type>(id_positions.size());
 	}
 
 	bool empty() const {
-		return values.empty();
-	}
-
-	iterator begin() {
-		return values.begin();
-	}
-
-	const_iterator cbegin() const {
-		return values.cbegin();
-	}
-
-	const_iterator begin() const {
-		return cbegin();
-	}
-
-	reverse_iterator rbegin() {
-		return values.rbegin();
+		return id_positions.empty();
 	}
 
-	const_reverse_iterator crbegin() const {
-		return values.crbegin();
+	size_type capacity() const {
+		return static_cast<size_type>(id_positions.capacity());
 	}
 
-	const_reverse_iterator rbegin() const {
-		return crbegin();
+	void reserve(size_type s) {
+		if (s > capacity()) _reserve(s);
 	}
 
-	iterator end() {
-		return values.end();
+	// Reallocates all columns and id positions to fit. Id slots are kept, as old ids may still refer to them.
+	void shrink_to_fit() {
+		_shrink_columns(columns_indices{});
+		id_positions.shrink_to_fit();
 	}
+};
 
-	const_iterator cend() const {
-		return values.cend();
-	}
+template<typename S, typename V, typename A, typename G, typename... Ts>
+constexpr typename basic_soa_slot_map<S, V, A, G, Ts...>::size_type basic_soa_slot_map<S, V, A, G, Ts...>::npos;
+template<typename S, typename V, typename A, typename G, typename... Ts>
+constexpr std::size_t basic_soa_slot_map<S, V, A, G, Ts...>::column_count;
 
-	const_iterator end() const {
-		return cend();
-	}
+template<typename... Ts>
+using soa_slot_map = basic_soa_slot_map<default_size_type, default_version_type, default_allocator_type<char>, default_growth_policy, Ts...>;
 
-	iterator rend() {
-		return values.rend();
-	}
+#ifdef REA_HAS_PMR
+// Containers which allocate through std::pmr::polymorphic_allocator, so that each one may be given 
+// its own std::pmr::memory_resource, E.g. an "arena_resource".
+namespace pmr {
 
-	const_reverse_iterator crend() const {
-		return values.crend();
-	}
+template<typename T>
+using slot_list = rea::slot_list<T, default_size_type, std::pmr::polymorphic_allocator<T>>;
 
-	const_reverse_iterator rend() const {
-		return crend();
-	}
+template<typename T, typename V = default_version_type>
+using versioned_slot_list = rea::versioned_slot_list<T, V, default_size_type, std::pmr::polymorphic_allocator<T>>;
 
-	iterator iterator_of_id(id_type id) {
-		return next_iterator(begin(), iterator_slot(id_slots.begin(), id).value);
-	}
+template<typename T>
+using split_slot_list = rea::split_slot_list<T, default_size_type, std::pmr::polymorphic_allocator<T>>;
 
-	const_iterator const_iterator_of_id(id_type id) const {
-		return next_iterator(cbegin(), iterator_slot(id_slots.cbegin(), id).value);
-	}
+template<typename T, typename V = default_version_type>
+using versioned_split_slot_list = rea::versioned_split_slot_list<T, V, default_size_type, std::pmr::polymorphic_allocator<T>>;
 
-	const_iterator iterator_of_id(id_type id) const {
-		return const_iterator_of_id(id);
-	}
+template<typename T>
+using slot_map = rea::slot_map<T, default_size_type, std::pmr::polymorphic_allocator<T>>;
 
-	id_type id_of_iterator(const_iterator it) const {
-		const auto slot_index = iterator_slot(id_positions.cbegin(), iterator_distance(values.cbegin(), it));
-		return id_type{ slot_index, iterator_slot(id_slots.cbegin(), slot_index).version };
-	}
+template<typename T, typename V = default_version_type>
+using versioned_slot_map = rea::versioned_slot_map<T, default_size_type, V, std::pmr::polymorphic_allocator<T>>;
 
-	id_type id_of_iterator(iterator it) const {
-		return id_of_iterator(const_iterator{ it });
-	}
+template<typename T, typename V = default_version_type>
+using stable_slot_map = rea::stable_slot_map<T, default_size_type, V, std::pmr::polymorphic_allocator<T>>;
 
-};
+} // namespace pmr
+#endif
 
 } // namespace rea
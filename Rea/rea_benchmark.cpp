@@ -0,0 +1,900 @@
+#include "rea.h"
+#include "rea_concurrent.h"
+#if defined(__unix__) || defined(__APPLE__)
+#include "rea_mapped.h"
+#define REA_BENCHMARK_MAPPED 1
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <list>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+//**************************************************************************************************
+// Benchmark suite for all containers of "rea.h", and for std::vector, std::unordered_map
+// and std::list baselines.
+//
+// Every case is a (container, value size, element count, erase pattern) tuple, for which the
+// following operations are timed :
+// - insert          : "count" insertions into an empty container(no reserve, so growth is included)
+// - lookup          : "count" id_value calls
+// - id_is_valid     : "count" id_is_valid calls
+// - iterate         : one full pass over all values
+// - erase           : "count / 2" erasures
+// - iterate_churned : one full pass over the values which remained after erasure
+// - reinsert        : "count / 2" insertions which reuse erased slots
+// - clear           : one clear() call
+// - insert_range    : "count" values inserted into an empty container with a single bulk call
+// - insert_worst    : the slowest of "count" insertions into an empty container, each timed on its own,
+//                     which shows the pauses caused by growth
+//
+// Erase pattern "sequential" visits ids in insertion order, "random" visits them shuffled.
+// The same order is used for lookup and id_is_valid.
+//
+// Concurrent containers are timed separately, for each thread count given by "--threads".
+// Every thread works on its own share of "count" values :
+// - concurrent_insert : "count" insertions in total
+// - concurrent_lookup : "count" lookups in total
+// - concurrent_erase  : "count" erasures in total
+//
+// Parallel algorithms of versioned_slot_map run on a thread pool of each of those sizes :
+// - parallel_for_each         : one pass which updates every value
+// - parallel_transform_reduce : one pass which sums keys of all values
+//
+// Results are written as JSON, either to stdout or to the file given by "--output".
+// Run with "--help" for the list of options.
+//**************************************************************************************************
+
+
+namespace {
+
+template<std::size_t N>
+// N is a multiple of sizeof(std::uint64_t)
+struct payload {
+	std::uint64_t data[N / sizeof(std::uint64_t)];
+
+	payload() : data() {}
+	explicit payload(std::uint64_t v) {
+		std::fill(std::begin(data), std::end(data), v);
+	}
+};
+
+static_assert(sizeof(payload<8>) == 8, "payload must not be padded");
+static_assert(sizeof(payload<64>) == 64, "payload must not be padded");
+
+template<std::size_t N>
+inline
+std::uint64_t payload_key(const payload<N> &v) {
+	return v.data[0];
+}
+
+
+
+//**************************************************************************************************
+// Adapters give all benchmarked containers the same interface :
+// - id_type insert(value_type)
+// - void erase(id_type)
+// - const value_type& value(id_type)
+// - bool is_valid(id_type)
+// - void for_each(F)
+// - void clear()
+// - void insert_range(I, I)
+//**************************************************************************************************
+
+template<typename SL>
+// SL models SlotList
+struct slot_list_adapter {
+	using value_type = rea::ValueType<SL>;
+	using id_type = typename SL::id_type;
+
+	SL c;
+
+	id_type insert(value_type v) { return c.insert(std::move(v)); }
+	void erase(id_type id) { c.erase(id); }
+	const value_type& value(id_type id) const { return c.id_value(id); }
+	bool is_valid(id_type id) const { return c.id_is_valid(id); }
+	void clear() { c.clear(); }
+
+	template<typename I>
+	void insert_range(I first, I last) { c.insert_range(first, last); }
+
+	template<typename F>
+	void for_each(F f) const {
+		for (const auto &v : c)
+			f(v);
+	}
+};
+
+// Same as slot_list_adapter, but iterates in slot order through the occupancy bitmap.
+template<typename SL>
+// SL models SlotList
+struct slot_list_bitmap_adapter : slot_list_adapter<SL> {
+	slot_list_bitmap_adapter() { this->c.enable_occupancy_bitmap(); }
+
+	template<typename F>
+	void for_each(F f) const { this->c.for_each(f); }
+};
+
+template<typename SM>
+// SM models SlotMap
+struct slot_map_adapter {
+	using value_type = rea::ValueType<SM>;
+	using id_type = typename SM::id_type;
+
+	SM c;
+
+	id_type insert(value_type v) { return c.insert(std::move(v)).second; }
+	void erase(id_type id) { c.erase(id); }
+	const value_type& value(id_type id) const { return c.id_value(id); }
+	bool is_valid(id_type id) const { return c.id_is_valid(id); }
+	void clear() { c.clear(); }
+
+	template<typename I>
+	void insert_range(I first, I last) { c.insert_range(first, last); }
+
+	template<typename F>
+	void for_each(F f) const {
+		for (auto it = c.cbegin(); it != c.cend(); ++it)
+			f(*it);
+	}
+};
+
+// Dense array with swap-and-pop erasure. Ids are positions, which are not stable across erasures,
+// so this is the lower bound of what a dense container can do, not a drop-in replacement.
+template<typename T>
+struct vector_adapter {
+	using value_type = T;
+	using id_type = std::size_t;
+
+	std::vector<T> c;
+
+	id_type insert(value_type v) {
+		c.push_back(std::move(v));
+		return c.size() - 1;
+	}
+	void erase(id_type id) {
+		c[id % c.size()] = std::move(c.back());
+		c.pop_back();
+	}
+	const value_type& value(id_type id) const { return c[id]; }
+	bool is_valid(id_type id) const { return id < c.size(); }
+	void clear() { c.clear(); }
+
+	template<typename I>
+	void insert_range(I first, I last) { c.insert(c.end(), first, last); }
+
+	template<typename F>
+	void for_each(F f) const {
+		for (const auto &v : c)
+			f(v);
+	}
+};
+
+template<typename T>
+struct unordered_map_adapter {
+	using value_type = T;
+	using id_type = std::uint64_t;
+
+	std::unordered_map<std::uint64_t, T> c;
+	std::uint64_t next_key = 0;
+
+	id_type insert(value_type v) {
+		c.emplace(next_key, std::move(v));
+		return next_key++;
+	}
+	void erase(id_type id) { c.erase(id); }
+	const value_type& value(id_type id) const { return c.find(id)->second; }
+	bool is_valid(id_type id) const { return c.find(id) != c.end(); }
+	void clear() { c.clear(); }
+
+	template<typename I>
+	void insert_range(I first, I last) {
+		c.reserve(c.size() + static_cast<std::size_t>(std::distance(first, last)));
+		for (; first != last; ++first)
+			c.emplace(next_key++, *first);
+	}
+
+	template<typename F>
+	void for_each(F f) const {
+		for (const auto &kv : c)
+			f(kv.second);
+	}
+};
+
+template<typename T>
+struct list_adapter {
+	using value_type = T;
+	using id_type = typename std::list<T>::iterator;
+
+	std::list<T> c;
+
+	id_type insert(value_type v) { return c.insert(c.end(), std::move(v)); }
+	void erase(id_type id) { c.erase(id); }
+	const value_type& value(id_type id) const { return *id; }
+	bool is_valid(id_type) const { return true; }
+	void clear() { c.clear(); }
+
+	template<typename I>
+	void insert_range(I first, I last) { c.insert(c.end(), first, last); }
+
+	template<typename F>
+	void for_each(F f) const {
+		for (const auto &v : c)
+			f(v);
+	}
+};
+
+#ifdef REA_BENCHMARK_MAPPED
+// Each instance maps its own files in the temporary directory, which are removed when it's destroyed.
+template<typename T>
+struct mapped_slot_map_adapter {
+	using value_type = T;
+	using map_type = rea::mapped_slot_map<T>;
+	using id_type = typename map_type::id_type;
+
+	std::string path;
+	map_type c;
+
+	static std::string unique_path() {
+		static std::atomic<unsigned> next{ 0 };
+		const char *dir = std::getenv("TMPDIR");
+		return std::string(dir != nullptr ? dir : "/tmp") + "/rea_benchmark_" + std::to_string(::getpid()) + "_" + std::to_string(next++);
+	}
+
+	mapped_slot_map_adapter() : path(unique_path()), c(path) {}
+
+	~mapped_slot_map_adapter() {
+		for (auto suffix : { ".ids", ".values", ".positions" })
+			std::remove((path + suffix).c_str());
+	}
+
+	id_type insert(value_type v) { return c.insert(v).second; }
+	void erase(id_type id) { c.erase(id); }
+	const value_type& value(id_type id) const { return c.id_value(id); }
+	bool is_valid(id_type id) const { return c.id_is_valid(id); }
+	void clear() { c.clear(); }
+
+	template<typename I>
+	void insert_range(I first, I last) {
+		c.reserve(static_cast<typename map_type::size_type>(c.size() + std::distance(first, last)));
+		for (; first != last; ++first)
+			c.insert(*first);
+	}
+
+	template<typename F>
+	void for_each(F f) const {
+		for (const auto &v : c)
+			f(v);
+	}
+};
+
+// Reserves address space for 2^27 values, which covers counts up to 100M.
+template<typename T>
+struct reserved_slot_map_adapter {
+	using value_type = T;
+	using map_type = rea::reserved_slot_map<T>;
+	using id_type = typename map_type::id_type;
+
+	map_type c;
+
+	reserved_slot_map_adapter() : c(typename map_type::size_type(1) << 27) {}
+
+	id_type insert(value_type v) { return c.insert(std::move(v)).second; }
+	void erase(id_type id) { c.erase(id); }
+	const value_type& value(id_type id) const { return c.id_value(id); }
+	bool is_valid(id_type id) const { return c.id_is_valid(id); }
+	void clear() { c.clear(); }
+
+	template<typename I>
+	void insert_range(I first, I last) {
+		c.reserve(static_cast<typename map_type::size_type>(c.size() + std::distance(first, last)));
+		for (; first != last; ++first)
+			c.insert(*first);
+	}
+
+	template<typename F>
+	void for_each(F f) const {
+		for (const auto &v : c)
+			f(v);
+	}
+};
+#endif
+
+
+
+//**************************************************************************************************
+// Concurrent adapters are called from many threads at once, except for reserve :
+// - void reserve(std::size_t)
+// - id_type insert(value_type)
+// - std::uint64_t lookup(id_type)
+// - void erase(id_type)
+//**************************************************************************************************
+
+template<typename T>
+// T models SemiRegular
+struct locked_map_adapter {
+	using value_type = T;
+	using id_type = typename rea::versioned_slot_map<T>::id_type;
+
+	std::mutex mutex;
+	rea::versioned_slot_map<T> c;
+
+	void reserve(std::size_t n) { c.reserve(n); }
+	id_type insert(value_type v) {
+		std::lock_guard<std::mutex> lock(mutex);
+		return c.insert(std::move(v)).second;
+	}
+	std::uint64_t lookup(id_type id) {
+		std::lock_guard<std::mutex> lock(mutex);
+		return payload_key(c.id_value(id));
+	}
+	void erase(id_type id) {
+		std::lock_guard<std::mutex> lock(mutex);
+		c.erase(id);
+	}
+};
+
+template<typename T>
+// T models SemiRegular
+struct concurrent_map_adapter {
+	using value_type = T;
+	using id_type = typename rea::concurrent_slot_map<T>::id_type;
+
+	rea::concurrent_slot_map<T> c;
+
+	void reserve(std::size_t n) { c.reserve(n); }
+	id_type insert(value_type v) { return c.insert(std::move(v)); }
+	std::uint64_t lookup(id_type id) {
+		std::uint64_t key = 0;
+		c.visit(id, [&key](const value_type &v) { key = payload_key(v); });
+		return key;
+	}
+	void erase(id_type id) { c.erase(id); }
+};
+
+// Inserts and lookups are lock free, erasures are serialized by a lock.
+template<typename T>
+// T models SemiRegular
+struct concurrent_insert_map_adapter {
+	using value_type = T;
+	using id_type = typename rea::concurrent_insert_slot_map<T>::id_type;
+
+	std::mutex mutex;
+	rea::concurrent_insert_slot_map<T> c;
+
+	void reserve(std::size_t n) { c.reserve(n); }
+	id_type insert(value_type v) { return c.try_insert(std::move(v)); }
+	std::uint64_t lookup(id_type id) { return payload_key(c.id_value(id)); }
+	void erase(id_type id) {
+		std::lock_guard<std::mutex> lock(mutex);
+		c.erase(id);
+	}
+};
+
+
+
+struct options {
+	std::vector<std::size_t> counts;
+	std::vector<std::size_t> value_sizes;
+	std::vector<std::string> containers;
+	std::vector<std::string> patterns;
+	std::vector<std::size_t> threads;
+	std::size_t repeat;
+	std::size_t max_bytes;
+	unsigned seed;
+	std::string output;
+
+	options() :
+		counts{ 1000, 10000, 100000, 1000000 },
+		value_sizes{ 8, 64, 256 },
+		patterns{ "sequential", "random" },
+		threads{ 1, rea::default_concurrency() },
+		repeat(3),
+		max_bytes(std::size_t(8) << 30),
+		seed(5489u)
+	{}
+
+	bool has_container(const std::string &name) const {
+		return containers.empty() || std::find(containers.begin(), containers.end(), name) != containers.end();
+	}
+};
+
+struct result {
+	std::string container;
+	std::size_t value_size;
+	std::size_t count;
+	std::string pattern;
+	std::string operation;
+	std::size_t operations;
+	double seconds;
+	std::size_t threads;
+};
+
+// Keeps the optimizer from discarding lookups and iteration.
+volatile std::uint64_t sink;
+
+using benchmark_clock = std::chrono::steady_clock;
+
+inline
+double seconds_since(benchmark_clock::time_point start) {
+	return std::chrono::duration<double>(benchmark_clock::now() - start).count();
+}
+
+
+
+struct timings {
+	static constexpr std::size_t nm_operations = 10;
+	static const char *const names[nm_operations];
+
+	double seconds[nm_operations];
+
+	timings() {
+		std::fill(std::begin(seconds), std::end(seconds), std::numeric_limits<double>::max());
+	}
+
+	void record(std::size_t op, double s) {
+		seconds[op] = (std::min)(seconds[op], s);
+	}
+};
+
+const char *const timings::names[timings::nm_operations] = {
+	"insert", "lookup", "id_is_valid", "iterate", "erase", "iterate_churned", "reinsert", "clear", "insert_range", "insert_worst"
+};
+
+template<typename B>
+// B models BenchmarkAdapter
+void run_once(const std::vector<std::size_t> &order, timings &t) {
+	using value_type = typename B::value_type;
+	const auto count = order.size();
+	const auto half = count / 2;
+
+	B b;
+	std::vector<typename B::id_type> ids;
+	ids.reserve(count);
+	std::uint64_t sum = 0;
+
+	auto start = benchmark_clock::now();
+	for (std::size_t i = 0; i < count; ++i)
+		ids.push_back(b.insert(value_type{ i }));
+	t.record(0, seconds_since(start));
+
+	start = benchmark_clock::now();
+	for (auto i : order)
+		sum += payload_key(b.value(ids[i]));
+	t.record(1, seconds_since(start));
+
+	start = benchmark_clock::now();
+	for (auto i : order)
+		sum += b.is_valid(ids[i]);
+	t.record(2, seconds_since(start));
+
+	start = benchmark_clock::now();
+	b.for_each([&sum](const value_type &v) { sum += payload_key(v); });
+	t.record(3, seconds_since(start));
+
+	start = benchmark_clock::now();
+	for (std::size_t i = 0; i < half; ++i)
+		b.erase(ids[order[i]]);
+	t.record(4, seconds_since(start));
+
+	start = benchmark_clock::now();
+	b.for_each([&sum](const value_type &v) { sum += payload_key(v); });
+	t.record(5, seconds_since(start));
+
+	start = benchmark_clock::now();
+	for (std::size_t i = 0; i < half; ++i)
+		sum += b.is_valid(b.insert(value_type{ i }));
+	t.record(6, seconds_since(start));
+
+	start = benchmark_clock::now();
+	b.clear();
+	t.record(7, seconds_since(start));
+
+	{
+		std::vector<value_type> source;
+		source.reserve(count);
+		for (std::size_t i = 0; i < count; ++i)
+			source.push_back(value_type{ i });
+
+		B bulk;
+		start = benchmark_clock::now();
+		bulk.insert_range(source.cbegin(), source.cend());
+		t.record(8, seconds_since(start));
+		if (!ids.empty()) sum += bulk.is_valid(ids.front());
+	}
+
+	{
+		B timed;
+		double worst = 0;
+		for (std::size_t i = 0; i < count; ++i) {
+			start = benchmark_clock::now();
+			const auto id = timed.insert(value_type{ i });
+			worst = (std::max)(worst, seconds_since(start));
+			sum += timed.is_valid(id);
+		}
+		t.record(9, worst);
+	}
+
+	sink = sink + sum;
+}
+
+template<typename B>
+// B models BenchmarkAdapter
+void run_container(const char *name, const options &opts, std::vector<result> &results) {
+	using value_type = typename B::value_type;
+	if (!opts.has_container(name)) return;
+
+	for (auto count : opts.counts) {
+		// Rough per-element footprint : value, id kept by the benchmark and a few words of bookkeeping.
+		if (count * (sizeof(value_type) + sizeof(typename B::id_type) + 4 * sizeof(std::size_t)) > opts.max_bytes) {
+			std::cerr << "skipping " << name << " value_size=" << sizeof(value_type) << " count=" << count
+				<< " (exceeds --max-bytes)" << std::endl;
+			continue;
+		}
+
+		for (const auto &pattern : opts.patterns) {
+			std::vector<std::size_t> order(count);
+			std::iota(order.begin(), order.end(), std::size_t(0));
+			if (pattern == "random") {
+				std::mt19937_64 generator(opts.seed);
+				std::shuffle(order.begin(), order.end(), generator);
+			}
+
+			timings t;
+			for (std::size_t r = 0; r < opts.repeat; ++r)
+				run_once<B>(order, t);
+
+			const std::size_t operations[timings::nm_operations] = {
+				count, count, count, count, count / 2, count - count / 2, count / 2, 1, count, 1
+			};
+			for (std::size_t op = 0; op < timings::nm_operations; ++op)
+				results.push_back(result{ name, sizeof(value_type), count, pattern, timings::names[op], operations[op], t.seconds[op], 1 });
+
+			std::cerr << name << " value_size=" << sizeof(value_type) << " count=" << count << " pattern=" << pattern << " done" << std::endl;
+		}
+	}
+}
+
+const char *const concurrent_operation_names[3] = { "concurrent_insert", "concurrent_lookup", "concurrent_erase" };
+
+template<typename B>
+// B models ConcurrentBenchmarkAdapter
+void run_concurrent_once(std::size_t count, std::size_t threads, bool shuffle, unsigned seed, double seconds[3]) {
+	using value_type = typename B::value_type;
+	B b;
+	std::vector<std::vector<typename B::id_type>> ids(threads);
+	std::atomic<std::uint64_t> sum{ 0 };
+	b.reserve(count);
+
+	// Thread "t" works on values [t * count / threads, (t + 1) * count / threads).
+	auto start = benchmark_clock::now();
+	rea::parallel_for_index(threads, threads, [&](std::size_t t) {
+		const auto first = t * count / threads, last = (t + 1) * count / threads;
+		ids[t].reserve(last - first);
+		for (auto i = first; i != last; ++i)
+			ids[t].push_back(b.insert(value_type{ i }));
+		if (shuffle) {
+			std::mt19937_64 generator(seed + t);
+			std::shuffle(ids[t].begin(), ids[t].end(), generator);
+		}
+	});
+	seconds[0] = (std::min)(seconds[0], seconds_since(start));
+
+	start = benchmark_clock::now();
+	rea::parallel_for_index(threads, threads, [&](std::size_t t) {
+		std::uint64_t local = 0;
+		for (auto id : ids[t])
+			local += b.lookup(id);
+		sum += local;
+	});
+	seconds[1] = (std::min)(seconds[1], seconds_since(start));
+
+	start = benchmark_clock::now();
+	rea::parallel_for_index(threads, threads, [&](std::size_t t) {
+		for (auto id : ids[t])
+			b.erase(id);
+	});
+	seconds[2] = (std::min)(seconds[2], seconds_since(start));
+
+	sink = sink + sum.load();
+}
+
+template<typename B>
+// B models ConcurrentBenchmarkAdapter
+void run_concurrent(const char *name, const options &opts, std::vector<result> &results) {
+	using value_type = typename B::value_type;
+	if (!opts.has_container(name)) return;
+
+	for (auto count : opts.counts) {
+		if (count * (sizeof(value_type) + sizeof(typename B::id_type) + 4 * sizeof(std::size_t)) > opts.max_bytes) {
+			std::cerr << "skipping " << name << " value_size=" << sizeof(value_type) << " count=" << count
+				<< " (exceeds --max-bytes)" << std::endl;
+			continue;
+		}
+
+		for (const auto &pattern : opts.patterns) {
+			for (auto threads : opts.threads) {
+				double seconds[3];
+				std::fill(std::begin(seconds), std::end(seconds), std::numeric_limits<double>::max());
+				for (std::size_t r = 0; r < opts.repeat; ++r)
+					run_concurrent_once<B>(count, threads, pattern == "random", opts.seed, seconds);
+
+				for (std::size_t op = 0; op < 3; ++op)
+					results.push_back(result{ name, sizeof(value_type), count, pattern, concurrent_operation_names[op], count, seconds[op], threads });
+
+				std::cerr << name << " value_size=" << sizeof(value_type) << " count=" << count << " pattern=" << pattern
+					<< " threads=" << threads << " done" << std::endl;
+			}
+		}
+	}
+}
+
+const char *const parallel_operation_names[2] = { "parallel_for_each", "parallel_transform_reduce" };
+
+template<typename T>
+// T models SemiRegular
+void run_parallel(const char *name, const options &opts, std::vector<result> &results) {
+	if (!opts.has_container(name)) return;
+
+	for (auto count : opts.counts) {
+		if (count * (sizeof(T) + 4 * sizeof(std::size_t)) > opts.max_bytes) {
+			std::cerr << "skipping " << name << " value_size=" << sizeof(T) << " count=" << count
+				<< " (exceeds --max-bytes)" << std::endl;
+			continue;
+		}
+
+		rea::versioned_slot_map<T> sm;
+		sm.reserve(count);
+		for (std::size_t i = 0; i < count; ++i)
+			sm.insert(T{ i });
+
+		for (auto threads : opts.threads) {
+			rea::thread_pool pool(threads);
+			double seconds[2];
+			std::fill(std::begin(seconds), std::end(seconds), std::numeric_limits<double>::max());
+			for (std::size_t r = 0; r < opts.repeat; ++r) {
+				auto start = benchmark_clock::now();
+				rea::parallel_for_each(sm, [](T &v, typename rea::versioned_slot_map<T>::id_type) { ++v.data[0]; }, pool);
+				seconds[0] = (std::min)(seconds[0], seconds_since(start));
+
+				start = benchmark_clock::now();
+				const auto sum = rea::parallel_transform_reduce(sm, std::uint64_t(0), std::plus<std::uint64_t>(),
+					[](const T &v, typename rea::versioned_slot_map<T>::id_type) { return payload_key(v); }, pool);
+				seconds[1] = (std::min)(seconds[1], seconds_since(start));
+
+				std::uint64_t expected = 0;
+				for (const auto &v : sm)
+					expected += payload_key(v);
+				if (sum != expected) {
+					std::cerr << name << " value_size=" << sizeof(T) << " count=" << count << " threads=" << threads
+						<< " : parallel sum " << sum << " differs from " << expected << std::endl;
+					std::exit(1);
+				}
+			}
+
+			for (std::size_t op = 0; op < 2; ++op)
+				results.push_back(result{ name, sizeof(T), count, "sequential", parallel_operation_names[op], count, seconds[op], threads });
+
+			std::cerr << name << " value_size=" << sizeof(T) << " count=" << count << " threads=" << threads << " done" << std::endl;
+		}
+	}
+}
+
+// 8 byte ids, with room for 2^40 - 1 slots and 2^24 versions per slot.
+using packed_id_type = rea::packed_id<std::uint64_t, 40>;
+
+template<std::size_t N>
+void run_value_size(const options &opts, std::vector<result> &results) {
+	using T = payload<N>;
+	run_container<slot_list_adapter<rea::slot_list<T>>>("slot_list", opts, results);
+	run_container<slot_list_bitmap_adapter<rea::slot_list<T>>>("slot_list_bitmap", opts, results);
+	run_container<slot_list_adapter<rea::controlled_slot_list<T>>>("controlled_slot_list", opts, results);
+	run_container<slot_list_adapter<rea::versioned_slot_list<T>>>("versioned_slot_list", opts, results);
+	run_container<slot_list_adapter<rea::versioned_slot_list<T, packed_id_type>>>("versioned_slot_list_packed", opts, results);
+	run_container<slot_list_adapter<rea::regulated_slot_list<T>>>("regulated_slot_list", opts, results);
+	run_container<slot_list_adapter<rea::split_slot_list<T>>>("split_slot_list", opts, results);
+	run_container<slot_list_bitmap_adapter<rea::split_slot_list<T>>>("split_slot_list_bitmap", opts, results);
+	run_container<slot_list_adapter<rea::versioned_split_slot_list<T>>>("versioned_split_slot_list", opts, results);
+	run_container<slot_map_adapter<rea::slot_map<T>>>("slot_map", opts, results);
+	run_container<slot_map_adapter<rea::versioned_slot_map<T>>>("versioned_slot_map", opts, results);
+	run_container<slot_map_adapter<rea::versioned_slot_map<T, std::size_t, packed_id_type>>>("versioned_slot_map_packed", opts, results);
+	run_container<slot_map_adapter<rea::versioned_slot_map<T, std::size_t, rea::default_version_type, rea::default_allocator_type<T>, rea::large_growth_policy>>>("versioned_slot_map_large_growth", opts, results);
+	run_container<slot_map_adapter<rea::stable_slot_map<T>>>("stable_slot_map", opts, results);
+	run_container<vector_adapter<T>>("std::vector", opts, results);
+	run_container<unordered_map_adapter<T>>("std::unordered_map", opts, results);
+	run_container<list_adapter<T>>("std::list", opts, results);
+#ifdef REA_BENCHMARK_MAPPED
+	run_container<mapped_slot_map_adapter<T>>("mapped_slot_map", opts, results);
+	run_container<reserved_slot_map_adapter<T>>("reserved_slot_map", opts, results);
+#endif
+	run_concurrent<concurrent_map_adapter<T>>("concurrent_slot_map", opts, results);
+	run_concurrent<concurrent_insert_map_adapter<T>>("concurrent_insert_slot_map", opts, results);
+	run_concurrent<locked_map_adapter<T>>("locked_versioned_slot_map", opts, results);
+	run_parallel<T>("parallel_versioned_slot_map", opts, results);
+}
+
+bool run_value_size(std::size_t value_size, const options &opts, std::vector<result> &results) {
+	switch (value_size) {
+	case 8: run_value_size<8>(opts, results); return true;
+	case 16: run_value_size<16>(opts, results); return true;
+	case 64: run_value_size<64>(opts, results); return true;
+	case 256: run_value_size<256>(opts, results); return true;
+	case 1024: run_value_size<1024>(opts, results); return true;
+	default: return false;
+	}
+}
+
+
+
+std::string json_escape(const std::string &s) {
+	std::string escaped;
+	for (auto c : s) {
+		if (c == '"' || c == '\\') escaped += '\\';
+		escaped += c;
+	}
+	return escaped;
+}
+
+void write_json(std::ostream &os, const options &opts, const std::vector<result> &results) {
+	os << "{\n";
+	os << "  \"schema_version\": 2,\n";
+#if defined(__VERSION__)
+	os << "  \"compiler\": \"" << json_escape(__VERSION__) << "\",\n";
+#endif
+	os << "  \"repeat\": " << opts.repeat << ",\n";
+	os << "  \"seed\": " << opts.seed << ",\n";
+	os << "  \"results\": [";
+	for (std::size_t i = 0; i < results.size(); ++i) {
+		const auto &r = results[i];
+		const auto ns_per_op = r.operations ? r.seconds * 1e9 / static_cast<double>(r.operations) : 0.0;
+		os << (i ? ",\n" : "\n")
+			<< "    {\"container\": \"" << json_escape(r.container) << "\""
+			<< ", \"value_size\": " << r.value_size
+			<< ", \"count\": " << r.count
+			<< ", \"pattern\": \"" << r.pattern << "\""
+			<< ", \"operation\": \"" << r.operation << "\""
+			<< ", \"threads\": " << r.threads
+			<< ", \"operations\": " << r.operations
+			<< ", \"seconds\": " << r.seconds
+			<< ", \"ns_per_op\": " << ns_per_op << "}";
+	}
+	os << "\n  ]\n}\n";
+}
+
+
+
+template<typename F>
+void split_list(const std::string &list, F f) {
+	std::stringstream ss(list);
+	std::string item;
+	while (std::getline(ss, item, ','))
+		if (!item.empty()) f(item);
+}
+
+std::vector<std::size_t> parse_sizes(const std::string &list) {
+	std::vector<std::size_t> sizes;
+	split_list(list, [&sizes](const std::string &item) { sizes.push_back(std::strtoull(item.c_str(), nullptr, 10)); });
+	return sizes;
+}
+
+std::vector<std::string> parse_names(const std::string &list) {
+	std::vector<std::string> names;
+	split_list(list, [&names](const std::string &item) { names.push_back(item); });
+	return names;
+}
+
+// Counts 1K, 10K, ... up to and including "max_count".
+std::vector<std::size_t> decade_counts(std::size_t max_count) {
+	std::vector<std::size_t> counts;
+	for (std::size_t count = 1000; count <= max_count; count *= 10)
+		counts.push_back(count);
+	return counts;
+}
+
+void print_usage() {
+	std::cout <<
+		"usage: rea_benchmark [options]\n"
+		"  --counts=N,...        element counts (default 1000,10000,100000,1000000)\n"
+		"  --max-count=N         use counts 1000, 10000, ... up to N (e.g. 100000000)\n"
+		"  --sizes=N,...         value sizes in bytes, any of 8,16,64,256,1024 (default 8,64,256)\n"
+		"  --containers=NAME,... subset of slot_list, slot_list_bitmap, controlled_slot_list,\n"
+		"                        versioned_slot_list, versioned_slot_list_packed, regulated_slot_list,\n"
+		"                        split_slot_list, split_slot_list_bitmap, versioned_split_slot_list,\n"
+		"                        slot_map, versioned_slot_map, versioned_slot_map_packed,\n"
+		"                        versioned_slot_map_large_growth, stable_slot_map,\n"
+		"                        std::vector, std::unordered_map, std::list, mapped_slot_map, reserved_slot_map,\n"
+		"                        concurrent_slot_map, concurrent_insert_slot_map, locked_versioned_slot_map,\n"
+		"                        parallel_versioned_slot_map (default all)\n"
+		"  --patterns=NAME,...   sequential and/or random (default both)\n"
+		"  --threads=N,...       thread counts of concurrent containers and parallel algorithms\n"
+		"                        (default 1 and all cores)\n"
+		"  --repeat=N            runs per case, fastest one is reported (default 3)\n"
+		"  --max-bytes=N         skip cases whose estimated footprint exceeds N (default 8GiB)\n"
+		"  --seed=N              seed of the random erase pattern\n"
+		"  --output=FILE         write JSON to FILE instead of stdout\n";
+}
+
+bool parse_option(const std::string &arg, const char *name, std::string &value) {
+	const auto length = std::strlen(name);
+	if (arg.compare(0, length, name) != 0 || arg.size() <= length || arg[length] != '=') return false;
+	value = arg.substr(length + 1);
+	return true;
+}
+
+} // namespace
+
+
+
+int main(int argc, char **argv) {
+	options opts;
+
+	for (int i = 1; i < argc; ++i) {
+		const std::string arg = argv[i];
+		std::string value;
+		if (arg == "--help" || arg == "-h") {
+			print_usage();
+			return 0;
+		}
+		else if (parse_option(arg, "--counts", value)) opts.counts = parse_sizes(value);
+		else if (parse_option(arg, "--max-count", value)) opts.counts = decade_counts(std::strtoull(value.c_str(), nullptr, 10));
+		else if (parse_option(arg, "--sizes", value)) opts.value_sizes = parse_sizes(value);
+		else if (parse_option(arg, "--containers", value)) opts.containers = parse_names(value);
+		else if (parse_option(arg, "--patterns", value)) opts.patterns = parse_names(value);
+		else if (parse_option(arg, "--threads", value)) opts.threads = parse_sizes(value);
+		else if (parse_option(arg, "--repeat", value)) opts.repeat = (std::max)(std::strtoull(value.c_str(), nullptr, 10), 1ull);
+		else if (parse_option(arg, "--max-bytes", value)) opts.max_bytes = std::strtoull(value.c_str(), nullptr, 10);
+		else if (parse_option(arg, "--seed", value)) opts.seed = static_cast<unsigned>(std::strtoul(value.c_str(), nullptr, 10));
+		else if (parse_option(arg, "--output", value)) opts.output = value;
+		else {
+			std::cerr << "unknown option " << arg << std::endl;
+			print_usage();
+			return 1;
+		}
+	}
+
+	opts.threads.erase(std::remove(opts.threads.begin(), opts.threads.end(), std::size_t(0)), opts.threads.end());
+	std::sort(opts.threads.begin(), opts.threads.end());
+	opts.threads.erase(std::unique(opts.threads.begin(), opts.threads.end()), opts.threads.end());
+
+	for (const auto &pattern : opts.patterns) {
+		if (pattern != "sequential" && pattern != "random") {
+			std::cerr << "unknown pattern " << pattern << std::endl;
+			return 1;
+		}
+	}
+
+	std::vector<result> results;
+	for (auto value_size : opts.value_sizes) {
+		if (!run_value_size(value_size, opts, results)) {
+			std::cerr << "unsupported value size " << value_size << std::endl;
+			return 1;
+		}
+	}
+
+	if (opts.output.empty()) {
+		write_json(std::cout, opts, results);
+	}
+	else {
+		std::ofstream file(opts.output);
+		if (!file) {
+			std::cerr << "can't open " << opts.output << std::endl;
+			return 1;
+		}
+		write_json(file, opts, results);
+	}
+}
@@ -0,0 +1,1281 @@
+#pragma once
+
+/*
+MIT License
+
+Copyright(c)[2018][Igor Mitrovic]
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+
+#include "rea.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+
+namespace rea {
+
+// Number of threads used by parallel algorithms, unless told otherwise.
+inline
+std::size_t default_concurrency() {
+	const auto n = std::thread::hardware_concurrency();
+	return n != 0 ? n : 1;
+}
+
+// Small number which is distinct for each thread. Threads are numbered in the order in which they first call it.
+inline
+std::size_t this_thread_ordinal() {
+	static std::atomic<std::size_t> next{ 0 };
+	static thread_local const std::size_t ordinal = next.fetch_add(1, std::memory_order_relaxed);
+	return ordinal;
+}
+
+// Size of cache lines, which data written by different threads shouldn't share.
+constexpr std::size_t cache_line_size = 64;
+
+// Fixed size array of default constructed objects, which starts at the beginning of a cache line.
+// Before C++17 "new[]" ignores the alignment of over-aligned types, so objects declared with 
+// alignas(cache_line_size) would still share cache lines with their neighbours.
+template<typename T>
+class cache_aligned_array {
+	void *storage;
+	T *objects;
+	std::size_t count;
+
+public:
+	explicit cache_aligned_array(std::size_t n) : 
+		storage(::operator new(n * sizeof(T) + cache_line_size)),
+		objects(nullptr),
+		count(0)
+	{
+		void *aligned = storage;
+		std::size_t space = n * sizeof(T) + cache_line_size;
+		objects = static_cast<T*>(std::align(cache_line_size, n * sizeof(T), aligned, space));
+		try {
+			for (; count != n; ++count)
+				::new (static_cast<void*>(objects + count)) T();
+		}
+		catch (...) {
+			while (count != 0)
+				objects[--count].~T();
+			::operator delete(storage);
+			throw;
+		}
+	}
+
+	cache_aligned_array(const cache_aligned_array&) = delete;
+	cache_aligned_array& operator=(const cache_aligned_array&) = delete;
+
+	~cache_aligned_array() {
+		while (count != 0)
+			objects[--count].~T();
+		::operator delete(storage);
+	}
+
+	T& operator[](std::size_t i) const {
+		return objects[i];
+	}
+
+	std::size_t size() const {
+		return count;
+	}
+};
+
+// Atomic which takes whole cache lines of its own, so threads which hammer it don't slow down access to its neighbours.
+template<typename T>
+struct alignas(cache_line_size) cache_aligned_atomic {
+	std::atomic<T> value;
+
+	explicit cache_aligned_atomic(T v) : value(v) {}
+};
+
+// Greatest common divisor of "a" and "b".
+constexpr std::size_t gcd(std::size_t a, std::size_t b) {
+	return b == 0 ? a : gcd(b, a % b);
+}
+
+// Smallest power of two which isn't less than "n".
+inline
+std::size_t ceil_power_of_two(std::size_t n) {
+	std::size_t p = 1;
+	while (p < n) p <<= 1;
+	return p;
+}
+
+// Calls "f(i)" for every "i" in [0, n) from "threads" threads, calling thread included. Each thread takes the next "i"
+// once it's done with the previous one. If any call throws, remaining ones are skipped, and the first exception is rethrown.
+template<typename F>
+// F models UnaryProcedure : void operator()(std::size_t)
+void parallel_for_index(std::size_t n, std::size_t threads, F f) {
+	std::atomic<std::size_t> next{ 0 };
+	std::exception_ptr error;
+	std::mutex error_mutex;
+
+	auto work = [&]() {
+		for (auto i = next.fetch_add(1); i < n; i = next.fetch_add(1)) {
+			try {
+				f(i);
+			}
+			catch (...) {
+				std::lock_guard<std::mutex> lock(error_mutex);
+				if (!error) error = std::current_exception();
+				next.store(n);
+			}
+		}
+	};
+
+	std::vector<std::thread> workers;
+	const auto extra = (std::min)(threads, n) > 1 ? (std::min)(threads, n) - 1 : 0;
+	workers.reserve(extra);
+	for (std::size_t t = 0; t != extra; ++t)
+		workers.emplace_back(work);
+	work();
+	for (auto &worker : workers)
+		worker.join();
+
+	if (error) std::rethrow_exception(error);
+}
+
+
+
+//**************************************************************************************************
+// thread_pool keeps its worker threads alive between jobs, so that parallel algorithms which run
+// every frame don't pay for thread creation. A job is a number of chunks, which are split evenly
+// between the participants, the calling thread included. Each participant takes chunks from the front
+// of its own range, and once that's empty, steals the upper half of the range of some other participant.
+// Ranges are single atomic words, so both taking and stealing are lock free.
+//**************************************************************************************************
+
+class thread_pool {
+	// Range of chunks left to a participant, with the first chunk in the lower half of the word, and one past the last in the upper one.
+	// Each range takes whole cache lines of its own, so ranges of different participants don't share them.
+	struct alignas(cache_line_size) range {
+		std::atomic<std::uint64_t> bounds;
+	};
+
+	static std::uint64_t _make_bounds(std::size_t first, std::size_t last) {
+		return (static_cast<std::uint64_t>(last) << 32) | static_cast<std::uint64_t>(first);
+	}
+
+	static std::size_t _first(std::uint64_t bounds) {
+		return static_cast<std::size_t>(bounds & 0xffffffffu);
+	}
+
+	static std::size_t _last(std::uint64_t bounds) {
+		return static_cast<std::size_t>(bounds >> 32);
+	}
+
+	std::vector<std::thread> workers;
+	cache_aligned_array<range> ranges;
+
+	std::mutex run_mutex;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable finished;
+	std::size_t generation;
+	std::size_t busy;
+	bool stopping;
+
+	void (*call)(void*, std::size_t);
+	void *context;
+	std::atomic<bool> failed;
+	std::exception_ptr error;
+
+	template<typename F>
+	static void _call(void *f, std::size_t chunk) {
+		(*static_cast<F*>(f))(chunk);
+	}
+
+	// Takes the first chunk of the participant's own range.
+	bool _pop(std::size_t p, std::size_t &chunk) {
+		auto bounds = ranges[p].bounds.load(std::memory_order_relaxed);
+		for (;;) {
+			const auto first = _first(bounds), last = _last(bounds);
+			if (first == last) return false;
+			if (ranges[p].bounds.compare_exchange_weak(bounds, _make_bounds(first + 1, last), std::memory_order_relaxed)) {
+				chunk = first;
+				return true;
+			}
+		}
+	}
+
+	// Takes the upper half of the range of the first participant after "p" which has any chunks left.
+	// Its first chunk is returned, and the rest become the range of "p", which has to be empty beforehand.
+	bool _steal(std::size_t p, std::size_t &chunk) {
+		const auto n = workers.size() + 1;
+		for (auto q = (p + 1) % n; q != p; q = (q + 1) % n) {
+			auto bounds = ranges[q].bounds.load(std::memory_order_relaxed);
+			for (;;) {
+				const auto first = _first(bounds), last = _last(bounds);
+				if (first == last) break;
+				const auto middle = first + (last - first) / 2;
+				if (ranges[q].bounds.compare_exchange_weak(bounds, _make_bounds(first, middle), std::memory_order_relaxed)) {
+					ranges[p].bounds.store(_make_bounds(middle + 1, last), std::memory_order_relaxed);
+					chunk = middle;
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+
+	// Runs chunks until none are left anywhere. Once a call throws, remaining chunks are taken but skipped.
+	void _work(std::size_t p) {
+		std::size_t chunk;
+		while (_pop(p, chunk) || _steal(p, chunk)) {
+			if (failed.load(std::memory_order_relaxed)) continue;
+			try {
+				call(context, chunk);
+			}
+			catch (...) {
+				std::lock_guard<std::mutex> lock(mutex);
+				if (!error) error = std::current_exception();
+				failed.store(true, std::memory_order_relaxed);
+			}
+		}
+	}
+
+	void _worker_loop(std::size_t p) {
+		std::size_t seen = 0;
+		for (;;) {
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				wake.wait(lock, [this, seen]() { return stopping || generation != seen; });
+				if (stopping) return;
+				seen = generation;
+			}
+			_work(p);
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (--busy == 0) finished.notify_one();
+			}
+		}
+	}
+
+public:
+	// Number of threads includes the calling one, so "threads - 1" workers are started.
+	explicit thread_pool(std::size_t threads = default_concurrency()) :
+		ranges((std::max)(threads, std::size_t(1))),
+		generation(0),
+		busy(0),
+		stopping(false),
+		call(nullptr),
+		context(nullptr),
+		failed(false)
+	{
+		for (std::size_t p = 0; p != (std::max)(threads, std::size_t(1)); ++p)
+			ranges[p].bounds.store(0, std::memory_order_relaxed);
+		workers.reserve(threads > 1 ? threads - 1 : 0);
+		for (std::size_t p = 1; p < threads; ++p)
+			workers.emplace_back([this, p]() { _worker_loop(p); });
+	}
+
+	thread_pool(const thread_pool&) = delete;
+	thread_pool& operator=(const thread_pool&) = delete;
+
+	~thread_pool() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		wake.notify_all();
+		for (auto &worker : workers)
+			worker.join();
+	}
+
+	// Number of threads which run chunks, the calling one included.
+	std::size_t size() const {
+		return workers.size() + 1;
+	}
+
+	// Calls "f(i)" for every chunk "i" in [0, n), and returns once all calls are done. Jobs from different
+	// threads run one after another, and "f" must not run a job of the same pool. If any call throws,
+	// remaining ones are skipped, and the first exception is rethrown. At most 2^32 - 1 chunks are allowed.
+	template<typename F>
+	// F models UnaryProcedure : void operator()(std::size_t)
+	void run(std::size_t n, F f) {
+		if (n > std::size_t(0xffffffffu))
+			throw std::length_error("thread_pool runs at most 2^32 - 1 chunks per job");
+		std::lock_guard<std::mutex> run_lock(run_mutex);
+		if (workers.empty() || n <= 1) {
+			for (std::size_t i = 0; i != n; ++i) f(i);
+			return;
+		}
+
+		const auto participants = size();
+		for (std::size_t p = 0; p != participants; ++p)
+			ranges[p].bounds.store(_make_bounds(n * p / participants, n * (p + 1) / participants), std::memory_order_relaxed);
+		call = &_call<F>;
+		context = &f;
+		failed.store(false, std::memory_order_relaxed);
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			error = nullptr;
+			busy = workers.size();
+			++generation;
+		}
+		wake.notify_all();
+
+		_work(0);
+
+		std::exception_ptr e;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			finished.wait(lock, [this]() { return busy == 0; });
+			std::swap(e, error);
+		}
+		if (e) std::rethrow_exception(e);
+	}
+};
+
+// Pool shared by parallel algorithms of slot maps, with one thread per core.
+inline
+thread_pool& default_thread_pool() {
+	static thread_pool pool;
+	return pool;
+}
+
+
+
+//**************************************************************************************************
+// Parallel algorithms over the dense values of a slot map. Values are split into chunks which a
+// thread pool runs, several per thread, so that idle threads can steal work from busy ones.
+// Chunk boundaries fall on cache line boundaries whenever the layout of values allows it, so threads
+// which write to neighbouring chunks never write to the same cache line.
+// Callbacks get both the value and its id, and have to be safe to call concurrently.
+// The slot map must not be modified until the algorithm returns.
+//**************************************************************************************************
+
+// Splits positions [0, n) of an array of "T" into chunks. Boundaries between chunks are a multiple of
+// the number of values after which the array gets back to the same offset within a cache line, counted
+// from the first value which starts a cache line.
+template<typename T>
+class cache_line_chunks {
+	static constexpr std::size_t line_span = cache_line_size / gcd(sizeof(T), cache_line_size);
+
+	std::size_t n;
+	std::size_t offset;
+	std::size_t chunk;
+
+public:
+	// Makes about "min_count" chunks, of no fewer than "min_chunk" values each.
+	cache_line_chunks(const T *first, std::size_t n, std::size_t min_count, std::size_t min_chunk = 1024) :
+		n(n),
+		offset(0),
+		chunk(line_span)
+	{
+		const auto address = reinterpret_cast<std::uintptr_t>(first);
+		for (std::size_t p = 0; p != line_span; ++p) {
+			if ((address + p * sizeof(T)) % cache_line_size == 0) {
+				offset = p;
+				break;
+			}
+		}
+		const auto wanted = (std::max)(min_chunk, (n + min_count - 1) / (min_count != 0 ? min_count : 1));
+		chunk = (wanted + line_span - 1) / line_span * line_span;
+	}
+
+	std::size_t count() const {
+		return n > offset ? (n - offset + chunk - 1) / chunk : std::size_t(1);
+	}
+
+	std::size_t begin(std::size_t i) const {
+		return i == 0 ? std::size_t(0) : (std::min)(n, offset + i * chunk);
+	}
+
+	std::size_t end(std::size_t i) const {
+		return (std::min)(n, offset + (i + 1) * chunk);
+	}
+};
+
+template<typename T>
+constexpr std::size_t cache_line_chunks<T>::line_span;
+
+// Each thread of the pool gets this many chunks on average, so that stealing can even out uneven work.
+constexpr std::size_t parallel_chunks_per_thread = 8;
+
+// Calls "f(i, first, last)" for every chunk "i" of the dense values of "sm", where [first, last) are its iterators.
+template<typename SM, typename F>
+// SM models SlotMap
+// F models TernaryProcedure : void operator()(std::size_t, decltype(sm.begin()), decltype(sm.begin()))
+void parallel_for_chunks(SM &sm, thread_pool &pool, F f) {
+	const auto first = sm.begin();
+	const auto n = static_cast<std::size_t>(sm.size());
+	if (n == 0) return;
+	const cache_line_chunks<ValueType<SM>> chunks(&*first, n, pool.size() * parallel_chunks_per_thread);
+	pool.run(chunks.count(), [&](std::size_t i) {
+		f(i, first + chunks.begin(i), first + chunks.end(i));
+	});
+}
+
+// Calls "f(v, id)" for every value "v" of "sm" and its id. Values marked by "defer_erase" are skipped.
+template<typename SM, typename F>
+// SM models SlotMap
+// F models BinaryProcedure : void operator()(ValueType<SM>&, SM::id_type)
+void parallel_for_each(SM &sm, F f, thread_pool &pool = default_thread_pool()) {
+	parallel_for_chunks(sm, pool, [&sm, &f](std::size_t, decltype(sm.begin()) first, decltype(sm.begin()) last) {
+		for (; first != last; ++first)
+			if (!sm.is_dead(first)) f(*first, sm.id_of_iterator(first));
+	});
+}
+
+// Writes "f(v, id)" to "out[i]" for every value "v" at position "i" of "sm". Positions of values marked
+// by "defer_erase" are left as they are.
+template<typename SM, typename O, typename F>
+// SM models SlotMap
+// O models RandomAccessIterator
+// F models BinaryFunction : U operator()(const ValueType<SM>&, SM::id_type)
+void parallel_transform(const SM &sm, O out, F f, thread_pool &pool = default_thread_pool()) {
+	const auto begin = sm.begin();
+	parallel_for_chunks(sm, pool, [&](std::size_t, decltype(sm.begin()) first, decltype(sm.begin()) last) {
+		auto o = out + (first - begin);
+		for (; first != last; ++first, ++o)
+			if (!sm.is_dead(first)) *o = f(*first, sm.id_of_iterator(first));
+	});
+}
+
+// Reduces "transform(v, id)" of all values with "reduce", starting from "init". Each chunk is reduced on its own,
+// and the results are then reduced in the order of chunks, so "reduce" has to be associative but not commutative.
+// Values marked by "defer_erase" are skipped.
+template<typename SM, typename T, typename R, typename F>
+// SM models SlotMap
+// R models BinaryOperation : T operator()(T, T)
+// F models BinaryFunction : T operator()(const ValueType<SM>&, SM::id_type)
+T parallel_transform_reduce(const SM &sm, T init, R reduce, F transform, thread_pool &pool = default_thread_pool()) {
+	// Padding keeps partial results of different chunks out of the same cache line.
+	struct partial {
+		T value;
+		bool has_value;
+		char padding[cache_line_size];
+	};
+
+	const auto first = sm.begin();
+	const auto n = static_cast<std::size_t>(sm.size());
+	if (n == 0) return init;
+	const cache_line_chunks<ValueType<SM>> chunks(&*first, n, pool.size() * parallel_chunks_per_thread);
+	std::vector<partial> partials(chunks.count(), partial{ init, false, {} });
+
+	pool.run(chunks.count(), [&](std::size_t i) {
+		auto it = first + chunks.begin(i);
+		const auto last = first + chunks.end(i);
+		while (it != last && sm.is_dead(it)) ++it;
+		if (it == last) return;
+		T acc = transform(*it, sm.id_of_iterator(it));
+		for (++it; it != last; ++it)
+			if (!sm.is_dead(it)) acc = reduce(std::move(acc), transform(*it, sm.id_of_iterator(it)));
+		partials[i].value = std::move(acc);
+		partials[i].has_value = true;
+	});
+
+	for (auto &p : partials)
+		if (p.has_value) init = reduce(std::move(init), std::move(p.value));
+	return init;
+}
+
+// Reduces all values with "reduce", starting from "init".
+template<typename SM, typename T, typename R>
+// SM models SlotMap
+// R models BinaryOperation : T operator()(T, T)
+T parallel_reduce(const SM &sm, T init, R reduce, thread_pool &pool = default_thread_pool()) {
+	using value_type = ValueType<SM>;
+	return parallel_transform_reduce(sm, std::move(init), reduce,
+		[](const value_type &v, typename SM::id_type) -> const value_type& { return v; }, pool);
+}
+
+
+
+//**************************************************************************************************
+// concurrent_slot_map splits its values across a power of two number of shards. Each shard is a
+// "versioned_slot_map" with its own lock, so threads which work on different shards don't contend.
+// Lower bits of an id's index hold the number of its shard, so lookup and erasure lock only that shard.
+// Insertion goes to the shard of the calling thread, which keeps threads apart as long as there
+// are no more of them than there are shards.
+//
+// References to values are never handed out, since other threads may move them at any time.
+// Values are accessed through "visit", which calls a function with the value while its shard is locked.
+//**************************************************************************************************
+
+template<typename T,
+	typename S = default_size_type,
+	typename V = default_version_type,
+	typename A = default_allocator_type<T>>
+class concurrent_slot_map {
+public:
+	using value_type = T;
+	using size_type = S;
+	using map_type = versioned_slot_map<T, S, V, A>;
+	using id_traits_type = typename map_type::id_traits_type;
+	using version_type = typename map_type::version_type;
+	using id_type = typename map_type::id_type;
+
+private:
+	// Each shard takes whole cache lines of its own, so the lock of one shard and the bookkeeping 
+	// of the next one don't share them.
+	struct alignas(cache_line_size) shard {
+		std::mutex mutex;
+		map_type map;
+	};
+
+	using lock_type = std::lock_guard<std::mutex>;
+
+	cache_aligned_array<shard> shards;
+	size_type nm_shards;
+	unsigned shard_bits;
+
+	size_type _shard_of(id_type id) const {
+		return static_cast<size_type>(id_traits_type::index(id) & (nm_shards - 1));
+	}
+
+	id_type _local_id(id_type id) const {
+		return id_traits_type::make(static_cast<size_type>(id_traits_type::index(id) >> shard_bits), id_traits_type::version(id));
+	}
+
+	id_type _global_id(size_type shard_index, id_type local) const {
+		return id_traits_type::make(static_cast<size_type>((id_traits_type::index(local) << shard_bits) | shard_index), id_traits_type::version(local));
+	}
+
+	size_type _this_thread_shard() const {
+		return static_cast<size_type>(this_thread_ordinal() & (nm_shards - 1));
+	}
+
+	// Shard index takes the lower bits of the index of global ids, so each shard can address fewer slots.
+	size_type _shard_max_size() const {
+		return static_cast<size_type>(id_traits_type::max_size() >> shard_bits);
+	}
+
+	template<typename... Args>
+	id_type _emplace(Args&&... args) {
+		const auto shard_index = _this_thread_shard();
+		auto &s = shards[shard_index];
+		lock_type lock(s.mutex);
+		if (s.map.size() == s.map.capacity())
+			s.map.reserve(grow_size_within<typename map_type::growth_policy_type>(_shard_max_size(), s.map.size(), size_type(1), sizeof(value_type)));
+		return _global_id(shard_index, s.map.emplace(std::forward<Args>(args)...).second);
+	}
+
+public:
+	// Number of shards is rounded up to a power of two.
+	explicit concurrent_slot_map(size_type shard_count = static_cast<size_type>(default_concurrency())) :
+		shards(ceil_power_of_two(shard_count)),
+		nm_shards(static_cast<size_type>(ceil_power_of_two(shard_count))),
+		shard_bits(0)
+	{
+		while ((size_type(1) << shard_bits) != nm_shards) ++shard_bits;
+	}
+
+	concurrent_slot_map(const concurrent_slot_map&) = delete;
+	concurrent_slot_map& operator=(const concurrent_slot_map&) = delete;
+
+	size_type shard_count() const {
+		return nm_shards;
+	}
+
+	id_type insert(const value_type &v) {
+		return _emplace(v);
+	}
+
+	id_type insert(value_type &&v) {
+		return _emplace(std::move(v));
+	}
+
+	template<typename... Args>
+	id_type emplace(Args&&... args) {
+		return _emplace(std::forward<Args>(args)...);
+	}
+
+	// Returns false if the id isn't valid, in which case nothing is erased.
+	bool erase(id_type id) {
+		auto &s = shards[_shard_of(id)];
+		const auto local = _local_id(id);
+		lock_type lock(s.mutex);
+		if (!s.map.id_is_valid(local)) return false;
+		s.map.erase(local);
+		return true;
+	}
+
+	bool id_is_valid(id_type id) const {
+		auto &s = shards[_shard_of(id)];
+		lock_type lock(s.mutex);
+		return s.map.id_is_valid(_local_id(id));
+	}
+
+	// Calls "f" with the value of the id while its shard is locked. Returns false if the id isn't valid, in which case "f" isn't called.
+	template<typename F>
+	// F models UnaryProcedure : void operator()(value_type&)
+	bool visit(id_type id, F f) {
+		auto &s = shards[_shard_of(id)];
+		const auto local = _local_id(id);
+		lock_type lock(s.mutex);
+		if (!s.map.id_is_valid(local)) return false;
+		f(s.map.id_value(local));
+		return true;
+	}
+
+	template<typename F>
+	// F models UnaryProcedure : void operator()(const value_type&)
+	bool visit(id_type id, F f) const {
+		auto &s = shards[_shard_of(id)];
+		const auto local = _local_id(id);
+		lock_type lock(s.mutex);
+		if (!s.map.id_is_valid(local)) return false;
+		f(static_cast<const map_type&>(s.map).id_value(local));
+		return true;
+	}
+
+	// Calls "f" with the map of the shard while it's locked. Ids which "f" gets from the map are local to the shard.
+	template<typename F>
+	// F models UnaryProcedure : void operator()(map_type&)
+	void visit_shard(size_type shard_index, F f) {
+		auto &s = shards[shard_index];
+		lock_type lock(s.mutex);
+		f(s.map);
+	}
+
+	// Calls "f" with every value, one shard after another.
+	template<typename F>
+	// F models UnaryProcedure : void operator()(value_type&)
+	void for_each(F f) {
+		for (size_type i = 0; i != nm_shards; ++i)
+			visit_shard(i, [&f](map_type &map) { for (auto &v : map) f(v); });
+	}
+
+	// Calls "f" with every value from up to "threads" threads. Each thread locks one shard at a time, 
+	// and sweeps through its dense array of values. "f" has to be safe to call concurrently.
+	template<typename F>
+	// F models UnaryProcedure : void operator()(value_type&)
+	void parallel_for_each(F f, std::size_t threads = default_concurrency()) {
+		parallel_for_index(nm_shards, threads, [this, &f](std::size_t i) {
+			visit_shard(static_cast<size_type>(i), [&f](map_type &map) { for (auto &v : map) f(v); });
+		});
+	}
+
+	// Sum of shard sizes. Shards are locked one at a time, so it's only a snapshot if other threads modify the map.
+	size_type size() const {
+		size_type n = 0;
+		for (size_type i = 0; i != nm_shards; ++i) {
+			lock_type lock(shards[i].mutex);
+			n += shards[i].map.size();
+		}
+		return n;
+	}
+
+	bool empty() const {
+		return size() == size_type(0);
+	}
+
+	// Reserves room for "s" values in total, spread evenly across shards.
+	void reserve(size_type s) {
+		const auto per_shard = static_cast<size_type>((s + nm_shards - 1) / nm_shards);
+		check_id_max_size(per_shard, _shard_max_size());
+		for (size_type i = 0; i != nm_shards; ++i)
+			visit_shard(i, [per_shard](map_type &map) { map.reserve(per_shard); });
+	}
+
+	void shrink_to_fit() {
+		for (size_type i = 0; i != nm_shards; ++i)
+			visit_shard(i, [](map_type &map) { map.shrink_to_fit(); });
+	}
+
+	void clear() {
+		for (size_type i = 0; i != nm_shards; ++i)
+			visit_shard(i, [](map_type &map) { map.clear(); });
+	}
+};
+
+
+
+//**************************************************************************************************
+// concurrent_insert_slot_map lets many threads insert at once without taking any lock. 
+// Free id slots form a lock free stack, whose head is a single atomic word holding the index of the 
+// head slot and its version. Versions change every time a slot is freed, so they double as tags which
+// guard the head against the ABA problem. Once a thread pops an id slot, it takes the next position of 
+// the dense array of values by bumping its atomic size, and constructs the value there.
+//
+// Values live in storage which is reserved up front, since it can't be reallocated while other threads
+// insert. Insertion fails once the reserved room runs out, and the end id is returned instead.
+// Ids and values of inserted objects can be read while other threads insert, as values don't move.
+// All other methods modify or sweep the dense array, so they must not run concurrently with anything else.
+//**************************************************************************************************
+
+template<typename T,
+	typename S = default_size_type,
+	typename V = default_version_type,
+	typename A = default_allocator_type<T>>
+class concurrent_insert_slot_map {
+public:
+	using value_type = T;
+	using size_type = S;
+	using id_traits_type = IdTraits<size_type, V>;
+	using version_type = VersionType<id_traits_type>;
+	using id_type = typename id_traits_type::id_type;
+	using allocator_type = AllocatorRebindType<A, T>;
+
+	using iterator = value_type*;
+	using const_iterator = const value_type*;
+
+private:
+	static constexpr size_type npos = max_type_value<size_type>();
+
+	// Head of the free stack keeps the slot index in its lower half, and the lower half of the slot's version in the upper one.
+	using head_type = std::uint64_t;
+	static constexpr head_type head_index_mask = 0xffffffffu;
+
+	struct id_slot {
+		std::atomic<size_type> value;
+		std::atomic<version_type> version;
+	};
+
+	using alloc_traits = std::allocator_traits<allocator_type>;
+
+	allocator_type alloc;
+	std::unique_ptr<id_slot[]> id_slots;
+	std::unique_ptr<size_type[]> id_positions;
+	value_type *values;
+	size_type values_capacity;
+
+	// Both atomics are hit by every insertion, so each gets a cache line of its own.
+	cache_aligned_atomic<head_type> free_head;
+	cache_aligned_atomic<size_type> values_size;
+
+	static head_type _make_head(size_type index, version_type version) {
+		return (static_cast<head_type>(version) << 32) | (static_cast<head_type>(index) & head_index_mask);
+	}
+
+	static size_type _head_index(head_type head) {
+		const auto index = head & head_index_mask;
+		return index == head_index_mask ? npos : static_cast<size_type>(index);
+	}
+
+	head_type _head_of(size_type index) const {
+		return index == npos ? head_index_mask : _make_head(index, id_slots[index].version.load(std::memory_order_relaxed));
+	}
+
+	// Pops the head of the free stack, or returns "npos" if it's empty.
+	size_type _pop_id_slot() {
+		auto head = free_head.value.load(std::memory_order_acquire);
+		for (;;) {
+			const auto index = _head_index(head);
+			if (index == npos) return npos;
+			const auto next = id_slots[index].value.load(std::memory_order_relaxed);
+			if (free_head.value.compare_exchange_weak(head, _head_of(next), std::memory_order_acq_rel, std::memory_order_acquire))
+				return index;
+		}
+	}
+
+	// Pushes the chain of id slots from "first" to "last" onto the free stack. Versions have to be incremented beforehand.
+	void _push_id_slots(size_type first, size_type last) {
+		const auto new_head = _head_of(first);
+		auto head = free_head.value.load(std::memory_order_relaxed);
+		do {
+			id_slots[last].value.store(_head_index(head), std::memory_order_relaxed);
+		} while (!free_head.value.compare_exchange_weak(head, new_head, std::memory_order_release, std::memory_order_relaxed));
+	}
+
+	template<typename... Args>
+	void _construct(value_type *p, std::true_type, Args&&... args) {
+		alloc_traits::construct(alloc, p, std::forward<Args>(args)...);
+	}
+
+	// Value is constructed before any room is taken, so that an exception leaves the map untouched.
+	void _construct(value_type *p, std::false_type, value_type &&v) {
+		alloc_traits::construct(alloc, p, std::move(v));
+	}
+
+	template<typename... Args>
+	id_type _emplace(std::true_type nothrow, Args&&... args) {
+		const auto index = _pop_id_slot();
+		if (index == npos) return id_traits_type::end();
+		const auto value_pos = values_size.value.fetch_add(1, std::memory_order_relaxed);
+		_construct(values + value_pos, nothrow, std::forward<Args>(args)...);
+		id_positions[value_pos] = index;
+		id_slots[index].value.store(value_pos, std::memory_order_relaxed);
+		return id_traits_type::make(index, id_slots[index].version.load(std::memory_order_relaxed));
+	}
+
+	template<typename... Args>
+	id_type _emplace(std::false_type nothrow, Args&&... args) {
+		static_assert(std::is_nothrow_move_constructible<value_type>::value,
+			"value_type has to be either nothrow constructible from the arguments, or nothrow move constructible");
+		value_type v(std::forward<Args>(args)...);
+		const auto index = _pop_id_slot();
+		if (index == npos) return id_traits_type::end();
+		const auto value_pos = values_size.value.fetch_add(1, std::memory_order_relaxed);
+		_construct(values + value_pos, nothrow, std::move(v));
+		id_positions[value_pos] = index;
+		id_slots[index].value.store(value_pos, std::memory_order_relaxed);
+		return id_traits_type::make(index, id_slots[index].version.load(std::memory_order_relaxed));
+	}
+
+	void _destroy_values() {
+		const auto size = values_size.value.load(std::memory_order_relaxed);
+		for (size_type i = 0; i != size; ++i)
+			alloc_traits::destroy(alloc, values + i);
+	}
+
+public:
+	explicit concurrent_insert_slot_map(size_type capacity = size_type(0), const allocator_type &alloc = allocator_type{}) :
+		alloc(alloc),
+		values(nullptr),
+		values_capacity(0),
+		free_head(head_index_mask),
+		values_size(0)
+	{
+		reserve(capacity);
+	}
+
+	concurrent_insert_slot_map(const concurrent_insert_slot_map&) = delete;
+	concurrent_insert_slot_map& operator=(const concurrent_insert_slot_map&) = delete;
+
+	~concurrent_insert_slot_map() {
+		_destroy_values();
+		if (values) alloc_traits::deallocate(alloc, values, values_capacity);
+	}
+
+	// Grows the room for values to "s". Must not run concurrently with anything else.
+	void reserve(size_type s) {
+		if (s <= values_capacity) return;
+		if (static_cast<head_type>(s) >= head_index_mask)
+			throw std::length_error("concurrent_insert_slot_map can hold at most 2^32 - 2 values");
+		check_id_max_size(s, id_traits_type::max_size());
+
+		const auto size = values_size.value.load(std::memory_order_relaxed);
+		std::unique_ptr<id_slot[]> new_id_slots(new id_slot[s]);
+		std::unique_ptr<size_type[]> new_id_positions(new size_type[s]);
+		auto new_values = alloc_traits::allocate(alloc, s);
+
+		size_type moved = 0;
+		try {
+			for (; moved != size; ++moved) {
+				alloc_traits::construct(alloc, new_values + moved, std::move_if_noexcept(values[moved]));
+				new_id_positions[moved] = id_positions[moved];
+			}
+		}
+		catch (...) {
+			for (size_type i = 0; i != moved; ++i)
+				alloc_traits::destroy(alloc, new_values + i);
+			alloc_traits::deallocate(alloc, new_values, s);
+			throw;
+		}
+		for (size_type i = 0; i != values_capacity; ++i) {
+			new_id_slots[i].value.store(id_slots[i].value.load(std::memory_order_relaxed), std::memory_order_relaxed);
+			new_id_slots[i].version.store(id_slots[i].version.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		}
+		for (auto i = values_capacity; i != s; ++i) {
+			new_id_slots[i].value.store(i + 1 != s ? static_cast<size_type>(i + 1) : npos, std::memory_order_relaxed);
+			new_id_slots[i].version.store(min_type_value<version_type>(), std::memory_order_relaxed);
+		}
+
+		_destroy_values();
+		if (values) alloc_traits::deallocate(alloc, values, values_capacity);
+		const auto old_capacity = values_capacity;
+		values = new_values;
+		values_capacity = s;
+		id_slots = std::move(new_id_slots);
+		id_positions = std::move(new_id_positions);
+		_push_id_slots(old_capacity, static_cast<size_type>(s - 1));
+	}
+
+	// Safe to call from many threads at once. Returns the end id if there's no room left.
+	template<typename... Args>
+	id_type try_emplace(Args&&... args) {
+		return _emplace(std::integral_constant<bool, std::is_nothrow_constructible<value_type, Args&&...>::value>{}, std::forward<Args>(args)...);
+	}
+
+	id_type try_insert(const value_type &v) {
+		return try_emplace(v);
+	}
+
+	id_type try_insert(value_type &&v) {
+		return try_emplace(std::move(v));
+	}
+
+	bool id_is_end(id_type id) const {
+		return id_traits_type::is_end(id);
+	}
+
+	bool id_is_valid(id_type id) const {
+		const auto index = id_traits_type::index(id);
+		return index < values_capacity && id_traits_type::has_version(id, id_slots[index].version.load(std::memory_order_relaxed));
+	}
+
+	value_type& id_value(id_type id) {
+		return values[id_slots[id_traits_type::index(id)].value.load(std::memory_order_relaxed)];
+	}
+
+	const value_type& id_value(id_type id) const {
+		return values[id_slots[id_traits_type::index(id)].value.load(std::memory_order_relaxed)];
+	}
+
+	// Must not run concurrently with anything else.
+	void erase(id_type id) {
+		const auto index = id_traits_type::index(id);
+		const auto value_pos = id_slots[index].value.load(std::memory_order_relaxed);
+		const auto last_pos = static_cast<size_type>(values_size.value.load(std::memory_order_relaxed) - 1);
+		if (value_pos != last_pos) {
+			values[value_pos] = std::move(values[last_pos]);
+			id_positions[value_pos] = id_positions[last_pos];
+			id_slots[id_positions[value_pos]].value.store(value_pos, std::memory_order_relaxed);
+		}
+		alloc_traits::destroy(alloc, values + last_pos);
+		values_size.value.store(last_pos, std::memory_order_relaxed);
+		id_slots[index].version.fetch_add(1, std::memory_order_relaxed);
+		_push_id_slots(index, index);
+	}
+
+	// Must not run concurrently with anything else.
+	void clear() {
+		const auto size = values_size.value.load(std::memory_order_relaxed);
+		if (size == size_type(0)) return;
+		for (size_type i = 0; i != size; ++i) {
+			auto &slot = id_slots[id_positions[i]];
+			slot.version.fetch_add(1, std::memory_order_relaxed);
+			slot.value.store(i + 1 != size ? id_positions[i + 1] : npos, std::memory_order_relaxed);
+		}
+		_destroy_values();
+		values_size.value.store(0, std::memory_order_relaxed);
+		_push_id_slots(id_positions[0], id_positions[size - 1]);
+	}
+
+	size_type size() const {
+		return values_size.value.load(std::memory_order_relaxed);
+	}
+
+	size_type capacity() const {
+		return values_capacity;
+	}
+
+	bool empty() const {
+		return size() == size_type(0);
+	}
+
+	iterator begin() { return values; }
+	iterator end() { return values + size(); }
+	const_iterator begin() const { return values; }
+	const_iterator end() const { return values + size(); }
+	const_iterator cbegin() const { return begin(); }
+	const_iterator cend() const { return end(); }
+
+	id_type id_of_iterator(const_iterator it) const {
+		const auto index = id_positions[it - values];
+		return id_traits_type::make(index, id_slots[index].version.load(std::memory_order_relaxed));
+	}
+};
+
+template<typename T, typename S, typename V, typename A>
+constexpr typename concurrent_insert_slot_map<T, S, V, A>::size_type concurrent_insert_slot_map<T, S, V, A>::npos;
+template<typename T, typename S, typename V, typename A>
+constexpr typename concurrent_insert_slot_map<T, S, V, A>::head_type concurrent_insert_slot_map<T, S, V, A>::head_index_mask;
+
+
+
+//**************************************************************************************************
+// seqlock_slot_list is a versioned slot list which one writer thread modifies, while any number of
+// reader threads read its values without taking a lock. Each slot has a sequence counter next to its
+// version, which is odd while the writer changes the slot. Readers copy the value, and retry if the
+// counter changed in the meantime. Erasure bumps the version in the middle of such a write, so a read
+// either sees the value as it was before, or finds out that the id is no longer valid.
+//
+// Values are stored as arrays of atomic words, so "T" must be trivially copyable. Slots are kept in
+// segments which double in size and never move, so that readers can reach them while the list grows.
+//**************************************************************************************************
+
+template<typename T,
+	typename S = default_size_type,
+	typename V = default_version_type,
+	typename A = default_allocator_type<T>>
+class seqlock_slot_list {
+public:
+	using value_type = T;
+	using size_type = S;
+	using id_traits_type = IdTraits<size_type, V>;
+	using version_type = VersionType<id_traits_type>;
+	using id_type = typename id_traits_type::id_type;
+	using allocator_type = A;
+
+	static_assert(std::is_trivially_copyable<value_type>::value, "value_type of seqlock_slot_list must be trivially copyable");
+
+private:
+	static constexpr size_type npos = max_type_value<size_type>();
+
+	using word_type = std::uint64_t;
+	static constexpr std::size_t word_count = (sizeof(value_type) + sizeof(word_type) - 1) / sizeof(word_type);
+
+	struct slot {
+		std::atomic<version_type> sequence;
+		std::atomic<version_type> version;
+		size_type next;
+		std::atomic<word_type> words[word_count];
+	};
+
+	using slot_allocator_type = AllocatorRebindType<A, slot>;
+	using slot_alloc_traits = std::allocator_traits<slot_allocator_type>;
+
+	// First segment holds 2^segment_bits slots, and each following one as many as all before it.
+	static constexpr unsigned segment_bits = 6;
+	static constexpr unsigned max_segments = 64;
+
+	slot_allocator_type alloc;
+	std::atomic<slot*> segments[max_segments];
+	unsigned nm_segments;
+	std::atomic<size_type> slots_capacity;
+	size_type filled_size;
+	size_type empty_head;
+	occupancy_bitmap<A> occupancy;
+
+	static unsigned _segment_of(size_type i) {
+		return i >> segment_bits == 0 ? 0u : highest_set_bit(static_cast<std::uint64_t>(i >> segment_bits)) + 1u;
+	}
+
+	static size_type _segment_begin(unsigned k) {
+		return k == 0 ? size_type(0) : static_cast<size_type>(size_type(1) << (segment_bits + k - 1));
+	}
+
+	static size_type _segment_size(unsigned k) {
+		return static_cast<size_type>(size_type(1) << (k == 0 ? segment_bits : segment_bits + k - 1));
+	}
+
+	slot& _slot(size_type i) const {
+		const auto k = _segment_of(i);
+		return segments[k].load(std::memory_order_acquire)[i - _segment_begin(k)];
+	}
+
+	// Slots past the number ids can address are allocated with the last segment, but never linked nor counted.
+	void _add_segment() {
+		const auto k = nm_segments;
+		const auto n = _segment_size(k);
+		const auto max_size = id_traits_type::max_size();
+		check_id_max_size(static_cast<size_type>(_segment_begin(k) + 1), max_size);
+		const auto linked = (std::min)(n, static_cast<size_type>(max_size - _segment_begin(k)));
+		auto p = slot_alloc_traits::allocate(alloc, n);
+		for (size_type i = 0; i != n; ++i) {
+			auto q = ::new (static_cast<void*>(p + i)) slot;
+			q->sequence.store(version_type(0), std::memory_order_relaxed);
+			q->version.store(min_type_value<version_type>(), std::memory_order_relaxed);
+			for (auto &word : q->words)
+				word.store(word_type(0), std::memory_order_relaxed);
+			q->next = i + 1 < linked ? static_cast<size_type>(_segment_begin(k) + i + 1) : empty_head;
+		}
+		empty_head = _segment_begin(k);
+		segments[k].store(p, std::memory_order_release);
+		++nm_segments;
+		slots_capacity.store(static_cast<size_type>(_segment_begin(k) + linked), std::memory_order_release);
+		occupancy.resize(slots_capacity.load(std::memory_order_relaxed));
+	}
+
+	// Writer side of the sequence lock. "f" is called while the slot's counter is odd.
+	template<typename F>
+	void _write(slot &sl, F f) {
+		const auto sequence = sl.sequence.load(std::memory_order_relaxed);
+		sl.sequence.store(static_cast<version_type>(sequence + 1), std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		f();
+		sl.sequence.store(static_cast<version_type>(sequence + 2), std::memory_order_release);
+	}
+
+	static void _store_words(slot &sl, const value_type &v) {
+		word_type buffer[word_count] = {};
+		std::memcpy(buffer, &v, sizeof(value_type));
+		for (std::size_t i = 0; i != word_count; ++i)
+			sl.words[i].store(buffer[i], std::memory_order_relaxed);
+	}
+
+	static void _load_words(const slot &sl, word_type (&buffer)[word_count]) {
+		for (std::size_t i = 0; i != word_count; ++i)
+			buffer[i] = sl.words[i].load(std::memory_order_relaxed);
+	}
+
+	// Reader side of the sequence lock. Copies the words of the value of "id" into "buffer", or returns false if "id" isn't valid.
+	bool _read(id_type id, word_type (&buffer)[word_count]) const {
+		const auto index = id_traits_type::index(id);
+		if (index >= slots_capacity.load(std::memory_order_acquire)) return false;
+		const auto &sl = _slot(index);
+		for (;;) {
+			const auto before = sl.sequence.load(std::memory_order_acquire);
+			if (before & version_type(1)) continue;
+			const auto version = sl.version.load(std::memory_order_relaxed);
+			_load_words(sl, buffer);
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (sl.sequence.load(std::memory_order_relaxed) == before)
+				return id_traits_type::has_version(id, version);
+		}
+	}
+
+public:
+	explicit seqlock_slot_list(const allocator_type &alloc = allocator_type{}) :
+		alloc(alloc),
+		nm_segments(0),
+		slots_capacity(0),
+		filled_size(0),
+		empty_head(npos),
+		occupancy(alloc)
+	{
+		for (auto &segment : segments)
+			segment.store(nullptr, std::memory_order_relaxed);
+		occupancy.enable(0);
+	}
+
+	seqlock_slot_list(const seqlock_slot_list&) = delete;
+	seqlock_slot_list& operator=(const seqlock_slot_list&) = delete;
+
+	~seqlock_slot_list() {
+		for (unsigned k = 0; k != nm_segments; ++k) {
+			const auto n = _segment_size(k);
+			auto p = segments[k].load(std::memory_order_relaxed);
+			for (size_type i = 0; i != n; ++i)
+				p[i].~slot();
+			slot_alloc_traits::deallocate(alloc, p, n);
+		}
+	}
+
+	// Reader side, safe to call from any thread. Copies the value of "id" into "v", or returns false if "id" isn't valid.
+	bool try_read(id_type id, value_type &v) const {
+		word_type buffer[word_count];
+		if (!_read(id, buffer)) return false;
+		std::memcpy(&v, buffer, sizeof(value_type));
+		return true;
+	}
+
+	// Reader side, safe to call from any thread. Calls "f" with a copy of the value of "id", or returns false if "id" isn't valid.
+	template<typename F>
+	// F models UnaryProcedure : void operator()(const value_type&)
+	bool try_read(id_type id, F f) const {
+		word_type buffer[word_count];
+		if (!_read(id, buffer)) return false;
+		typename std::aligned_storage<sizeof(value_type), alignof(value_type)>::type storage;
+		std::memcpy(&storage, buffer, sizeof(value_type));
+		f(*reinterpret_cast<const value_type*>(&storage));
+		return true;
+	}
+
+	// Safe to call from any thread.
+	bool id_is_valid(id_type id) const {
+		const auto index = id_traits_type::index(id);
+		return index < slots_capacity.load(std::memory_order_acquire) &&
+			id_traits_type::has_version(id, _slot(index).version.load(std::memory_order_acquire));
+	}
+
+	// Methods below are meant for the writer thread only.
+
+	id_type insert(const value_type &v) {
+		if (empty_head == npos) _add_segment();
+		const auto index = empty_head;
+		auto &sl = _slot(index);
+		empty_head = sl.next;
+		_write(sl, [&]() { _store_words(sl, v); });
+		occupancy.set(index);
+		++filled_size;
+		return id_traits_type::make(index, sl.version.load(std::memory_order_relaxed));
+	}
+
+	template<typename... Args>
+	id_type emplace(Args&&... args) {
+		return insert(value_type(std::forward<Args>(args)...));
+	}
+
+	void erase(id_type id) {
+		const auto index = id_traits_type::index(id);
+		auto &sl = _slot(index);
+		_write(sl, [&]() { sl.version.store(static_cast<version_type>(sl.version.load(std::memory_order_relaxed) + 1), std::memory_order_relaxed); });
+		sl.next = empty_head;
+		empty_head = index;
+		occupancy.reset(index);
+		--filled_size;
+	}
+
+	void store(id_type id, const value_type &v) {
+		auto &sl = _slot(id_traits_type::index(id));
+		_write(sl, [&]() { _store_words(sl, v); });
+	}
+
+	// Calls "f" with a copy of the value of "id", and stores the copy back once "f" returns.
+	template<typename F>
+	// F models UnaryProcedure : void operator()(value_type&)
+	void modify(id_type id, F f) {
+		auto v = load(id);
+		f(v);
+		store(id, v);
+	}
+
+	value_type load(id_type id) const {
+		word_type buffer[word_count];
+		_load_words(_slot(id_traits_type::index(id)), buffer);
+		typename std::aligned_storage<sizeof(value_type), alignof(value_type)>::type storage;
+		std::memcpy(&storage, buffer, sizeof(value_type));
+		return *reinterpret_cast<const value_type*>(&storage);
+	}
+
+	// Calls "f" with the id and a copy of the value of each filled slot, in the order of slots.
+	template<typename F>
+	// F models BinaryProcedure : void operator()(id_type, const value_type&)
+	void for_each(F f) const {
+		occupancy.for_each_set([&](std::size_t i) {
+			const auto index = static_cast<size_type>(i);
+			const auto id = id_traits_type::make(index, _slot(index).version.load(std::memory_order_relaxed));
+			f(id, load(id));
+		});
+	}
+
+	void reserve(size_type s) {
+		check_id_max_size(s, id_traits_type::max_size());
+		while (slots_capacity.load(std::memory_order_relaxed) < s) _add_segment();
+	}
+
+	// Erases all values. Slots stay allocated, as readers may still be looking at them.
+	void clear() {
+		occupancy.for_each_set([&](std::size_t i) {
+			const auto index = static_cast<size_type>(i);
+			erase(id_traits_type::make(index, _slot(index).version.load(std::memory_order_relaxed)));
+		});
+	}
+
+	size_type size() const {
+		return filled_size;
+	}
+
+	size_type capacity() const {
+		return slots_capacity.load(std::memory_order_relaxed);
+	}
+
+	bool empty() const {
+		return filled_size == size_type(0);
+	}
+};
+
+template<typename T, typename S, typename V, typename A>
+constexpr typename seqlock_slot_list<T, S, V, A>::size_type seqlock_slot_list<T, S, V, A>::npos;
+template<typename T, typename S, typename V, typename A>
+constexpr std::size_t seqlock_slot_list<T, S, V, A>::word_count;
+template<typename T, typename S, typename V, typename A>
+constexpr unsigned seqlock_slot_list<T, S, V, A>::segment_bits;
+template<typename T, typename S, typename V, typename A>
+constexpr unsigned seqlock_slot_list<T, S, V, A>::max_segments;
+
+} // namespace rea
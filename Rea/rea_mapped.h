@@ -0,0 +1,729 @@
+#pragma once
+
+/*
+MIT License
+
+Copyright(c)[2018][Igor Mitrovic]
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+
+#include "rea.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+//**************************************************************************************************
+// File backed containers, for data sets which don't fit into memory or take too long to load.
+// Their arrays are memory mapped files, so opening an existing file costs the same no matter how 
+// large it is, and pages are read from disk only when they are touched.
+// Only trivially copyable types can be stored, since the bytes of the file are the objects themselves.
+// POSIX only. Files are not portable across platforms of different byte order or type sizes.
+//**************************************************************************************************
+
+namespace rea {
+
+// First bytes of every file of a "mapped_array". Data starts at the next page, so it's aligned for any type.
+struct mapped_array_header {
+	static constexpr std::uint64_t magic_value = 0x31414552444d4552; // "REMDREA1"
+
+	std::uint64_t magic;
+	std::uint64_t element_size;
+	std::uint64_t size;
+	std::uint64_t capacity;
+	// Free for the owner of the array to keep its own state in.
+	std::uint64_t user[4];
+};
+
+inline
+std::size_t mapped_page_size() {
+	static const std::size_t page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+	return page;
+}
+
+inline
+std::size_t mapped_round_to_page(std::size_t bytes) {
+	const auto page = mapped_page_size();
+	return (bytes + page - 1) / page * page;
+}
+
+[[noreturn]] inline
+void mapped_throw_errno(const char *what) {
+	throw std::system_error(errno, std::generic_category(), what);
+}
+
+
+
+// Growable array of trivially copyable objects which lives in a memory mapped file.
+// Size and capacity are kept in the header of the file, so the array is restored as is when the file is opened again.
+// Growth extends the file and remaps it(with mremap on Linux), so objects are never copied, although
+// their addresses may change.
+// mapped_array models DenseContainer, except that it can't be copied. Its memory doesn't come from an allocator,
+// "allocator_type" is there only so it can stand in for std::vector, E.g. in "mapped_containers".
+template<typename T>
+// T models TriviallyCopyable
+class mapped_array {
+	static_assert(std::is_trivially_copyable<T>::value, "rea::mapped_array can only hold trivially copyable types");
+
+public:
+	using value_type = T;
+	using size_type = std::size_t;
+	using difference_type = std::ptrdiff_t;
+	using reference = value_type&;
+	using const_reference = const value_type&;
+	using pointer = value_type*;
+	using const_pointer = const value_type*;
+	using iterator = pointer;
+	using const_iterator = const_pointer;
+	using reverse_iterator = std::reverse_iterator<iterator>;
+	using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+	using allocator_type = std::allocator<value_type>;
+
+private:
+	int fd;
+	void *base;
+	std::size_t mapped_bytes;
+
+	static std::size_t _header_bytes() {
+		return mapped_round_to_page(sizeof(mapped_array_header));
+	}
+
+	static std::size_t _file_bytes(size_type capacity) {
+		return mapped_round_to_page(_header_bytes() + capacity * sizeof(value_type));
+	}
+
+	mapped_array_header& _header() const {
+		return *static_cast<mapped_array_header*>(base);
+	}
+
+	pointer _data() const {
+		return reinterpret_cast<pointer>(static_cast<char*>(base) + _header_bytes());
+	}
+
+	void _map(std::size_t bytes) {
+		void *p = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if (p == MAP_FAILED) mapped_throw_errno("rea::mapped_array: mmap");
+		base = p;
+		mapped_bytes = bytes;
+	}
+
+	void _remap(std::size_t bytes) {
+		if (::ftruncate(fd, static_cast<off_t>(bytes)) != 0) mapped_throw_errno("rea::mapped_array: ftruncate");
+#ifdef __linux__
+		void *p = ::mremap(base, mapped_bytes, bytes, MREMAP_MAYMOVE);
+		if (p == MAP_FAILED) mapped_throw_errno("rea::mapped_array: mremap");
+		base = p;
+		mapped_bytes = bytes;
+#else
+		::munmap(base, mapped_bytes);
+		base = nullptr;
+		_map(bytes);
+#endif
+	}
+
+	void _close() {
+		if (base != nullptr) ::munmap(base, mapped_bytes);
+		if (fd != -1) ::close(fd);
+		base = nullptr;
+		fd = -1;
+		mapped_bytes = 0;
+	}
+
+public:
+	// Opens the file at "path", or creates an empty array there if the file doesn't exist.
+	// Throws std::system_error if the file can't be opened or mapped, and std::runtime_error if it
+	// isn't an array of objects of the same size.
+	explicit mapped_array(const std::string &path) : fd(-1), base(nullptr), mapped_bytes(0) {
+		fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+		if (fd == -1) mapped_throw_errno("rea::mapped_array: open");
+		struct stat st;
+		if (::fstat(fd, &st) != 0) {
+			const int e = errno;
+			_close();
+			throw std::system_error(e, std::generic_category(), "rea::mapped_array: fstat");
+		}
+		try {
+			if (st.st_size == 0) {
+				if (::ftruncate(fd, static_cast<off_t>(_file_bytes(0))) != 0) mapped_throw_errno("rea::mapped_array: ftruncate");
+				_map(_file_bytes(0));
+				_header() = mapped_array_header{ mapped_array_header::magic_value, sizeof(value_type), 0, 0, { 0, 0, 0, 0 } };
+			}
+			else {
+				if (static_cast<std::size_t>(st.st_size) < _file_bytes(0)) 
+					throw std::runtime_error("rea::mapped_array: " + path + " is not a mapped array");
+				_map(static_cast<std::size_t>(st.st_size));
+				const auto &h = _header();
+				if (h.magic != mapped_array_header::magic_value || h.element_size != sizeof(value_type) ||
+					h.size > h.capacity || _file_bytes(static_cast<size_type>(h.capacity)) > mapped_bytes)
+					throw std::runtime_error("rea::mapped_array: " + path + " is not a mapped array of this type");
+			}
+		}
+		catch (...) {
+			_close();
+			throw;
+		}
+	}
+
+	mapped_array(const mapped_array&) = delete;
+	mapped_array& operator=(const mapped_array&) = delete;
+
+	mapped_array(mapped_array &&other) : fd(other.fd), base(other.base), mapped_bytes(other.mapped_bytes) {
+		other.fd = -1;
+		other.base = nullptr;
+		other.mapped_bytes = 0;
+	}
+
+	mapped_array& operator=(mapped_array &&other) {
+		if (this != &other) {
+			_close();
+			std::swap(fd, other.fd);
+			std::swap(base, other.base);
+			std::swap(mapped_bytes, other.mapped_bytes);
+		}
+		return *this;
+	}
+
+	~mapped_array() {
+		_close();
+	}
+
+	// False once the array is moved from.
+	bool is_open() const { return base != nullptr; }
+
+	size_type size() const { return static_cast<size_type>(_header().size); }
+	size_type capacity() const { return static_cast<size_type>(_header().capacity); }
+	bool empty() const { return size() == size_type(0); }
+	size_type max_size() const { return (std::numeric_limits<off_t>::max)() / sizeof(value_type); }
+
+	pointer data() { return _data(); }
+	const_pointer data() const { return _data(); }
+
+	allocator_type get_allocator() const { return allocator_type(); }
+
+	reference operator[](size_type i) { return _data()[i]; }
+	const_reference operator[](size_type i) const { return _data()[i]; }
+	reference front() { return _data()[0]; }
+	const_reference front() const { return _data()[0]; }
+	reference back() { return _data()[size() - 1]; }
+	const_reference back() const { return _data()[size() - 1]; }
+
+	iterator begin() { return _data(); }
+	iterator end() { return _data() + size(); }
+	const_iterator begin() const { return _data(); }
+	const_iterator end() const { return _data() + size(); }
+	const_iterator cbegin() const { return begin(); }
+	const_iterator cend() const { return end(); }
+	reverse_iterator rbegin() { return reverse_iterator(end()); }
+	reverse_iterator rend() { return reverse_iterator(begin()); }
+	const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+	const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+	const_reverse_iterator crbegin() const { return rbegin(); }
+	const_reverse_iterator crend() const { return rend(); }
+
+	// Words in the header which the owner of the array may use. They are stored in the file.
+	std::uint64_t* user_words() { return _header().user; }
+	const std::uint64_t* user_words() const { return _header().user; }
+
+	// Extends the file. Pages of the new part take no disk space until they are written.
+	void reserve(size_type n) {
+		if (n <= capacity()) return;
+		if (n > max_size()) throw std::length_error("rea::mapped_array: reserve");
+		_remap(_file_bytes(n));
+		_header().capacity = n;
+	}
+
+	// Truncates the file to fit the objects.
+	void shrink_to_fit() {
+		if (capacity() == size()) return;
+		_remap(_file_bytes(size()));
+		_header().capacity = size();
+	}
+
+	// New objects are value initialized.
+	void resize(size_type n) {
+		if (n > capacity()) reserve(n);
+		for (auto i = size(); i < n; ++i) ::new (static_cast<void*>(_data() + i)) value_type();
+		_header().size = n;
+	}
+
+	template<typename... Args>
+	void emplace_back(Args&&... args) {
+		if (size() == capacity()) reserve(grow_size(size()));
+		::new (static_cast<void*>(_data() + size())) value_type(std::forward<Args>(args)...);
+		++_header().size;
+	}
+
+	void push_back(const value_type &v) {
+		emplace_back(v);
+	}
+
+	void pop_back() {
+		--_header().size;
+	}
+
+	// Objects are appended, and rotated into place if "pos" isn't the end.
+	template<typename I>
+	// I models InputIterator
+	iterator insert(const_iterator pos, I first, I last) {
+		const auto index = static_cast<size_type>(pos - cbegin());
+		const auto old_size = size();
+		for (; first != last; ++first) emplace_back(*first);
+		std::rotate(begin() + index, begin() + old_size, end());
+		return begin() + index;
+	}
+
+	iterator erase(const_iterator first, const_iterator last) {
+		const auto index = static_cast<size_type>(first - cbegin());
+		const auto n = static_cast<size_type>(last - first);
+		std::move(begin() + index + n, end(), begin() + index);
+		_header().size -= n;
+		return begin() + index;
+	}
+
+	void clear() {
+		_header().size = 0;
+	}
+
+	// Writes modified pages to the file, and waits until they are written.
+	void flush() const {
+		if (::msync(base, mapped_bytes, MS_SYNC) != 0) mapped_throw_errno("rea::mapped_array: msync");
+	}
+};
+
+
+
+
+// Containers of "versioned_slot_map" which live in memory mapped files. Only trivially copyable values can be stored.
+struct mapped_containers {
+	template<typename T, typename A>
+	using value_container = mapped_array<T>;
+
+	template<typename S, typename A>
+	using id_pos_container = mapped_array<S>;
+
+	template<typename N, typename A>
+	using id_slot_container = mapped_array<N>;
+};
+
+// The list of empty id slots and the version floor of a "versioned_slot_map" are kept in the header 
+// of the file of its id slots, so they are restored together with the map.
+template<typename N, typename S, typename V>
+void sm_store_state(mapped_array<N> &id_slots, const std::pair<S, S> &empty_pos, const V &version_floor) {
+	auto words = id_slots.user_words();
+	words[0] = static_cast<std::uint64_t>(empty_pos.first);
+	words[1] = static_cast<std::uint64_t>(empty_pos.second);
+	words[2] = static_cast<std::uint64_t>(version_floor);
+}
+
+template<typename N, typename S, typename V>
+void sm_restore_state(const mapped_array<N> &id_slots, std::pair<S, S> &empty_pos, V &version_floor) {
+	const auto words = id_slots.user_words();
+	empty_pos.first = static_cast<S>(words[0]);
+	empty_pos.second = static_cast<S>(words[1]);
+	version_floor = static_cast<V>(words[2]);
+}
+
+
+
+// "versioned_slot_map" whose values, id slots and id positions live in three mapped arrays, in the files
+// "path.values", "path.ids" and "path.positions". Opening existing files restores the map as it was, with the same ids, 
+// and pages of values are read only once they are touched. Growth extends the files instead of copying values,
+// by steps of "G", which defaults to "large_growth_policy" since files grow in whole pages anyway.
+// All three files are updated by every modifying method, so "flush" is the only thing needed to make them durable.
+// Erasures deferred by "defer_erase" are the exception, they are kept in memory until "commit", "flush" or destruction.
+// Values and ids are stored as they are in memory, so "size_type" and "version_type" should have a fixed size.
+template<typename T,
+	typename S = std::uint64_t,
+	typename V = std::uint32_t,
+	typename G = large_growth_policy>
+class mapped_slot_map : public versioned_slot_map<T, S, V, std::allocator<T>, G, mapped_containers> {
+	using map_type = versioned_slot_map<T, S, V, std::allocator<T>, G, mapped_containers>;
+
+	// Moved from maps have no files to commit to.
+	void _commit_if_open() {
+		if (this->value_container().is_open()) this->commit();
+	}
+
+public:
+	using typename map_type::size_type;
+	using typename map_type::id_type;
+	using typename map_type::value_type;
+	using typename map_type::id_slot_container_type;
+	using typename map_type::value_container_type;
+	using typename map_type::id_pos_container_type;
+
+	// Opens the map stored at "path", or creates an empty one there.
+	// Throws std::system_error if any of the files can't be opened, and std::runtime_error if they don't hold
+	// a map of the same types.
+	explicit mapped_slot_map(const std::string &path) :
+		map_type(id_slot_container_type(path + ".ids"), value_container_type(path + ".values"), id_pos_container_type(path + ".positions"))
+	{
+
+	}
+
+	mapped_slot_map(mapped_slot_map&&) = default;
+
+	// Pending deferred erasures of this map are committed before its files are closed.
+	mapped_slot_map& operator=(mapped_slot_map &&other) {
+		if (this != &other) {
+			_commit_if_open();
+			map_type::operator=(std::move(other));
+		}
+		return *this;
+	}
+
+	// Versions of ids erased by "defer_erase" are in the files already, so their values are erased
+	// before the files are closed, instead of being left behind where no id reaches them.
+	~mapped_slot_map() {
+		_commit_if_open();
+	}
+
+	value_type* data() { return this->begin(); }
+	const value_type* data() const { return this->begin(); }
+
+	// Id of the value at position "pos".
+	id_type id_of_position(size_type pos) const {
+		return this->id_of_iterator(this->cbegin() + pos);
+	}
+
+	// Commits deferred erasures, then writes all modified pages of the three files, and waits until they are written.
+	void flush() {
+		this->commit();
+		this->id_slot_container().flush();
+		this->value_container().flush();
+		this->id_pos_container().flush();
+	}
+};
+
+
+
+
+//**************************************************************************************************
+// Containers which reserve address space for their largest size up front, and commit pages of it 
+// as they grow. Their arrays are never relocated, so growth never copies values and never invalidates
+// pointers, and no single insertion pays more than a bounded amount of work.
+// Reserved pages take no memory until they are committed. 64 bit platforms only have enough
+// address space to reserve generously.
+//**************************************************************************************************
+
+// Flags of private anonymous mappings which aren't counted against the memory of the system until committed.
+inline
+int reserved_map_flags() {
+	int flags = MAP_PRIVATE;
+#ifdef MAP_ANONYMOUS
+	flags |= MAP_ANONYMOUS;
+#else
+	flags |= MAP_ANON;
+#endif
+#ifdef MAP_NORESERVE
+	flags |= MAP_NORESERVE;
+#endif
+	return flags;
+}
+
+// Reserves "bytes" of address space which can't be touched until it's committed.
+inline
+void* reserved_map(std::size_t bytes) {
+	void *p = ::mmap(nullptr, bytes, PROT_NONE, reserved_map_flags(), -1, 0);
+	if (p == MAP_FAILED) mapped_throw_errno("rea::reserved_map: mmap");
+	return p;
+}
+
+// Makes reserved pages readable and writable. Throws std::bad_alloc if the system is out of memory.
+inline
+void reserved_commit(void *p, std::size_t bytes) {
+	if (::mprotect(p, bytes, PROT_READ | PROT_WRITE) != 0) throw std::bad_alloc();
+}
+
+// Gives committed pages back to the system, and leaves them reserved.
+inline
+void reserved_decommit(void *p, std::size_t bytes) {
+	if (::mmap(p, bytes, PROT_NONE, reserved_map_flags() | MAP_FIXED, -1, 0) == MAP_FAILED)
+		mapped_throw_errno("rea::reserved_decommit: mmap");
+}
+
+
+
+// Growable array whose capacity is bounded by "max_size" given at construction. Address space for 
+// "max_size" objects is reserved once, and "reserve" commits only the pages which it needs, so objects
+// are never copied or moved by growth, and pointers to them stay valid until they are erased.
+// Capacity is always a whole number of pages. Growth beyond "max_size" throws std::length_error.
+// reserved_array models DenseContainer, except that it can't be copied. Like with "mapped_array", 
+// "allocator_type" is there only so it can stand in for std::vector.
+template<typename T>
+class reserved_array {
+public:
+	using value_type = T;
+	using size_type = std::size_t;
+	using difference_type = std::ptrdiff_t;
+	using reference = value_type&;
+	using const_reference = const value_type&;
+	using pointer = value_type*;
+	using const_pointer = const value_type*;
+	using iterator = pointer;
+	using const_iterator = const_pointer;
+	using reverse_iterator = std::reverse_iterator<iterator>;
+	using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+	using allocator_type = std::allocator<value_type>;
+
+private:
+	pointer base;
+	size_type count;
+	size_type limit;
+	std::size_t reserved_bytes;
+	std::size_t committed_bytes;
+
+	void _destroy(size_type first) {
+		for (auto i = first; i != count; ++i) base[i].~value_type();
+		count = first;
+	}
+
+	void _release() {
+		if (base != nullptr) {
+			_destroy(0);
+			::munmap(base, reserved_bytes);
+		}
+		base = nullptr;
+		count = limit = 0;
+		reserved_bytes = committed_bytes = 0;
+	}
+
+public:
+	// Reserves address space for "max_size" objects, without committing any memory.
+	// Throws std::length_error if that many objects can't be addressed, and std::system_error 
+	// if the address space can't be reserved.
+	explicit reserved_array(size_type max_size) : 
+		base(nullptr), 
+		count(0), 
+		limit(max_size), 
+		reserved_bytes(0), 
+		committed_bytes(0) 
+	{
+		if (max_size > (max_type_value<std::size_t>() - mapped_page_size()) / sizeof(value_type))
+			throw std::length_error("rea::reserved_array: max_size");
+		reserved_bytes = mapped_round_to_page(max_size * sizeof(value_type));
+		if (reserved_bytes != 0) base = static_cast<pointer>(reserved_map(reserved_bytes));
+	}
+
+	reserved_array(const reserved_array&) = delete;
+	reserved_array& operator=(const reserved_array&) = delete;
+
+	reserved_array(reserved_array &&other) : 
+		base(other.base), 
+		count(other.count), 
+		limit(other.limit), 
+		reserved_bytes(other.reserved_bytes), 
+		committed_bytes(other.committed_bytes) 
+	{
+		other.base = nullptr;
+		other.count = other.limit = 0;
+		other.reserved_bytes = other.committed_bytes = 0;
+	}
+
+	reserved_array& operator=(reserved_array &&other) {
+		if (this != &other) {
+			_release();
+			std::swap(base, other.base);
+			std::swap(count, other.count);
+			std::swap(limit, other.limit);
+			std::swap(reserved_bytes, other.reserved_bytes);
+			std::swap(committed_bytes, other.committed_bytes);
+		}
+		return *this;
+	}
+
+	~reserved_array() {
+		_release();
+	}
+
+	size_type size() const { return count; }
+	size_type capacity() const { 
+		const auto c = committed_bytes / sizeof(value_type);
+		return c < limit ? c : limit;
+	}
+	bool empty() const { return count == size_type(0); }
+	size_type max_size() const { return limit; }
+
+	pointer data() { return base; }
+	const_pointer data() const { return base; }
+
+	allocator_type get_allocator() const { return allocator_type(); }
+
+	reference operator[](size_type i) { return base[i]; }
+	const_reference operator[](size_type i) const { return base[i]; }
+	reference front() { return base[0]; }
+	const_reference front() const { return base[0]; }
+	reference back() { return base[count - 1]; }
+	const_reference back() const { return base[count - 1]; }
+
+	iterator begin() { return base; }
+	iterator end() { return base + count; }
+	const_iterator begin() const { return base; }
+	const_iterator end() const { return base + count; }
+	const_iterator cbegin() const { return begin(); }
+	const_iterator cend() const { return end(); }
+	reverse_iterator rbegin() { return reverse_iterator(end()); }
+	reverse_iterator rend() { return reverse_iterator(begin()); }
+	const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+	const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+	const_reverse_iterator crbegin() const { return rbegin(); }
+	const_reverse_iterator crend() const { return rend(); }
+
+	// Commits pages up to the one which holds object "n - 1". Costs one system call, plus one page fault
+	// per page once the new objects are first written.
+	void reserve(size_type n) {
+		if (n <= capacity()) return;
+		if (n > limit) throw std::length_error("rea::reserved_array: reserve");
+		const auto bytes = mapped_round_to_page(n * sizeof(value_type));
+		reserved_commit(reinterpret_cast<char*>(base) + committed_bytes, bytes - committed_bytes);
+		committed_bytes = bytes;
+	}
+
+	// Decommits pages past the last object.
+	void shrink_to_fit() {
+		const auto bytes = mapped_round_to_page(count * sizeof(value_type));
+		if (bytes == committed_bytes) return;
+		reserved_decommit(reinterpret_cast<char*>(base) + bytes, committed_bytes - bytes);
+		committed_bytes = bytes;
+	}
+
+	// New objects are value initialized.
+	void resize(size_type n) {
+		if (n > capacity()) reserve(n);
+		if (n < count) _destroy(n);
+		for (; count < n; ++count) ::new (static_cast<void*>(base + count)) value_type();
+	}
+
+	template<typename... Args>
+	void emplace_back(Args&&... args) {
+		if (count == capacity()) reserve(count + 1);
+		::new (static_cast<void*>(base + count)) value_type(std::forward<Args>(args)...);
+		++count;
+	}
+
+	void push_back(const value_type &v) {
+		emplace_back(v);
+	}
+
+	void push_back(value_type &&v) {
+		emplace_back(std::move(v));
+	}
+
+	void pop_back() {
+		base[--count].~value_type();
+	}
+
+	// Objects are appended, and rotated into place if "pos" isn't the end.
+	template<typename I>
+	// I models InputIterator
+	iterator insert(const_iterator pos, I first, I last) {
+		const auto index = static_cast<size_type>(pos - cbegin());
+		const auto old_size = count;
+		for (; first != last; ++first) emplace_back(*first);
+		std::rotate(begin() + index, begin() + old_size, end());
+		return begin() + index;
+	}
+
+	iterator erase(const_iterator first, const_iterator last) {
+		const auto index = static_cast<size_type>(first - cbegin());
+		const auto n = static_cast<size_type>(last - first);
+		std::move(begin() + index + n, end(), begin() + index);
+		_destroy(count - n);
+		return begin() + index;
+	}
+
+	void clear() {
+		_destroy(0);
+	}
+};
+
+
+
+// Doubles the capacity, but never grows by more than 64KB of values at a time.
+using reserved_growth_policy = growth_policy<2, 1, 2, (std::size_t(1) << 16)>;
+
+// Containers of "versioned_slot_map" which never relocate their objects. They are made with "reserved_slot_map",
+// or handed to the map's constructor, since each of them needs its "max_size". Meant to be paired with "reserved_growth_policy".
+struct reserved_containers {
+	template<typename T, typename A>
+	using value_container = reserved_array<T>;
+
+	template<typename S, typename A>
+	using id_pos_container = reserved_array<S>;
+
+	template<typename N, typename A>
+	using id_slot_container = reserved_array<N>;
+};
+
+// "versioned_slot_map" which never relocates its values. Its values, id slots and id positions
+// live in "reserved_array"s of "max_size" objects, which commit pages as the map grows. Capacity grows by
+// steps of "G", which are bounded in bytes, so the id slots linked by one growth are bounded as well, and
+// no insertion costs more than a constant amount of work, no matter how large the map is. Pointers to values
+// stay valid until they are erased, or moved by erasure of another value.
+// Growth beyond "max_size" throws std::length_error.
+template<typename T,
+	typename S = default_size_type,
+	typename V = default_version_type,
+	typename G = reserved_growth_policy>
+class reserved_slot_map : public versioned_slot_map<T, S, V, std::allocator<T>, G, reserved_containers> {
+	using map_type = versioned_slot_map<T, S, V, std::allocator<T>, G, reserved_containers>;
+
+public:
+	using typename map_type::size_type;
+	using typename map_type::id_type;
+	using typename map_type::value_type;
+	using typename map_type::id_slot_container_type;
+	using typename map_type::value_container_type;
+	using typename map_type::id_pos_container_type;
+
+	// Reserves address space for "max_size" values and their ids, without committing any memory.
+	explicit reserved_slot_map(size_type max_size) :
+		map_type(id_slot_container_type(max_size), value_container_type(max_size), id_pos_container_type(max_size))
+	{
+
+	}
+
+	value_type* data() { return this->begin(); }
+	const value_type* data() const { return this->begin(); }
+
+	// Id of the value at position "pos".
+	id_type id_of_position(size_type pos) const {
+		return this->id_of_iterator(this->cbegin() + pos);
+	}
+};
+
+} // namespace rea
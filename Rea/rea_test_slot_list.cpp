@@ -61,6 +61,7 @@ int main() {
 	valid = sl.id_is_valid(ids[3]);
 
 	sl.insert(instrumented{ 4000 });
+	sl.emplace(4500);
 	sl.insert(instrumented{ 5000 });
 	sl.insert(instrumented{ 6000 });
 	sl.insert(instrumented{ 7000 });
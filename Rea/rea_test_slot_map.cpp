@@ -60,6 +60,7 @@ int main() {
 	valid = sm.id_is_valid(ids[3]);
 
 	sm.insert(instrumented{ 4000 });
+	sm.emplace(4500);
 
 	sm.clear_and_reset_version_counts();
 	//sm.reset_version_counts();
@@ -0,0 +1,987 @@
+#include "rea.h"
+#include "rea_concurrent.h"
+#if defined(__unix__) || defined(__APPLE__)
+#include "rea_mapped.h"
+#define REA_TESTS_MAPPED 1
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+//**************************************************************************************************
+// Behaviour tests of all containers. Each test covers one feature, and is registered with ctest
+// under its own name. Run "rea_tests" to run all of them, or "rea_tests NAME..." to run some.
+// Checks stay on in release builds, and a failed check ends its test with the failed expression.
+//**************************************************************************************************
+
+
+// Explicit instantiations compile every non-template member, which catches members that only break for some allocators.
+template class rea::slot_list<int>;
+template class rea::slot_map<int>;
+template class rea::versioned_slot_map<int>;
+
+namespace {
+
+struct check_failure : std::runtime_error {
+	check_failure(const char *file, int line, const char *expression) :
+		std::runtime_error(std::string(file) + ":" + std::to_string(line) + ": check failed: " + expression) {}
+};
+
+#define REA_CHECK(expression) do { if (!(expression)) throw check_failure(__FILE__, __LINE__, #expression); } while (false)
+
+// Passes if "statement" throws "E".
+#define REA_CHECK_THROWS(statement, E) do { \
+		bool thrown = false; \
+		try { statement; } catch (const E&) { thrown = true; } \
+		if (!thrown) throw check_failure(__FILE__, __LINE__, #statement " throws " #E); \
+	} while (false)
+
+template<typename SL>
+// SL models SlotList
+std::vector<rea::ValueType<SL>> values_in_order(const SL &sl) {
+	return std::vector<rea::ValueType<SL>>(sl.begin(), sl.end());
+}
+
+template<typename SL>
+// SL models SlotList
+std::vector<rea::ValueType<SL>> values_in_slot_order(const SL &sl) {
+	std::vector<rea::ValueType<SL>> values;
+	sl.for_each([&values](const rea::ValueType<SL> &v) { values.push_back(v); });
+	return values;
+}
+
+template<typename C>
+std::vector<int> sorted(C c) {
+	std::vector<int> v(c.begin(), c.end());
+	std::sort(v.begin(), v.end());
+	return v;
+}
+
+std::vector<int> iota_vector(int n, int first = 0) {
+	std::vector<int> v(static_cast<std::size_t>(n));
+	std::iota(v.begin(), v.end(), first);
+	return v;
+}
+
+struct not_movable {
+	explicit not_movable(int a, int b) : value(a + b) {}
+	not_movable() : value(0) {}
+	not_movable(const not_movable&) = delete;
+	not_movable& operator=(const not_movable&) = delete;
+
+	int value;
+};
+
+struct no_default {
+	explicit no_default(int value) : value(value) {}
+
+	int value;
+};
+
+struct get_empty_no_default {
+	no_default operator()() const { return no_default(-1); }
+};
+
+
+
+// user-001 : the benchmark itself is covered by the "rea_benchmark_smoke" test.
+
+// user-002
+void test_emplace() {
+	rea::slot_list<not_movable> sl;
+	const auto id = sl.emplace(2, 3);
+	REA_CHECK(sl.id_value(id).value == 5);
+
+	rea::versioned_slot_list<std::pair<int, std::string>> vsl;
+	const auto vid = vsl.emplace(1, "one");
+	REA_CHECK(vsl.id_value(vid).second == "one");
+
+	rea::versioned_slot_map<std::pair<int, std::string>> sm;
+	const auto r = sm.emplace(2, "two");
+	REA_CHECK(r.first->second == "two" && sm.id_value(r.second).first == 2);
+
+	rea::controlled_slot_list<no_default, get_empty_no_default> csl;
+	const auto cid = csl.emplace(3);
+	csl.insert(no_default(4));
+	REA_CHECK(csl.id_value(cid).value == 3 && csl.size() == 2);
+	csl.erase(cid);
+	REA_CHECK(csl.size() == 1 && csl.begin()->value == 4);
+
+	rea::slot_map<no_default> nsm;
+	const auto nid = nsm.emplace(5).second;
+	rea::versioned_slot_map<no_default> nvsm;
+	const auto nvid = nvsm.emplace(6).second;
+	REA_CHECK(nsm.id_value(nid).value == 5 && nvsm.id_value(nvid).value == 6);
+}
+
+// Inserting a range after some erasures reuses the same slots, in the same order, as inserting the values one by one.
+template<typename SL>
+// SL models SlotList
+void check_insert_range_after_erase() {
+	SL one_by_one, ranged;
+	one_by_one.reserve(64);
+	ranged.reserve(64);
+	std::vector<typename SL::id_type> ids;
+	for (int i = 0; i != 10; ++i) {
+		ids.push_back(one_by_one.insert(i));
+		ranged.insert(i);
+	}
+	for (auto i : { 3, 7 }) {
+		one_by_one.erase(ids[i]);
+		ranged.erase(ids[i]);
+	}
+
+	const auto source = iota_vector(20, 100);
+	std::vector<typename SL::id_type> expected, inserted;
+	for (auto v : source)
+		expected.push_back(one_by_one.insert(v));
+	ranged.insert_range(source.begin(), source.end(), std::back_inserter(inserted));
+	REA_CHECK(inserted == expected && values_in_order(ranged) == values_in_order(one_by_one) && ranged.size() == 28);
+	for (std::size_t i = 0; i != source.size(); ++i)
+		REA_CHECK(ranged.id_value(inserted[i]) == source[i]);
+
+	ranged.erase(inserted[5]);
+	one_by_one.erase(expected[5]);
+	REA_CHECK(values_in_order(ranged) == values_in_order(one_by_one) && ranged.insert(1) == one_by_one.insert(1));
+}
+
+// user-003
+void test_insert_range() {
+	const auto source = iota_vector(100);
+	rea::versioned_slot_list<int> sl;
+	std::vector<rea::versioned_slot_list<int>::id_type> ids;
+	sl.insert_range(source.begin(), source.end(), std::back_inserter(ids));
+	REA_CHECK(sl.size() == 100 && ids.size() == 100);
+	for (int i = 0; i != 100; ++i)
+		REA_CHECK(sl.id_value(ids[i]) == i);
+
+	rea::slot_map<int> sm(source.begin(), source.end());
+	REA_CHECK(sm.size() == 100 && sorted(sm) == source);
+
+	check_insert_range_after_erase<rea::slot_list<int>>();
+	check_insert_range_after_erase<rea::controlled_slot_list<int>>();
+	check_insert_range_after_erase<rea::versioned_slot_list<int>>();
+	check_insert_range_after_erase<rea::split_slot_list<int>>();
+	check_insert_range_after_erase<rea::versioned_split_slot_list<int>>();
+
+	rea::slot_list<int> defragmenting;
+	std::vector<rea::slot_list<int>::id_type> defrag_ids;
+	defragmenting.insert_range(source.begin(), source.end(), std::back_inserter(defrag_ids));
+	for (std::size_t i = 0; i < defrag_ids.size(); i += 2)
+		defragmenting.erase(defrag_ids[i]);
+	REA_CHECK(!defragmenting.defragment(10));
+	defragmenting.insert_range(source.begin(), source.begin() + 30);
+	REA_CHECK(defragmenting.defragment() && defragmenting.size() == 80);
+	auto in_order = values_in_order(defragmenting);
+	REA_CHECK(in_order == values_in_slot_order(defragmenting));
+
+	std::istringstream in("1 2 3");
+	rea::versioned_slot_map<int> from_input;
+	from_input.insert_range(std::istream_iterator<int>(in), std::istream_iterator<int>());
+	REA_CHECK(sorted(from_input) == iota_vector(3, 1));
+}
+
+// user-004
+void test_erase_many() {
+	rea::versioned_slot_map<int> sm;
+	std::vector<rea::versioned_slot_map<int>::id_type> ids;
+	for (int i = 0; i != 100; ++i)
+		ids.push_back(sm.insert(i).second);
+
+	std::vector<rea::versioned_slot_map<int>::id_type> erased;
+	for (int i = 0; i < 100; i += 3)
+		erased.push_back(ids[i]);
+	erased.push_back(ids[0]);
+	REA_CHECK(sm.erase_many(erased.begin(), erased.end()) == 34);
+	REA_CHECK(sm.size() == 66);
+	for (int i = 0; i != 100; ++i) {
+		REA_CHECK(sm.id_is_valid(ids[i]) == (i % 3 != 0));
+		if (i % 3 != 0) REA_CHECK(sm.id_value(ids[i]) == i);
+	}
+	REA_CHECK(sm.erase_many(erased.begin(), erased.end()) == 0);
+
+	rea::slot_map<int> plain;
+	std::vector<rea::slot_map<int>::id_type> plain_ids;
+	for (int i = 0; i != 10; ++i)
+		plain_ids.push_back(plain.insert(i).second);
+	REA_CHECK(plain.erase_many(plain_ids.begin(), plain_ids.begin() + 5) == 5);
+	REA_CHECK(sorted(plain) == iota_vector(5, 5));
+}
+
+// user-005
+void test_erase_if() {
+	rea::versioned_slot_map<int> sm;
+	std::vector<rea::versioned_slot_map<int>::id_type> ids;
+	for (int i = 0; i != 100; ++i)
+		ids.push_back(sm.insert(i).second);
+	REA_CHECK(sm.erase_if([](int v) { return v % 2 == 0; }) == 50);
+	REA_CHECK(std::vector<int>(sm.begin(), sm.end()) == [] { std::vector<int> v; for (int i = 1; i < 100; i += 2) v.push_back(i); return v; }());
+	for (int i = 0; i != 100; ++i)
+		REA_CHECK(sm.id_is_valid(ids[i]) == (i % 2 == 1));
+	const auto id = sm.insert(1000).second;
+	REA_CHECK(sm.id_value(id) == 1000);
+}
+
+// user-006
+void test_packed_id() {
+	using map_type = rea::versioned_slot_map<int, std::size_t, rea::packed_id<std::uint32_t, 20>>;
+	static_assert(std::is_same<map_type::id_type, std::uint32_t>::value, "packed ids are single integers");
+	map_type sm;
+	const auto a = sm.insert(1).second;
+	sm.erase(a);
+	const auto b = sm.insert(2).second;
+	REA_CHECK(a != b && !sm.id_is_valid(a) && sm.id_is_valid(b) && sm.id_value(b) == 2);
+
+	rea::versioned_slot_list<int, rea::packed_id<std::uint16_t, 8>> sl;
+	const auto c = sl.insert(3);
+	sl.erase(c);
+	const auto d = sl.insert(4);
+	REA_CHECK(!sl.id_is_valid(c) && sl.id_is_valid(d));
+
+	// 4 index bits address 15 slots, as index 15 is the end id.
+	using small_id = rea::packed_id<std::uint32_t, 4>;
+	rea::versioned_slot_list<int, small_id> small_sl;
+	rea::versioned_slot_map<int, std::size_t, small_id> small_sm;
+	rea::seqlock_slot_list<int, std::size_t, small_id> small_seqlock;
+	std::vector<std::uint32_t> list_ids, map_ids, seqlock_ids;
+	for (int i = 0; i != 15; ++i) {
+		list_ids.push_back(small_sl.insert(i));
+		map_ids.push_back(small_sm.insert(i).second);
+		seqlock_ids.push_back(small_seqlock.insert(i));
+	}
+	REA_CHECK_THROWS(small_sl.insert(15), std::length_error);
+	REA_CHECK_THROWS(small_sm.insert(15), std::length_error);
+	REA_CHECK_THROWS(small_seqlock.insert(15), std::length_error);
+	REA_CHECK_THROWS(small_sm.reserve(16), std::length_error);
+	REA_CHECK(small_sl.size() == 15 && small_sm.size() == 15 && small_seqlock.size() == 15);
+	for (int i = 0; i != 15; ++i) {
+		REA_CHECK(small_sl.id_value(list_ids[i]) == i);
+		REA_CHECK(small_sm.id_value(map_ids[i]) == i);
+		REA_CHECK(small_seqlock.load(seqlock_ids[i]) == i);
+	}
+	const auto end_id = rea::IdTraits<std::size_t, small_id>::end();
+	REA_CHECK(!small_sl.id_is_valid(end_id) && !small_sm.id_is_valid(end_id) && !small_seqlock.id_is_valid(end_id));
+	small_sm.erase(map_ids[3]);
+	REA_CHECK(small_sm.id_is_valid(small_sm.insert(3).second) && small_sm.size() == 15);
+
+	// Shard index takes one more bit with two shards, which leaves 7 slots per shard.
+	rea::concurrent_slot_map<int, std::size_t, small_id> small_csm(1);
+	for (int i = 0; i != 15; ++i)
+		small_csm.insert(i);
+	REA_CHECK_THROWS(small_csm.insert(15), std::length_error);
+	rea::concurrent_slot_map<int, std::size_t, small_id> sharded_csm(2);
+	REA_CHECK_THROWS(sharded_csm.reserve(16), std::length_error);
+	std::vector<std::uint32_t> csm_ids;
+	for (int i = 0; i != 7; ++i)
+		csm_ids.push_back(sharded_csm.insert(i));
+	REA_CHECK_THROWS(sharded_csm.insert(7), std::length_error);
+	for (int i = 0; i != 7; ++i)
+		REA_CHECK(sharded_csm.visit(csm_ids[i], [i](int v) { REA_CHECK(v == i); }));
+}
+
+// user-007
+void test_chunked_slot_container() {
+	rea::chunked_slot_container<int, std::allocator<int>, 3> c;
+	c.resize(20);
+	int *p = &c[5];
+	c.resize(1000);
+	REA_CHECK(p == &c[5] && c.size() == 1000 && c.capacity() >= 1000);
+	std::iota(c.begin(), c.end(), 0);
+	c.erase(c.cbegin() + 10, c.cbegin() + 20);
+	REA_CHECK(c.size() == 990 && c[10] == 20);
+
+	rea::slot_list<int> sl;
+	const auto first = sl.insert(1);
+	const int *value = &sl.id_value(first);
+	for (int i = 0; i != 10000; ++i)
+		sl.insert(i);
+	REA_CHECK(value == &sl.id_value(first));
+
+	using small_chunks = rea::versioned_split_slot_list<int, rea::default_version_type, std::size_t, std::allocator<int>, rea::default_growth_policy, 2>;
+	static_assert(std::is_same<small_chunks::value_container_type, rea::chunked_slot_container<int, std::allocator<int>, 2>>::value, "ChunkBits sets the chunk size");
+	static_assert(std::is_same<rea::slot_list<int>::container_type,
+		rea::chunked_slot_container<rea::slot_list<int>::slot_type, std::allocator<int>, rea::sl_chunk_bits<rea::slot_list<int>::slot_type>::value>>::value, "sl_chunk_bits is the default");
+	small_chunks chunked;
+	const auto id = chunked.insert(1);
+	const int *chunked_value = &chunked.id_value(id);
+	for (int i = 0; i != 100; ++i)
+		chunked.insert(i);
+	REA_CHECK(chunked_value == &chunked.id_value(id) && chunked.size() == 101);
+}
+
+// user-008
+void test_iterators() {
+	rea::versioned_slot_list<int> sl;
+	std::vector<rea::versioned_slot_list<int>::id_type> ids;
+	for (int i = 0; i != 10; ++i)
+		ids.push_back(sl.insert(i));
+	sl.erase(ids[3]);
+	REA_CHECK(std::distance(sl.begin(), sl.end()) == 9);
+	auto it = sl.end();
+	--it;
+	REA_CHECK(*it == 9);
+	REA_CHECK(*sl.iterator_of_id(ids[5]) == 5 && sl.id_of_iterator(sl.iterator_of_id(ids[5])) == ids[5]);
+	std::vector<int> reversed(std::reverse_iterator<decltype(it)>(sl.end()), std::reverse_iterator<decltype(it)>(sl.begin()));
+	REA_CHECK(reversed.size() == 9 && reversed.front() == 9 && reversed.back() == 0);
+}
+
+// user-009
+void test_occupancy_bitmap() {
+	rea::slot_list<int> sl;
+	std::vector<rea::slot_list<int>::id_type> ids;
+	for (int i = 0; i != 100; ++i)
+		ids.push_back(sl.insert(i));
+	for (int i = 0; i < 100; i += 2)
+		sl.erase(ids[i]);
+	sl.insert(1000);
+	sl.enable_occupancy_bitmap();
+	REA_CHECK(sl.has_occupancy_bitmap());
+	const auto in_slots = values_in_slot_order(sl);
+	REA_CHECK(in_slots.size() == 51 && in_slots.front() == 1 && in_slots[1] == 3);
+	REA_CHECK(std::find(in_slots.begin(), in_slots.end(), 1000) != in_slots.end());
+	sl.erase(ids[1]);
+	REA_CHECK(values_in_slot_order(sl).front() == 3);
+}
+
+// Inserts and erases between budgeted calls, and checks that a finished pass leaves both lists in slot order.
+template<typename SL>
+// SL models SlotList
+void check_interleaved_defragment() {
+	SL sl;
+	sl.reserve(1000);
+	std::vector<typename SL::id_type> ids;
+	int next = 0;
+	for (; next != 200; ++next) {
+		const auto id = sl.insert(next);
+		if (next % 3 == 0) sl.erase(id);
+		else ids.push_back(id);
+	}
+
+	int calls = 0;
+	while (!sl.defragment(5)) {
+		REA_CHECK(++calls != 10000);
+		for (int i = 0; i != 10; ++i)
+			ids.push_back(sl.insert(next++));
+		for (int i = 0; i != 9; ++i) {
+			sl.erase(ids[static_cast<std::size_t>(calls * 7 + i) % ids.size()]);
+			ids.erase(ids.begin() + static_cast<std::ptrdiff_t>(static_cast<std::size_t>(calls * 7 + i) % ids.size()));
+		}
+	}
+	REA_CHECK(values_in_order(sl) == values_in_slot_order(sl));
+	REA_CHECK(sl.size() == ids.size());
+
+	// Empty slots are now used in ascending order.
+	const int first_new = next;
+	while (sl.size() != sl.capacity())
+		sl.insert(next++);
+	std::vector<int> inserted;
+	for (auto v : values_in_slot_order(sl))
+		if (v >= first_new) inserted.push_back(v);
+	REA_CHECK(inserted == iota_vector(next - first_new, first_new));
+}
+
+// user-010
+void test_defragment() {
+	rea::versioned_slot_list<int> sl;
+	std::vector<rea::versioned_slot_list<int>::id_type> ids;
+	for (int i = 0; i != 100; ++i)
+		ids.push_back(sl.insert(i));
+	for (int i = 0; i < 100; i += 3)
+		sl.erase(ids[i]);
+	for (int i = 0; i != 10; ++i)
+		sl.insert(100 + i);
+	while (!sl.defragment(7)) {}
+	const auto in_order = values_in_order(sl);
+	REA_CHECK(in_order == values_in_slot_order(sl));
+	for (int i = 0; i != 100; ++i)
+		if (i % 3 != 0) REA_CHECK(sl.id_value(ids[i]) == i);
+
+	check_interleaved_defragment<rea::slot_list<int>>();
+	check_interleaved_defragment<rea::controlled_slot_list<int>>();
+	check_interleaved_defragment<rea::versioned_slot_list<int>>();
+	check_interleaved_defragment<rea::regulated_slot_list<int>>();
+	check_interleaved_defragment<rea::split_slot_list<int>>();
+	check_interleaved_defragment<rea::versioned_split_slot_list<int>>();
+}
+
+// user-011
+void test_shrink_to_fit() {
+	rea::versioned_slot_map<int> sm;
+	std::vector<rea::versioned_slot_map<int>::id_type> ids;
+	for (int i = 0; i != 100; ++i)
+		ids.push_back(sm.insert(i).second);
+	for (int i = 0; i != 100; ++i)
+		sm.erase(ids[i]);
+	sm.shrink_to_fit();
+	REA_CHECK(sm.capacity() == 0);
+	for (int i = 0; i != 100; ++i) {
+		const auto id = sm.insert(i).second;
+		REA_CHECK(!sm.id_is_valid(ids[i]) && sm.id_is_valid(id));
+	}
+	for (const auto &id : ids)
+		REA_CHECK(!sm.id_is_valid(id));
+
+	rea::versioned_slot_list<int> sl;
+	std::vector<rea::versioned_slot_list<int>::id_type> list_ids;
+	for (int i = 0; i != 100; ++i)
+		list_ids.push_back(sl.insert(i));
+	for (int i = 50; i != 100; ++i)
+		sl.erase(list_ids[i]);
+	sl.shrink_to_fit();
+	REA_CHECK(sl.capacity() == 50);
+	for (int i = 0; i != 50; ++i)
+		sl.insert(i);
+	for (int i = 50; i != 100; ++i)
+		REA_CHECK(!sl.id_is_valid(list_ids[i]));
+}
+
+// user-012
+void test_concurrent_slot_map() {
+	rea::concurrent_slot_map<int> sm(4);
+	REA_CHECK(sm.shard_count() == 4);
+	const int threads = 4, per_thread = 1000;
+	std::vector<std::vector<rea::concurrent_slot_map<int>::id_type>> ids(threads);
+	std::vector<std::thread> workers;
+	for (int t = 0; t != threads; ++t)
+		workers.emplace_back([&, t] {
+			for (int i = 0; i != per_thread; ++i)
+				ids[t].push_back(sm.insert(t * per_thread + i));
+		});
+	for (auto &w : workers)
+		w.join();
+	REA_CHECK(sm.size() == threads * per_thread);
+	for (int t = 0; t != threads; ++t)
+		for (int i = 0; i != per_thread; ++i) {
+			int value = -1;
+			REA_CHECK(sm.visit(ids[t][i], [&value](int v) { value = v; }));
+			REA_CHECK(value == t * per_thread + i);
+		}
+	REA_CHECK(sm.erase(ids[0][0]) && !sm.erase(ids[0][0]) && !sm.id_is_valid(ids[0][0]));
+
+	struct alignas(rea::cache_line_size) padded { int value; };
+	const rea::cache_aligned_array<padded> lines(5);
+	for (std::size_t k = 0; k != lines.size(); ++k)
+		REA_CHECK(reinterpret_cast<std::uintptr_t>(&lines[k]) % rea::cache_line_size == 0);
+}
+
+// user-013
+void test_concurrent_insert_slot_map() {
+	rea::concurrent_insert_slot_map<int> sm(4000);
+	std::vector<std::vector<rea::concurrent_insert_slot_map<int>::id_type>> ids(4);
+	std::vector<std::thread> workers;
+	for (int t = 0; t != 4; ++t)
+		workers.emplace_back([&, t] {
+			for (int i = 0; i != 1000; ++i)
+				ids[t].push_back(sm.try_insert(t * 1000 + i));
+		});
+	for (auto &w : workers)
+		w.join();
+	REA_CHECK(sm.size() == 4000);
+	REA_CHECK(sm.id_is_end(sm.try_insert(-1)));
+	for (int t = 0; t != 4; ++t)
+		for (int i = 0; i != 1000; ++i)
+			REA_CHECK(sm.id_value(ids[t][i]) == t * 1000 + i);
+	sm.erase(ids[2][7]);
+	REA_CHECK(!sm.id_is_valid(ids[2][7]) && sm.size() == 3999);
+}
+
+// user-014
+void test_seqlock_slot_list() {
+	rea::seqlock_slot_list<std::uint64_t> sl;
+	std::vector<rea::seqlock_slot_list<std::uint64_t>::id_type> ids;
+	for (std::uint64_t i = 0; i != 1000; ++i)
+		ids.push_back(sl.insert(i));
+	std::atomic<bool> done{ false };
+	std::atomic<int> torn{ 0 };
+	std::thread reader([&] {
+		while (!done.load()) {
+			std::uint64_t v = 0;
+			if (sl.try_read(ids[10], v) && v % 1000 != 10) ++torn;
+		}
+	});
+	for (std::uint64_t i = 0; i != 10000; ++i)
+		sl.store(ids[10], i * 1000 + 10);
+	done = true;
+	reader.join();
+	REA_CHECK(torn.load() == 0);
+	sl.erase(ids[3]);
+	std::uint64_t v = 0;
+	REA_CHECK(!sl.try_read(ids[3], v) && sl.load(ids[4]) == 4 && sl.size() == 999);
+}
+
+// user-015
+void test_parallel_algorithms() {
+	rea::versioned_slot_map<std::uint64_t> sm;
+	for (std::uint64_t i = 0; i != 10000; ++i)
+		sm.insert(i);
+	rea::thread_pool pool(4);
+	rea::parallel_for_each(sm, [](std::uint64_t &v, rea::versioned_slot_map<std::uint64_t>::id_type) { v *= 2; }, pool);
+	REA_CHECK(rea::parallel_reduce(sm, std::uint64_t(0), std::plus<std::uint64_t>(), pool) == 9999ull * 10000ull);
+	std::vector<bool> ids_match(sm.size());
+	rea::parallel_transform(sm, ids_match.begin(), [&sm](const std::uint64_t &v, rea::versioned_slot_map<std::uint64_t>::id_type id) {
+		return sm.id_value(id) == v;
+	}, pool);
+	REA_CHECK(std::all_of(ids_match.begin(), ids_match.end(), [](bool b) { return b; }));
+}
+
+// user-016
+void test_defer_erase() {
+	rea::versioned_slot_map<int> sm;
+	std::vector<rea::versioned_slot_map<int>::id_type> ids;
+	for (int i = 0; i != 10; ++i)
+		ids.push_back(sm.insert(i).second);
+	REA_CHECK(sm.defer_erase(ids[2]) && sm.defer_erase(ids[5]));
+	REA_CHECK(!sm.defer_erase(ids[2]));
+	REA_CHECK(sm.deferred_size() == 2 && sm.size() == 10);
+	REA_CHECK(!sm.id_is_valid(ids[2]) && sm.is_dead(sm.cbegin() + 2));
+	std::vector<int> alive;
+	sm.for_each([&alive](int v) { alive.push_back(v); });
+	REA_CHECK(alive == (std::vector<int>{ 0, 1, 3, 4, 6, 7, 8, 9 }));
+	// Parallel algorithms skip dead values too.
+	rea::thread_pool pool(2);
+	std::atomic<int> visited{ 0 };
+	rea::parallel_for_each(sm, [&sm, &visited](int&, rea::versioned_slot_map<int>::id_type id) {
+		if (sm.id_is_valid(id)) ++visited;
+	}, pool);
+	REA_CHECK(visited == 8);
+	REA_CHECK(rea::parallel_reduce(sm, 0, std::plus<int>(), pool) == 45 - 2 - 5);
+	std::vector<int> doubled(sm.size(), -1);
+	rea::parallel_transform(sm, doubled.begin(), [](int v, rea::versioned_slot_map<int>::id_type) { return v * 2; }, pool);
+	REA_CHECK(doubled[2] == -1 && doubled[5] == -1 && doubled[9] == 18);
+	REA_CHECK(sm.commit() == 2);
+	REA_CHECK(std::vector<int>(sm.begin(), sm.end()) == alive && sm.deferred_size() == 0);
+	for (int i = 0; i != 10; ++i)
+		if (i != 2 && i != 5) REA_CHECK(sm.id_value(ids[i]) == i);
+
+	rea::slot_map<int> unversioned;
+	std::vector<rea::slot_map<int>::id_type> unversioned_ids;
+	for (int i = 0; i != 4; ++i)
+		unversioned_ids.push_back(unversioned.insert(i).second);
+	REA_CHECK(unversioned.defer_erase(unversioned_ids[1]) && !unversioned.defer_erase(unversioned_ids[1]));
+	REA_CHECK(unversioned.deferred_size() == 1 && unversioned.commit() == 1 && unversioned.size() == 3);
+}
+
+// user-017
+void test_stable_slot_map() {
+	rea::stable_slot_map<int> sm;
+	std::vector<rea::stable_slot_map<int>::id_type> ids;
+	for (int i = 0; i != 100; ++i)
+		ids.push_back(sm.insert(i).second);
+	for (int i = 0; i < 100; i += 4)
+		sm.erase(ids[i]);
+	std::vector<int> expected;
+	for (int i = 0; i != 100; ++i)
+		if (i % 4 != 0) expected.push_back(i);
+	REA_CHECK(std::vector<int>(sm.begin(), sm.end()) == expected && sm.size() == 75);
+	auto it = sm.erase(sm.iterator_of_id(ids[1]));
+	REA_CHECK(*it == 2);
+	sm.insert(1000);
+	REA_CHECK(*std::prev(sm.end()) == 1000);
+	for (int i = 2; i != 100; ++i)
+		REA_CHECK(sm.id_is_valid(ids[i]) == (i % 4 != 0));
+	const auto size = sm.size();
+	sm.erase(ids[2]);
+	sm.erase(ids[2]);
+	sm.erase(ids[4]);
+	REA_CHECK(sm.size() == size - 1);
+}
+
+// user-018
+void test_sort() {
+	rea::versioned_slot_map<int> sm;
+	std::vector<rea::versioned_slot_map<int>::id_type> ids;
+	for (int i = 0; i != 100; ++i)
+		ids.push_back(sm.insert((i * 37) % 100).second);
+	sm.sort();
+	REA_CHECK(std::vector<int>(sm.begin(), sm.end()) == iota_vector(100));
+	for (int i = 0; i != 100; ++i)
+		REA_CHECK(sm.id_value(ids[i]) == (i * 37) % 100);
+
+	std::vector<std::size_t> reverse(100);
+	for (std::size_t i = 0; i != 100; ++i)
+		reverse[i] = 99 - i;
+	sm.apply_permutation(reverse.begin());
+	REA_CHECK(sm.id_value(ids[0]) == 0 && *sm.begin() == 99);
+	for (int i = 0; i != 100; ++i)
+		REA_CHECK(sm.id_value(ids[i]) == (i * 37) % 100);
+}
+
+// user-019
+void test_soa_slot_map() {
+	rea::soa_slot_map<float, int> sm;
+	std::vector<rea::soa_slot_map<float, int>::id_type> ids;
+	for (int i = 0; i != 100; ++i)
+		ids.push_back(sm.insert(static_cast<float>(i) / 2, i));
+	sm.erase(ids[0]);
+	REA_CHECK(sm.size() == 99 && !sm.id_is_valid(ids[0]));
+	for (int i = 1; i != 100; ++i) {
+		REA_CHECK(sm.id_value<1>(ids[i]) == i && sm.id_value<0>(ids[i]) == static_cast<float>(i) / 2);
+		REA_CHECK(sm.data<1>()[sm.position_of_id(ids[i])] == i);
+	}
+	REA_CHECK(sm.id_of_position(sm.position_of_id(ids[50])) == ids[50]);
+	sm.clear();
+	REA_CHECK(sm.empty() && !sm.id_is_valid(ids[50]));
+}
+
+// user-020
+void test_split_slot_list() {
+	rea::versioned_split_slot_list<char> sl;
+	std::vector<rea::versioned_split_slot_list<char>::id_type> ids;
+	for (int i = 0; i != 100; ++i)
+		ids.push_back(sl.insert(static_cast<char>(i)));
+	sl.erase(ids[10]);
+	REA_CHECK(!sl.id_is_valid(ids[10]) && sl.id_value(ids[11]) == 11 && sl.size() == 99);
+	const auto id = sl.insert('x');
+	REA_CHECK(sl.id_value(id) == 'x' && values_in_order(sl).back() == 'x');
+	sl.enable_occupancy_bitmap();
+	REA_CHECK(values_in_slot_order(sl).size() == 100);
+}
+
+// user-021
+void test_snapshot() {
+	rea::versioned_slot_map<int> sm;
+	std::vector<rea::versioned_slot_map<int>::id_type> ids;
+	for (int i = 0; i != 100; ++i)
+		ids.push_back(sm.insert(i).second);
+	sm.erase(ids[7]);
+	sm.defer_erase(ids[8]);
+	std::stringstream map_stream;
+	sm.save(map_stream);
+
+	rea::versioned_slot_map<int> loaded;
+	REA_CHECK(loaded.load(map_stream));
+	REA_CHECK(loaded.size() == sm.size() && loaded.deferred_size() == 1);
+	for (int i = 0; i != 100; ++i) {
+		REA_CHECK(loaded.id_is_valid(ids[i]) == sm.id_is_valid(ids[i]));
+		if (sm.id_is_valid(ids[i])) REA_CHECK(loaded.id_value(ids[i]) == i);
+	}
+	REA_CHECK(loaded.insert(1000).second == sm.insert(1000).second);
+
+	rea::versioned_slot_list<std::pair<int, double>> sl;
+	const auto a = sl.insert({ 1, 1.5 }), b = sl.insert({ 2, 2.5 });
+	sl.erase(a);
+	std::stringstream list_stream;
+	sl.save(list_stream);
+	rea::versioned_slot_list<std::pair<int, double>> loaded_list;
+	REA_CHECK(loaded_list.load(list_stream));
+	REA_CHECK(!loaded_list.id_is_valid(a) && loaded_list.id_value(b).second == 2.5);
+
+	std::stringstream wrong_kind;
+	sl.save(wrong_kind);
+	REA_CHECK(!loaded.load(wrong_kind));
+	REA_CHECK(loaded.empty() && !loaded.id_is_valid(ids[0]));
+
+	std::stringstream truncated(map_stream.str().substr(0, 40));
+	REA_CHECK(!loaded.load(truncated) && loaded.empty());
+}
+
+// user-023
+void test_arena_resource() {
+	rea::arena_resource arena(4096);
+	for (std::size_t alignment = 1; alignment <= 256; alignment *= 2) {
+		void *p = arena.allocate(24, alignment);
+		REA_CHECK(reinterpret_cast<std::uintptr_t>(p) % alignment == 0);
+		arena.deallocate(p, 24, alignment);
+	}
+	void *large = arena.allocate(std::size_t(2) << 20, 64);
+	REA_CHECK(reinterpret_cast<std::uintptr_t>(large) % 64 == 0);
+	arena.deallocate(large, std::size_t(2) << 20, 64);
+
+	void *small = arena.allocate(40, 8);
+	arena.deallocate(small, 40, 8);
+	REA_CHECK(arena.allocate(40, 8) == small);
+
+	{
+		rea::arena_allocator<int> alloc(arena);
+		rea::versioned_slot_map<int, std::size_t, std::size_t, rea::arena_allocator<int>> sm(alloc);
+		rea::slot_list<int, std::size_t, rea::arena_allocator<int>> sl(alloc);
+		for (int i = 0; i != 10000; ++i) {
+			sm.insert(i);
+			sl.insert(i);
+		}
+		REA_CHECK(sm.size() == 10000 && sl.size() == 10000);
+	}
+	arena.release();
+}
+
+#ifdef REA_HAS_PMR
+// Counts the allocations that are still live, so tests can tell which resource holds a container's memory.
+struct counting_resource : std::pmr::memory_resource {
+	std::size_t live = 0;
+	std::size_t allocations = 0;
+
+private:
+	void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+		++live;
+		++allocations;
+		return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+	}
+	void do_deallocate(void *p, std::size_t bytes, std::size_t alignment) override {
+		--live;
+		std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+	}
+	bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+		return this == &other;
+	}
+};
+
+template<typename C>
+// C models SlotList or SlotMap
+void check_pmr_assignment() {
+	counting_resource first, second;
+	{
+		C a(&first), b(&first), c(&second);
+		for (int i = 0; i != 100; ++i) {
+			a.insert(i);
+			c.insert(-i);
+		}
+		b = a;
+		REA_CHECK(sorted(b) == iota_vector(100));
+		// Memory resources never propagate, so copies between resources are element-wise.
+		const auto first_live = first.live;
+		c = b;
+		REA_CHECK(sorted(c) == iota_vector(100) && first.live == first_live);
+		C d(&second);
+		d = std::move(a);
+		REA_CHECK(sorted(d) == iota_vector(100) && first.live <= first_live);
+		C e(&first);
+		e = std::move(b);
+		REA_CHECK(sorted(e) == iota_vector(100));
+		C f(&first);
+		f.insert(100);
+		using std::swap;
+		swap(e, f);
+		REA_CHECK(sorted(f) == iota_vector(100) && sorted(e) == iota_vector(1, 100));
+	}
+	REA_CHECK(first.live == 0 && second.live == 0);
+}
+
+// user-023
+void test_pmr() {
+	check_pmr_assignment<rea::pmr::slot_list<int>>();
+	check_pmr_assignment<rea::pmr::versioned_slot_list<int>>();
+	check_pmr_assignment<rea::pmr::split_slot_list<int>>();
+	check_pmr_assignment<rea::pmr::versioned_split_slot_list<int>>();
+	check_pmr_assignment<rea::pmr::slot_map<int>>();
+	check_pmr_assignment<rea::pmr::versioned_slot_map<int>>();
+	check_pmr_assignment<rea::pmr::stable_slot_map<int>>();
+
+	// Scratch memory of "sort" comes from the resource of the map too.
+	counting_resource resource;
+	rea::pmr::versioned_slot_map<int> sm(&resource);
+	for (int i = 0; i != 100; ++i)
+		sm.insert(99 - i);
+	const auto allocations = resource.allocations;
+	sm.sort();
+	REA_CHECK(resource.allocations > allocations && sorted(sm) == values_in_order(sm));
+
+	static_assert(!std::is_constructible<rea::slot_map<int>, std::pmr::memory_resource*>::value,
+		"only containers with memory resource allocators are made out of memory resources");
+}
+#endif
+
+// user-024
+void test_growth_policy() {
+	for (std::size_t s = 0; s != 10000; ++s) {
+		REA_CHECK(rea::default_growth_policy::grow_size(s, std::size_t(1), 8) == rea::grow_size(s));
+		REA_CHECK(rea::default_growth_policy::is_over_breakoff(s, s / 2) == rea::is_over_breakoff(s, s / 2));
+	}
+	const std::uint64_t big = (std::uint64_t(1) << 33) + 12345;
+	const auto large = rea::large_growth_policy::grow_size(big, std::uint64_t(1), 24);
+	REA_CHECK(large > big && (large - big) * 24 <= (std::uint64_t(1) << 28) + 4096);
+	REA_CHECK((large * 24 + 23) % 4096 < 24);
+	REA_CHECK(rea::huge_page_growth_policy::grow_size(std::uint32_t(4250000000u), std::uint32_t(1), 16) == 4294967295u);
+	REA_CHECK(rea::doubling_growth_policy::grow_size(std::size_t(10), std::size_t(1), 4) == 22);
+	REA_CHECK(rea::default_growth_policy::grow_size(std::size_t(10), std::size_t(100), 4) == 110);
+
+	rea::versioned_slot_map<int, std::size_t, std::size_t, std::allocator<int>, rea::doubling_growth_policy> sm;
+	for (int i = 0; i != 100; ++i)
+		sm.insert(i);
+	sm.clear();
+	REA_CHECK(sm.empty());
+	const auto id = sm.insert(1).second;
+	REA_CHECK(sm.id_value(id) == 1 && sm.size() == 1);
+
+	rea::basic_soa_slot_map<std::size_t, std::size_t, std::allocator<char>, rea::doubling_growth_policy, int> soa;
+	soa.insert(1);
+	REA_CHECK(soa.capacity() == rea::doubling_growth_policy::grow_size(std::size_t(0), std::size_t(1), sizeof(int)));
+}
+
+#ifdef REA_TESTS_MAPPED
+std::string temporary_path(const char *name) {
+	const char *dir = std::getenv("TMPDIR");
+	return std::string(dir != nullptr ? dir : "/tmp") + "/rea_tests_" + std::to_string(::getpid()) + "_" + name;
+}
+
+// user-022
+void test_mapped_slot_map() {
+	const auto path = temporary_path("mapped");
+	std::vector<rea::mapped_slot_map<std::uint64_t>::id_type> ids;
+	{
+		rea::mapped_slot_map<std::uint64_t> sm(path);
+		for (std::uint64_t i = 0; i != 1000; ++i)
+			ids.push_back(sm.insert(i).second);
+		sm.erase(ids[10]);
+		sm.flush();
+	}
+	{
+		rea::mapped_slot_map<std::uint64_t> sm(path);
+		REA_CHECK(sm.size() == 999 && !sm.id_is_valid(ids[10]));
+		for (std::uint64_t i = 0; i != 1000; ++i)
+			if (i != 10) REA_CHECK(sm.id_value(ids[i]) == i);
+		const auto id = sm.insert(5000).second;
+		REA_CHECK(id != ids[10] && sm.id_value(id) == 5000);
+		// Everything "versioned_slot_map" offers is stored in the files too.
+		REA_CHECK(sm.erase_if([](std::uint64_t v) { return v % 2 == 0; }) == 500);
+		REA_CHECK(sm.defer_erase(ids[1]) && sm.deferred_size() == 1);
+		sm.sort();
+		sm.flush();
+	}
+	{
+		rea::mapped_slot_map<std::uint64_t> sm(path);
+		REA_CHECK(sm.size() == 499 && !sm.id_is_valid(ids[1]) && !sm.id_is_valid(ids[2]));
+		REA_CHECK(std::is_sorted(sm.begin(), sm.end()) && sm.id_value(ids[3]) == 3);
+		for (auto it = sm.begin(); it != sm.end(); ++it)
+			REA_CHECK(sm.id_value(sm.id_of_iterator(it)) == *it);
+		sm.clear();
+		REA_CHECK(!sm.id_is_valid(ids[3]) && sm.insert(7).second != ids[3]);
+	}
+	// Deferred erasures which weren't committed are committed once the map is closed.
+	{
+		rea::mapped_slot_map<std::uint64_t> sm(path);
+		sm.clear();
+		ids.assign({ sm.insert(1).second, sm.insert(2).second });
+		REA_CHECK(sm.defer_erase(ids[0]));
+		rea::mapped_slot_map<std::uint64_t> moved(std::move(sm));
+	}
+	{
+		rea::mapped_slot_map<std::uint64_t> sm(path);
+		REA_CHECK(sm.size() == 1 && *sm.begin() == 2 && !sm.id_is_valid(ids[0]) && sm.id_value(ids[1]) == 2);
+	}
+	REA_CHECK_THROWS(rea::mapped_slot_map<std::uint32_t> wrong_type(path), std::runtime_error);
+	for (auto suffix : { ".ids", ".values", ".positions" })
+		std::remove((path + suffix).c_str());
+}
+
+// user-025
+void test_reserved_slot_map() {
+	rea::reserved_slot_map<std::string> sm(10000);
+	std::vector<rea::reserved_slot_map<std::string>::id_type> ids;
+	for (int i = 0; i != 5000; ++i)
+		ids.push_back(sm.insert(std::to_string(i)).second);
+	const std::string *first = &sm.id_value(ids[4999]);
+	for (int i = 0; i != 5000; ++i)
+		sm.insert(std::to_string(i));
+	REA_CHECK(first == &sm.id_value(ids[4999]) && sm.size() == 10000);
+	REA_CHECK_THROWS(sm.insert("over"), std::length_error);
+	REA_CHECK(sm.size() == 10000);
+	for (int i = 0; i < 5000; i += 2)
+		sm.erase(ids[i]);
+	for (int i = 0; i != 5000; ++i)
+		REA_CHECK(sm.id_is_valid(ids[i]) == (i % 2 == 1));
+	REA_CHECK(sm.id_value(ids[1]) == "1");
+
+	// The same map, with the containers and growth policy handed to "versioned_slot_map" directly.
+	using containers = rea::reserved_containers;
+	using map_type = rea::versioned_slot_map<int, std::size_t, std::uint32_t, std::allocator<int>, rea::reserved_growth_policy, containers>;
+	map_type m(map_type::id_slot_container_type(100), map_type::value_container_type(100), map_type::id_pos_container_type(100));
+	REA_CHECK(m.max_size() == 100);
+	std::vector<map_type::id_type> small_ids;
+	for (int i = 0; i != 100; ++i)
+		small_ids.push_back(m.insert(i).second);
+	REA_CHECK_THROWS(m.insert(100), std::length_error);
+	m.erase_many(small_ids.begin(), small_ids.begin() + 50);
+	m.shrink_to_fit();
+	REA_CHECK(m.size() == 50 && !m.id_is_valid(small_ids[0]) && m.id_value(small_ids[50]) == 50);
+}
+#endif
+
+
+
+struct test_case {
+	const char *name;
+	void (*run)();
+};
+
+const test_case tests[] = {
+	{ "emplace", test_emplace },
+	{ "insert_range", test_insert_range },
+	{ "erase_many", test_erase_many },
+	{ "erase_if", test_erase_if },
+	{ "packed_id", test_packed_id },
+	{ "chunked_slot_container", test_chunked_slot_container },
+	{ "iterators", test_iterators },
+	{ "occupancy_bitmap", test_occupancy_bitmap },
+	{ "defragment", test_defragment },
+	{ "shrink_to_fit", test_shrink_to_fit },
+	{ "concurrent_slot_map", test_concurrent_slot_map },
+	{ "concurrent_insert_slot_map", test_concurrent_insert_slot_map },
+	{ "seqlock_slot_list", test_seqlock_slot_list },
+	{ "parallel_algorithms", test_parallel_algorithms },
+	{ "defer_erase", test_defer_erase },
+	{ "stable_slot_map", test_stable_slot_map },
+	{ "sort", test_sort },
+	{ "soa_slot_map", test_soa_slot_map },
+	{ "split_slot_list", test_split_slot_list },
+	{ "snapshot", test_snapshot },
+#ifdef REA_TESTS_MAPPED
+	{ "mapped_slot_map", test_mapped_slot_map },
+#endif
+	{ "arena_resource", test_arena_resource },
+#ifdef REA_HAS_PMR
+	{ "pmr", test_pmr },
+#endif
+	{ "growth_policy", test_growth_policy },
+#ifdef REA_TESTS_MAPPED
+	{ "reserved_slot_map", test_reserved_slot_map },
+#endif
+};
+
+bool run(const test_case &test) {
+	try {
+		test.run();
+		std::cout << "passed " << test.name << std::endl;
+		return true;
+	}
+	catch (const std::exception &e) {
+		std::cout << "FAILED " << test.name << ": " << e.what() << std::endl;
+		return false;
+	}
+}
+
+} // namespace
+
+
+
+int main(int argc, char **argv) {
+	int failed = 0;
+	if (argc == 1) {
+		for (const auto &test : tests)
+			failed += !run(test);
+		return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+	for (int i = 1; i != argc; ++i) {
+		const auto test = std::find_if(std::begin(tests), std::end(tests), [&](const test_case &t) { return std::strcmp(t.name, argv[i]) == 0; });
+		if (test == std::end(tests)) {
+			std::cout << "unknown test " << argv[i] << std::endl;
+			++failed;
+		}
+		else {
+			failed += !run(*test);
+		}
+	}
+	return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}